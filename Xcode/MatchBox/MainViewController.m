@@ -276,21 +276,23 @@ NSString * const kMatchBoxInfoDictKeyThresholdEndTime = @"MBDictKeyETime";
             return;
         }
         
-        //Finally, compare!
-        WMFeatureType distance = 0;
-        b = WMGetMinDistanceForFile((CFURLRef)myAudioFileURL_, 
-                                    (CFURLRef)othersAudioFileURL_, 
-                                    &distance, 
-                                    &myFileProcessInfo_ , 
-                                    &othersFileProcessInfo_);
-        
-        assert(b);
-
         //We define a linear scaling between the value the is our total match
         //down to some other value
         const float lower_value = comparisonThreshold_;
         const float upper_value = comparisonThreshold_*2;
         
+        //Finally, compare! Every distance above upper_value is a complete
+        //mismatch, so there is no need to calculate it exactly.
+        WMFeatureType distance = 0;
+        b = WMGetMinDistanceForFileWithThreshold((CFURLRef)myAudioFileURL_, 
+                                                 (CFURLRef)othersAudioFileURL_, 
+                                                 upper_value,
+                                                 &distance, 
+                                                 &myFileProcessInfo_ , 
+                                                 &othersFileProcessInfo_);
+        
+        assert(b);
+        
         float scale_value = (distance - lower_value) / (upper_value - lower_value);
         
         scale_value = MIN( MAX(scale_value, 0), 1);
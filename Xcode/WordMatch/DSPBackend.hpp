@@ -0,0 +1,236 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#ifndef WORD_MATCH_DSP_BACKEND_HPP
+#define WORD_MATCH_DSP_BACKEND_HPP
+
+#include <boost/utility.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <cstddef>
+#include <algorithm>
+
+// The signal processing routines of the MFCC pipeline are implemented by one
+// of two backends, chosen at build time:
+//
+//      ] WM_DSP_BACKEND_VDSP: the vDSP and BLAS routines of the Accelerate
+//        framework. This is the default on Mac OS X and iOS.
+//      ] WM_DSP_BACKEND_PORTABLE: a self-contained implementation, vectorized
+//        with SSE on x86 (unless WM_DSP_NO_SIMD is defined). This is the 
+//        default on all other platforms.
+//
+// Defining either of them in the build settings overrides the default.
+#if !defined(WM_DSP_BACKEND_VDSP) && !defined(WM_DSP_BACKEND_PORTABLE)
+#  if defined(__APPLE__)
+#    define WM_DSP_BACKEND_VDSP
+#  else
+#    define WM_DSP_BACKEND_PORTABLE
+#  endif
+#endif
+
+// The portable routines use SSE where available.
+#if !defined(WM_DSP_NO_SIMD) && (defined(__SSE__) || defined(__x86_64__))
+#  define WM_DSP_SIMD_SSE
+#endif
+
+namespace WM {
+    
+    /**
+     * Vector and matrix operations used by the MFCC pipeline. All arrays are
+     * contiguous unless a stride is given, strides are in elements. Unless
+     * noted otherwise, output arrays may be the same as input arrays.
+     */
+    namespace DSP {
+        
+        /**
+         * Returns the smallest power of two that is greater than or equal to 
+         * value (1 for value == 0).
+         */
+        inline size_t next_power_of_two(size_t value) {
+            size_t power = 1;
+            while (power < value)
+                power <<= 1;
+            return power;
+        }
+        
+        /**
+         * Returns true if RealFFT supports signals of size samples, i.e. if 
+         * size is even, at least 4, and size/2 has no prime factors other 
+         * than 2, 3 and 5.
+         */
+        inline bool is_fft_size(size_t size) {
+            if ( (size < 4) || (size % 2 != 0) )
+                return false;
+            size_t rest = size / 2;
+            while (rest % 2 == 0)
+                rest /= 2;
+            while (rest % 3 == 0)
+                rest /= 3;
+            while (rest % 5 == 0)
+                rest /= 5;
+            return rest == 1;
+        }
+        
+        /**
+         * Returns the smallest size that is greater than or equal to value
+         * and supported by RealFFT.
+         */
+        inline size_t next_fft_size(size_t value) {
+            size_t size = std::max(value, size_t(4));
+            while (!is_fft_size(size))
+                ++size;
+            return size;
+        }
+        
+        /**
+         * Sets n elements of v to zero.
+         */
+        void clear(float* v, size_t n);
+        
+        /**
+         * Writes a hamming window of n elements, 
+         * w[i] = 0.54 - 0.46 * cos(2*pi*i / n).
+         */
+        void hamming_window(float* w, size_t n);
+        
+        /**
+         * Writes out[i] = start + i * step for n elements.
+         */
+        void ramp(float start, float step, float* out, size_t n);
+        
+        /**
+         * Writes out[i] = a[i] * b[i] for n elements.
+         */
+        void multiply(const float* a, const float* b, float* out, size_t n);
+        
+        /**
+         * Writes out[i*out_stride] = a[i*a_stride] * scalar for n elements.
+         */
+        void scale(const float* a, 
+                   size_t a_stride, 
+                   float scalar, 
+                   float* out, 
+                   size_t out_stride, 
+                   size_t n);
+        
+        /**
+         * Writes out[i] = a[i] * scalar + b[i] for n elements.
+         */
+        void scale_add(const float* a, 
+                       float scalar, 
+                       const float* b, 
+                       float* out, 
+                       size_t n);
+        
+        /**
+         * Returns the dot product of n elements of a and b.
+         */
+        float dot(const float* a, const float* b, size_t n);
+        
+        /**
+         * Replaces n elements of v by their logarithm to base 10.
+         */
+        void log10(float* v, size_t n);
+        
+        /**
+         * Multiplies the rows x inner matrix a with the inner x cols matrix b
+         * into the rows x cols matrix c. All matrices are in row-major order,
+         * the leading dimensions give the distance of two rows. c must not 
+         * overlap a or b.
+         */
+        void matrix_multiply(size_t rows, 
+                             size_t cols, 
+                             size_t inner,
+                             const float* a, 
+                             size_t lda,
+                             const float* b, 
+                             size_t ldb,
+                             float* c, 
+                             size_t ldc);
+        
+        /**
+         * Multiplies the rows x cols matrix a (row-major, rows lda elements 
+         * apart) with the vector x, and writes the result to every y_stride 
+         * th element of y. y must not overlap a or x.
+         */
+        void matrix_vector_multiply(size_t rows, 
+                                    size_t cols,
+                                    const float* a, 
+                                    size_t lda,
+                                    const float* x,
+                                    float* y, 
+                                    size_t y_stride);
+        
+        /**
+         * A forward FFT of real signals. Powers of two are the fastest sizes,
+         * but any size accepted by is_fft_size works, using a mixed-radix 
+         * transform. The transform is set up once and can be reused for any
+         * number of signals.
+         */
+        class RealFFT : boost::noncopyable {
+            
+        public:
+            
+            /**
+             * Creates a new RealFFT.
+             * @param size The number of samples of a signal, see 
+             * is_fft_size. Throws std::invalid_argument otherwise.
+             */
+            explicit RealFFT(size_t size);
+            
+            ~RealFFT();
+            
+            size_t size() const { return size_; }
+            
+            /**
+             * Calculates the magnitude spectrum of a signal. 
+             * @param signal size() samples, which may be overwritten.
+             * @param magnitudes The caller is responsible that the passed array
+             * accomodates at least size()/2 elements. On output it holds the
+             * magnitudes of the bins 0 .. size()/2-1 of the spectrum, except 
+             * that the first element holds sqrt(dc^2 + nyquist^2) as both 
+             * are packed into bin 0 (see the vDSP programming guide). 
+             * magnitudes may be the same array as signal.
+             */
+            void magnitudes(float* signal, float* magnitudes);
+            
+            /**
+             * Like RealFFT::magnitudes, but writes the squared magnitudes, 
+             * which saves a square root per bin. The first element holds 
+             * dc^2 + nyquist^2.
+             */
+            void power_spectrum(float* signal, float* power);
+            
+        private:
+            
+            //Backend specific state
+            struct Setup;
+            
+            const size_t size_;
+            boost::scoped_ptr<Setup> setup_;
+            
+        };
+        
+    }
+    
+}
+
+#endif //WORD_MATCH_DSP_BACKEND_HPP
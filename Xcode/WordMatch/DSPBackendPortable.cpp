@@ -0,0 +1,207 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#include "DSPBackend.hpp"
+
+#ifdef WM_DSP_BACKEND_PORTABLE
+
+#include "PortableFFT.hpp"
+
+#include <algorithm>
+#include <math.h>
+
+#ifdef WM_DSP_SIMD_SSE
+#  include <xmmintrin.h>
+#endif
+
+using namespace WM;
+
+namespace {
+    
+#ifdef WM_DSP_SIMD_SSE
+    inline float horizontal_sum(__m128 v) {
+        __m128 shuffled = _mm_movehl_ps(v, v);
+        v = _mm_add_ps(v, shuffled);
+        shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1));
+        return _mm_cvtss_f32(_mm_add_ss(v, shuffled));
+    }
+#endif
+    
+    // y[i] += alpha * x[i] for n elements
+    inline void multiply_add(float alpha, const float* x, float* y, size_t n) {
+        size_t i = 0;
+#ifdef WM_DSP_SIMD_SSE
+        const __m128 alpha4 = _mm_set1_ps(alpha);
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), 
+                                            _mm_mul_ps(alpha4, _mm_loadu_ps(&x[i]))));
+        }
+#endif
+        for (; i < n; ++i)
+            y[i] += alpha * x[i];
+    }
+    
+}
+
+void DSP::clear(float* v, size_t n)
+{
+    std::fill(v, v + n, 0.0f);
+}
+
+void DSP::hamming_window(float* w, size_t n)
+{
+    const double omega = 2.0 * M_PI / (double)n;
+    for (size_t i = 0; i < n; ++i)
+        w[i] = (float)(0.54 - 0.46 * cos(omega * (double)i));
+}
+
+void DSP::ramp(float start, float step, float* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = start + (float)i * step;
+}
+
+void DSP::multiply(const float* a, const float* b, float* out, size_t n)
+{
+    size_t i = 0;
+#ifdef WM_DSP_SIMD_SSE
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+#endif
+    for (; i < n; ++i)
+        out[i] = a[i] * b[i];
+}
+
+void DSP::scale(const float* a, 
+                size_t a_stride, 
+                float scalar, 
+                float* out, 
+                size_t out_stride, 
+                size_t n)
+{
+    size_t i = 0;
+#ifdef WM_DSP_SIMD_SSE
+    if ( (a_stride == 1) && (out_stride == 1) ) {
+        const __m128 scalar4 = _mm_set1_ps(scalar);
+        for (; i + 4 <= n; i += 4)
+            _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&a[i]), scalar4));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i*out_stride] = a[i*a_stride] * scalar;
+}
+
+void DSP::scale_add(const float* a, 
+                    float scalar, 
+                    const float* b, 
+                    float* out, 
+                    size_t n)
+{
+    size_t i = 0;
+#ifdef WM_DSP_SIMD_SSE
+    const __m128 scalar4 = _mm_set1_ps(scalar);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&a[i]), scalar4),
+                                          _mm_loadu_ps(&b[i])));
+    }
+#endif
+    for (; i < n; ++i)
+        out[i] = a[i] * scalar + b[i];
+}
+
+float DSP::dot(const float* a, const float* b, size_t n)
+{
+    float result = 0;
+    size_t i = 0;
+#ifdef WM_DSP_SIMD_SSE
+    __m128 sum = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+    result = horizontal_sum(sum);
+#endif
+    for (; i < n; ++i)
+        result += a[i] * b[i];
+    return result;
+}
+
+void DSP::log10(float* v, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        v[i] = log10f(v[i]);
+}
+
+void DSP::matrix_multiply(size_t rows, 
+                          size_t cols, 
+                          size_t inner,
+                          const float* a, 
+                          size_t lda,
+                          const float* b, 
+                          size_t ldb,
+                          float* c, 
+                          size_t ldc)
+{
+    // each row of c is a linear combination of the rows of b
+    for (size_t i = 0; i < rows; ++i) {
+        float* c_row = &c[i*ldc];
+        clear(c_row, cols);
+        for (size_t k = 0; k < inner; ++k)
+            multiply_add(a[i*lda + k], &b[k*ldb], c_row, cols);
+    }
+}
+
+void DSP::matrix_vector_multiply(size_t rows, 
+                                 size_t cols,
+                                 const float* a, 
+                                 size_t lda,
+                                 const float* x,
+                                 float* y, 
+                                 size_t y_stride)
+{
+    for (size_t i = 0; i < rows; ++i)
+        y[i*y_stride] = dot(&a[i*lda], x, cols);
+}
+
+struct DSP::RealFFT::Setup {
+    
+    explicit Setup(size_t size) : fft(size) {}
+    
+    PortableRealFFT fft;
+    
+};
+
+DSP::RealFFT::RealFFT(size_t size) : 
+    size_(size),
+    setup_(new Setup(size))
+{}
+
+DSP::RealFFT::~RealFFT() {}
+
+void DSP::RealFFT::magnitudes(float* signal, float* magnitudes)
+{
+    setup_->fft.magnitudes(signal, magnitudes);
+}
+
+void DSP::RealFFT::power_spectrum(float* signal, float* power)
+{
+    setup_->fft.power_spectrum(signal, power);
+}
+
+#endif //WM_DSP_BACKEND_PORTABLE
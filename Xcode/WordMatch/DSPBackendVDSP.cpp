@@ -0,0 +1,283 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#include "DSPBackend.hpp"
+
+#ifdef WM_DSP_BACKEND_VDSP
+
+#include "PortableFFT.hpp"
+
+#include <Accelerate/Accelerate.h>
+
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <stdexcept>
+#include <sstream>
+#include <math.h>
+
+using namespace WM;
+
+void DSP::clear(float* v, size_t n)
+{
+    vDSP_vclr(v, 1, n);
+}
+
+void DSP::hamming_window(float* w, size_t n)
+{
+    vDSP_hamm_window(w, n, 0);
+}
+
+void DSP::ramp(float start, float step, float* out, size_t n)
+{
+    vDSP_vramp(&start, &step, out, 1, n);
+}
+
+void DSP::multiply(const float* a, const float* b, float* out, size_t n)
+{
+    vDSP_vmul(a, 1, b, 1, out, 1, n);
+}
+
+void DSP::scale(const float* a, 
+                size_t a_stride, 
+                float scalar, 
+                float* out, 
+                size_t out_stride, 
+                size_t n)
+{
+    vDSP_vsmul(a, a_stride, &scalar, out, out_stride, n);
+}
+
+void DSP::scale_add(const float* a, 
+                    float scalar, 
+                    const float* b, 
+                    float* out, 
+                    size_t n)
+{
+    vDSP_vsma(a, 1, &scalar, b, 1, out, 1, n);
+}
+
+float DSP::dot(const float* a, const float* b, size_t n)
+{
+    float result = 0;
+    vDSP_dotpr(a, 1, b, 1, &result, n);
+    return result;
+}
+
+void DSP::log10(float* v, size_t n)
+{
+    //We only have a vectorized version to get the log10 on OS X
+#ifdef HAVE_VDSP_FORCE_LIB
+    const int num_values = (int)n;
+    vvlog10f(v, v, &num_values);
+#else
+    for (size_t i = 0; i < n; ++i)
+        v[i] = log10f(v[i]);
+#endif
+}
+
+void DSP::matrix_multiply(size_t rows, 
+                          size_t cols, 
+                          size_t inner,
+                          const float* a, 
+                          size_t lda,
+                          const float* b, 
+                          size_t ldb,
+                          float* c, 
+                          size_t ldc)
+{
+    cblas_sgemm(CblasRowMajor,
+                CblasNoTrans,
+                CblasNoTrans,
+                (int)rows,
+                (int)cols,
+                (int)inner,
+                1.0f,
+                a,
+                (int)lda,
+                b,
+                (int)ldb,
+                0.0f,
+                c,
+                (int)ldc);
+}
+
+void DSP::matrix_vector_multiply(size_t rows, 
+                                 size_t cols,
+                                 const float* a, 
+                                 size_t lda,
+                                 const float* x,
+                                 float* y, 
+                                 size_t y_stride)
+{
+    cblas_sgemv(CblasRowMajor,
+                CblasNoTrans,
+                (int)rows,
+                (int)cols,
+                1.0f,
+                a,
+                (int)lda,
+                x,
+                1,
+                0.0f,
+                y,
+                (int)y_stride);
+}
+
+struct DSP::RealFFT::Setup {
+    
+    //vDSP only transforms powers of two, other sizes use the portable
+    //implementation
+    boost::scoped_ptr<PortableRealFFT> portable_fft;
+    
+    int log2n;
+    FFTSetup fft_setup;
+    
+    boost::scoped_array<float> real_part;
+    boost::scoped_array<float> imag_part;
+    
+    DSPSplitComplex split_complex;
+    
+    //Forward FFT of signal into split_complex
+    void transform(float* signal, size_t size_half) {
+        
+        // Convert to a special packed data format (see vDSP programming 
+        // guide, single array packed data format)
+        vDSP_ctoz((DSPComplex*)signal, 
+                  2, 
+                  &split_complex, 
+                  1, 
+                  size_half);
+        
+        // Perform the actual FFT
+        vDSP_fft_zrip(fft_setup, 
+                      &split_complex, 
+                      1, 
+                      log2n, 
+                      FFT_FORWARD);
+    }
+    
+};
+
+DSP::RealFFT::RealFFT(size_t size) : 
+    size_(size),
+    setup_(new Setup)
+{
+    setup_->fft_setup = NULL;
+    
+    if (next_power_of_two(size) != size) {
+        setup_->portable_fft.reset(new PortableRealFFT(size));
+        return;
+    }
+    
+    if (size < 4) {
+        std::ostringstream oss;
+        oss << "FFT size is too small: size='" << size << "'.";
+        throw std::invalid_argument(oss.str());
+    }
+    
+    setup_->log2n = 0;
+    while ( (size_t(1) << setup_->log2n) < size )
+        ++setup_->log2n;
+    
+    // FFT setup, will be reused
+    setup_->fft_setup = vDSP_create_fftsetup(setup_->log2n, FFT_RADIX2);
+    if (setup_->fft_setup == NULL) {
+        throw std::runtime_error("Could not create FFT setup.");
+    }
+    
+    setup_->real_part.reset(new float[size/2]);
+    setup_->imag_part.reset(new float[size/2]);
+    
+    //set to zero 
+    vDSP_vclr(setup_->real_part.get(), 1, size/2);
+    vDSP_vclr(setup_->imag_part.get(), 1, size/2);
+    
+    setup_->split_complex.realp = setup_->real_part.get();
+    setup_->split_complex.imagp = setup_->imag_part.get();
+}
+
+DSP::RealFFT::~RealFFT()
+{
+    if (setup_->fft_setup != NULL)
+        vDSP_destroy_fftsetup(setup_->fft_setup);
+}
+
+void DSP::RealFFT::magnitudes(float* signal, float* magnitudes)
+{
+    if (setup_->portable_fft) {
+        setup_->portable_fft->magnitudes(signal, magnitudes);
+        return;
+    }
+    
+    const size_t size_half = size_ >> 1;
+    
+    setup_->transform(signal, size_half);
+    
+    // Get the magnitudes (our actual power spectrum we are interested in)
+    vDSP_zvabs(&setup_->split_complex, 
+               1, 
+               magnitudes, 
+               1, 
+               size_half);
+    
+    // We still need to divide by 2 as the previous FWD FFT introduced a factor
+    // of 2 due to optimization techniques (see vDSP programming guide)
+    float scale = 0.5f;
+    
+    vDSP_vsmul(magnitudes, 
+               1, 
+               &scale, 
+               magnitudes, 
+               1, 
+               size_half);
+}
+
+void DSP::RealFFT::power_spectrum(float* signal, float* power)
+{
+    if (setup_->portable_fft) {
+        setup_->portable_fft->power_spectrum(signal, power);
+        return;
+    }
+    
+    const size_t size_half = size_ >> 1;
+    
+    setup_->transform(signal, size_half);
+    
+    // Squared magnitudes, no square root
+    vDSP_zvmags(&setup_->split_complex, 
+                1, 
+                power, 
+                1, 
+                size_half);
+    
+    // The factor of 2 of the FWD FFT is squared as well
+    float scale = 0.25f;
+    
+    vDSP_vsmul(power, 
+               1, 
+               &scale, 
+               power, 
+               1, 
+               size_half);
+}
+
+#endif //WM_DSP_BACKEND_VDSP
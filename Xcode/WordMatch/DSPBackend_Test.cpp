@@ -0,0 +1,184 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "DSPBackend.hpp"
+
+#include <iostream>
+
+BOOST_AUTO_TEST_SUITE( DSPBackendTest )
+
+using namespace WM;
+
+/**
+ * The magnitudes of the real FFT are compared with a straightforward DFT. The
+ * first bin holds DC and nyquist, like the packed format of vDSP. Besides 
+ * powers of two, sizes with factors 3 and 5 are checked as well.
+ */
+BOOST_AUTO_TEST_CASE(RealFFTMagnitudes) {
+    
+    BOOST_REQUIRE_THROW(DSP::RealFFT fft(0), std::invalid_argument);
+    BOOST_REQUIRE_THROW(DSP::RealFFT fft(2), std::invalid_argument);
+    BOOST_REQUIRE_THROW(DSP::RealFFT fft(15), std::invalid_argument);
+    BOOST_REQUIRE_THROW(DSP::RealFFT fft(14), std::invalid_argument);
+    
+    BOOST_CHECK(DSP::is_fft_size(400));
+    BOOST_CHECK(!DSP::is_fft_size(402));
+    BOOST_CHECK_EQUAL(DSP::next_fft_size(401), 432u);
+    BOOST_CHECK_EQUAL(DSP::next_fft_size(1), 4u);
+    
+    const size_t sizes[] = { 4, 16, 64, 256, 1024, 6, 12, 30, 90, 400 };
+    
+    for (size_t s = 0; s<sizeof(sizes)/sizeof(sizes[0]); ++s) {
+        
+        const size_t size = sizes[s];
+        std::vector<float> signal(size);
+        for (size_t n = 0; n<size; ++n) {
+            signal[n] = 0.5f*sinf(0.37f*n) + 0.2f*cosf(1.3f*n) + 0.1f;
+        }
+        
+        std::vector<float> magnitudes(signal);
+        DSP::RealFFT fft(size);
+        BOOST_REQUIRE_EQUAL(fft.size(), size);
+        fft.magnitudes(&magnitudes[0], &magnitudes[0]);
+        
+        std::vector<float> copy(signal);
+        std::vector<float> power(size/2);
+        fft.power_spectrum(&copy[0], &power[0]);
+        for (size_t k = 0; k<size/2; ++k) {
+            BOOST_CHECK_CLOSE(power[k], magnitudes[k]*magnitudes[k], 0.01);
+        }
+        
+        double dc = 0;
+        double nyquist = 0;
+        for (size_t n = 0; n<size; ++n) {
+            dc += signal[n];
+            nyquist += (n % 2 == 0) ? signal[n] : -signal[n];
+        }
+        BOOST_CHECK_CLOSE(magnitudes[0], sqrt(dc*dc + nyquist*nyquist), 0.01);
+        
+        for (size_t k = 1; k<size/2; ++k) {
+            double re = 0;
+            double im = 0;
+            for (size_t n = 0; n<size; ++n) {
+                const double angle = -2.0 * M_PI * (double)(k*n) / (double)size;
+                re += signal[n] * cos(angle);
+                im += signal[n] * sin(angle);
+            }
+            BOOST_CHECK_SMALL(magnitudes[k] - (float)sqrt(re*re + im*im), 1e-3f);
+        }
+    }
+    
+}
+
+/**
+ * Checks the vector operations against their definitions, with sizes that
+ * are not a multiple of the vector width.
+ */
+BOOST_AUTO_TEST_CASE(VectorOperations) {
+    
+    const size_t n = 11;
+    std::vector<float> a(n), b(n), out(n);
+    for (size_t i = 0; i<n; ++i) {
+        a[i] = 1.0f + i;
+        b[i] = 0.5f * i - 2.0f;
+    }
+    
+    float expected_dot = 0;
+    for (size_t i = 0; i<n; ++i)
+        expected_dot += a[i] * b[i];
+    BOOST_CHECK_CLOSE(DSP::dot(&a[0], &b[0], n), expected_dot, 0.001);
+    
+    DSP::multiply(&a[0], &b[0], &out[0], n);
+    for (size_t i = 0; i<n; ++i)
+        BOOST_CHECK_EQUAL(out[i], a[i] * b[i]);
+    
+    DSP::scale_add(&a[0], -0.97f, &b[0], &out[0], n);
+    for (size_t i = 0; i<n; ++i)
+        BOOST_CHECK_CLOSE(out[i], a[i] * -0.97f + b[i], 0.001);
+    
+    DSP::scale(&a[0], 2, 3.0f, &out[0], 1, n/2);
+    for (size_t i = 0; i<n/2; ++i)
+        BOOST_CHECK_EQUAL(out[i], a[2*i] * 3.0f);
+    
+    DSP::ramp(1.0f, 0.25f, &out[0], n);
+    for (size_t i = 0; i<n; ++i)
+        BOOST_CHECK_CLOSE(out[i], 1.0f + 0.25f*i, 0.001);
+    
+    DSP::hamming_window(&out[0], n);
+    BOOST_CHECK_CLOSE(out[0], 0.08f, 0.001);
+    for (size_t i = 1; i<n; ++i)
+        BOOST_CHECK_CLOSE(out[i], out[n-i], 0.001);
+    
+    DSP::clear(&out[0], n);
+    BOOST_CHECK(std::count(out.begin(), out.end(), 0.0f) == (int)n);
+    
+}
+
+/**
+ * Matrix products with leading dimensions larger than the matrices.
+ */
+BOOST_AUTO_TEST_CASE(MatrixOperations) {
+    
+    const size_t rows = 5;
+    const size_t inner = 7;
+    const size_t cols = 6;
+    
+    std::vector<float> a(rows*(inner+1)), b(inner*(cols+2)), c(rows*cols);
+    for (size_t i = 0; i<a.size(); ++i)
+        a[i] = sinf(0.3f*i);
+    for (size_t i = 0; i<b.size(); ++i)
+        b[i] = cosf(0.7f*i);
+    
+    DSP::matrix_multiply(rows, cols, inner, 
+                         &a[0], inner+1, 
+                         &b[0], cols+2, 
+                         &c[0], cols);
+    
+    for (size_t i = 0; i<rows; ++i) {
+        for (size_t j = 0; j<cols; ++j) {
+            float expected = 0;
+            for (size_t k = 0; k<inner; ++k)
+                expected += a[i*(inner+1) + k] * b[k*(cols+2) + j];
+            BOOST_CHECK_SMALL(c[i*cols + j] - expected, 1e-5f);
+        }
+    }
+    
+    std::vector<float> y(rows*3);
+    DSP::matrix_vector_multiply(rows, inner, &a[0], inner+1, &b[0], &y[0], 3);
+    
+    for (size_t i = 0; i<rows; ++i) {
+        float expected = 0;
+        for (size_t k = 0; k<inner; ++k)
+            expected += a[i*(inner+1) + k] * b[k];
+        BOOST_CHECK_SMALL(y[i*3] - expected, 1e-5f);
+    }
+    
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,6 +23,8 @@
 #include <boost/scoped_array.hpp>
 #include <boost/shared_ptr.hpp>
 #include <vector>
+#include <string>
+#include <boost/lexical_cast.hpp>
 
 #include <algorithm>
 #include <stdexcept>
@@ -35,6 +37,10 @@
 #include "MFCCUtils.h"
 #include "benchmark.h"
 
+extern "C" {
+#include "WordMatchTemplateIndex.h"
+}
+
 #include <iostream>
 
 typedef boost::shared_ptr<WM::AudioFileReader> AudioFileReaderRef;
@@ -179,11 +185,151 @@ BOOST_FIXTURE_TEST_CASE( DifferentPulloverTest, PulloversReaderFixture ) {
     
 }
 
+BOOST_FIXTURE_TEST_CASE( DeltaFeaturesTest, PulloversReaderFixture ) {
+    
+    //The static part of the delta features has to be the plain features
+    FeatureTypeDTW::Features features_pullover_one = get_mfcc_features(pullover_rdr_variant_one);
+    FeatureTypeDeltaDTW::Features delta_pullover_one = get_mfcc_delta_features(pullover_rdr_variant_one);
+    
+    BOOST_REQUIRE_EQUAL(delta_pullover_one.size(), features_pullover_one.size());
+    for (size_t i = 0; i<features_pullover_one.size(); ++i) {
+        for (size_t k = 0; k<FeatureTypeDTW::feature_number_size; ++k) {
+            BOOST_CHECK_EQUAL(delta_pullover_one[i][k], features_pullover_one[i][k]);
+        }
+    }
+    
+    FeatureTypeDeltaDTW::Features delta_pullover_two = get_mfcc_delta_features(pullover_rdr_variant_two);
+    FeatureTypeDeltaDTW::Features delta_blumentopf = get_mfcc_delta_features(blumentopf_rdr);
+    
+    FeatureTypeDeltaDTW dtw_close(delta_pullover_one, delta_pullover_two, 20);
+    FeatureTypeDeltaDTW dtw_far(delta_pullover_one, delta_blumentopf, 20);
+    
+    std::cout << "DTW with deltas: 02-pullover-2.wav vs. 02-pullover-3.wav; Min-Distance: "
+              << dtw_close.minimum_distance() << std::endl;
+    
+    std::cout << "DTW with deltas: 02-pullover-2.wav vs. 04-blumentopf-3.wav; Min-Distance: "
+              << dtw_far.minimum_distance() << std::endl;
+    
+}
+
+BOOST_FIXTURE_TEST_CASE( TemplateIndexTest, PulloversReaderFixture ) {
+    
+    FeatureTypeDTW::Features features[] = {
+        get_mfcc_features(pullover_rdr_variant_one),
+        get_mfcc_features(pullover_rdr_variant_two),
+        get_mfcc_features(blumentopf_rdr)
+    };
+    const char* labels[] = { "pullover", "pullover", "blumentopf" };
+    
+    WMTemplateIndexRef index = NULL;
+    BOOST_REQUIRE_EQUAL(WMTemplateIndexCreate(20, &index), kWMTemplateIndexResultOK);
+    
+    WMTemplateID ids[3];
+    for (size_t i = 0; i < 3; ++i) {
+        BOOST_REQUIRE_EQUAL(WMTemplateIndexInsertFeatures(index, 
+                                                          features[i][0].data(), 
+                                                          features[i].size(), 
+                                                          labels[i], 
+                                                          &ids[i]), 
+                            kWMTemplateIndexResultOK);
+    }
+    BOOST_CHECK_EQUAL(WMTemplateIndexGetCount(index), 3u);
+    
+    //Each template is its own nearest neighbour, the other pullover should
+    //be next.
+    WMTemplateMatch matches[3];
+    size_t num_matches = 0;
+    BOOST_REQUIRE_EQUAL(WMTemplateIndexQueryFeatures(index, 
+                                                     features[0][0].data(), 
+                                                     features[0].size(), 
+                                                     3, 
+                                                     20, 
+                                                     matches, 
+                                                     &num_matches), 
+                        kWMTemplateIndexResultOK);
+    BOOST_REQUIRE_EQUAL(num_matches, 3u);
+    BOOST_CHECK_EQUAL(matches[0].template_id, ids[0]);
+    BOOST_CHECK_EQUAL(matches[0].distance, 0.0f);
+    BOOST_CHECK_EQUAL(matches[1].template_id, ids[1]);
+    BOOST_CHECK_EQUAL(std::string(WMTemplateIndexGetLabel(index, matches[1].template_id)), 
+                      "pullover");
+    BOOST_CHECK_EQUAL(matches[1].distance, 
+                      FeatureTypeDTW(features[0], features[1], 20).minimum_distance());
+    
+    BOOST_CHECK_EQUAL(WMTemplateIndexRemove(index, ids[0]), kWMTemplateIndexResultOK);
+    BOOST_CHECK_EQUAL(WMTemplateIndexRemove(index, ids[0]), kWMTemplateIndexResultErrorUnknownID);
+    BOOST_CHECK(WMTemplateIndexGetLabel(index, ids[0]) == NULL);
+    BOOST_CHECK_EQUAL(WMTemplateIndexGetCount(index), 2u);
+    
+    BOOST_CHECK_EQUAL(WMTemplateIndexDestroy(index), kWMTemplateIndexResultOK);
+    
+}
+
 BOOST_AUTO_TEST_CASE( BenchmarkTest ) {
     
     show_benchmark_data(6,
                         4);    
     
 }
+
+BOOST_AUTO_TEST_CASE( AveragedBenchmarkTest ) {
+    
+    show_averaged_benchmark_data(6,
+                                 4);
+    
+}
+
+BOOST_AUTO_TEST_CASE( TemplateSearchTest ) {
+    
+    show_template_search_data(6,
+                              4);
+    
+}
+    
+BOOST_AUTO_TEST_CASE( FastDTWErrorTest ) {
+    
+    //samples/ holds the speaker corpus (matlab/samples), the other files 
+    //are the ones from the top level samples folder
+    std::vector<std::string> filenames;
+    for (size_t speaker=1; speaker<=4; ++speaker)
+        for (size_t sample=1; sample<=6; ++sample)
+            filenames.push_back("samples/0" + 
+                                boost::lexical_cast<std::string>(sample) + "-" +
+                                boost::lexical_cast<std::string>(speaker) + ".wav");
+    filenames.push_back("samples/pullover_fast.wav");
+    filenames.push_back("samples/pullover_slow.wav");
+    filenames.push_back("samples/pullover_quirky.wav");
+    filenames.push_back("file_a.caf");
+    filenames.push_back("sine_40hz_1_sec_norm_16khz.caf");
+    filenames.push_back("sine_880hz_1_sec_norm_faded_16khz.caf");
+    
+    show_fast_dtw_error(filenames, 1);
+    show_fast_dtw_error(filenames, 5);
+    show_fast_dtw_error(filenames, 10);
+    
+}
+
+BOOST_AUTO_TEST_CASE( FFTPaddingBenchmarkTest ) {
+    
+    std::vector<std::string> filenames;
+    for (size_t speaker=1; speaker<=4; ++speaker)
+        for (size_t sample=1; sample<=6; ++sample)
+            filenames.push_back("samples/0" + 
+                                boost::lexical_cast<std::string>(sample) + "-" +
+                                boost::lexical_cast<std::string>(speaker) + ".wav");
+    filenames.push_back("samples/pullover_fast.wav");
+    filenames.push_back("samples/pullover_slow.wav");
+    filenames.push_back("samples/pullover_quirky.wav");
+    
+    show_fft_padding_data(filenames);
+    
+}
+
+BOOST_AUTO_TEST_CASE( QuantizationErrorTest ) {
+    
+    show_quantization_error(6,
+                            4);
+    
+}
     
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,156 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#include "DeltaProcessor.hpp"
+
+#include <stdexcept>
+#include <sstream>
+#include <algorithm>
+
+using namespace WM;
+
+DeltaProcessor::DeltaProcessor(size_t num_features, size_t window) :
+    num_features_(num_features),
+    window_(window),
+    ring_size_(2*window + 1),
+    weights_(window),
+    static_ring_(ring_size_ * num_features),
+    delta_ring_(ring_size_ * num_features),
+    last_frame_(num_features),
+    num_padded_frames_(0),
+    num_deltas_(0),
+    num_frames_pushed_(0),
+    num_frames_written_(0)
+{
+    std::ostringstream oss;
+    //input checks
+    if (num_features == 0) {
+        oss << "Number of features is zero.";
+        throw std::invalid_argument(oss.str());
+    }
+    
+    if (window == 0) {
+        oss << "Delta window is zero.";
+        throw std::invalid_argument(oss.str());
+    }
+    
+    float denominator = 0;
+    for (size_t n = 1; n <= window_; ++n)
+        denominator += 2.0f * n * n;
+    
+    for (size_t n = 1; n <= window_; ++n)
+        weights_[n-1] = n / denominator;
+}
+
+bool DeltaProcessor::push(const float* features, float* out)
+{
+    //the stream starts with copies of the first frame, so that the first 
+    //output is the first frame
+    if (num_frames_pushed_ == 0) {
+        for (size_t i = 0; i < latency(); ++i)
+            advance(features, out);
+    }
+    
+    std::copy(features, features + num_features_, last_frame_.begin());
+    ++num_frames_pushed_;
+    
+    if (!advance(features, out))
+        return false;
+    
+    ++num_frames_written_;
+    return true;
+}
+
+size_t DeltaProcessor::flush(float* out)
+{
+    //repeat the last frame until all frames pushed have been written
+    size_t num_written = 0;
+    while (num_frames_written_ < num_frames_pushed_) {
+        
+        if (advance(&last_frame_[0], &out[num_written * output_size()])) {
+            ++num_written;
+            ++num_frames_written_;
+        }
+    }
+    
+    return num_written;
+}
+
+void DeltaProcessor::reset()
+{
+    num_padded_frames_ = 0;
+    num_deltas_ = 0;
+    num_frames_pushed_ = 0;
+    num_frames_written_ = 0;
+}
+
+bool DeltaProcessor::advance(const float* features, float* out)
+{
+    const size_t frame = num_padded_frames_++;
+    std::copy(features, 
+              features + num_features_, 
+              &static_ring_[(frame % ring_size_) * num_features_]);
+    
+    if (num_padded_frames_ < ring_size_)
+        return false;
+    
+    //the deltas of the frame window_ frames back, all frames around it are
+    //in the ring now
+    const size_t delta_frame = frame - window_;
+    regression(static_ring_, 
+               delta_frame, 
+               &delta_ring_[(delta_frame % ring_size_) * num_features_]);
+    ++num_deltas_;
+    
+    if (num_deltas_ < ring_size_)
+        return false;
+    
+    //the same for the delta-deltas, another window_ frames back
+    const size_t out_frame = delta_frame - window_;
+    const size_t slot = (out_frame % ring_size_) * num_features_;
+    
+    std::copy(&static_ring_[slot], 
+              &static_ring_[slot + num_features_], 
+              out);
+    std::copy(&delta_ring_[slot], 
+              &delta_ring_[slot + num_features_], 
+              &out[num_features_]);
+    regression(delta_ring_, out_frame, &out[2 * num_features_]);
+    
+    return true;
+}
+
+void DeltaProcessor::regression(const std::vector<float>& ring, 
+                                size_t center, 
+                                float* out) const
+{
+    std::fill(out, out + num_features_, 0);
+    
+    for (size_t n = 1; n <= window_; ++n) {
+        
+        const float* next = &ring[((center + n) % ring_size_) * num_features_];
+        const float* previous = &ring[((center + ring_size_ - n) % ring_size_) * num_features_];
+        const float weight = weights_[n-1];
+        
+        for (size_t k = 0; k < num_features_; ++k)
+            out[k] += weight * (next[k] - previous[k]);
+    }
+}
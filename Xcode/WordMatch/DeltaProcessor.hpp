@@ -0,0 +1,147 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+
+#ifndef WORD_MATCH_DELTA_PROCESSOR_HPP
+#define WORD_MATCH_DELTA_PROCESSOR_HPP
+
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace WM {
+    
+    /**
+     * Calculates delta (differential) and delta-delta (acceleration) values 
+     * of a stream of feature vectors, e.g. cepstra of consecutive windows. The
+     * deltas of frame t are the linear regression over the window w frames 
+     * around it,
+     *
+     *      d(t) = sum_{n=1..w} n * (c(t+n) - c(t-n)) / (2 * sum_{n=1..w} n^2),
+     *
+     * and the delta-deltas are the same regression over the deltas. At the
+     * borders the first and the last frame are repeated.
+     *
+     * Frames are pushed one at a time. Only the last 2w+1 frames and deltas 
+     * are kept in ring buffers, so that the stream is never read twice. As 
+     * the regression looks ahead, the output lags latency() frames behind 
+     * the input; DeltaProcessor::flush writes the remaining frames at the 
+     * end of the stream.
+     *
+     * Each output frame is one contiguous block of output_size() values: the
+     * num_features static values, followed by their deltas and their 
+     * delta-deltas. A stream of output frames can therefore be used as DTW
+     * feature vectors directly.
+     */
+    class DeltaProcessor : boost::noncopyable {
+        
+    public:
+        
+        /**
+         * @param num_features The number of values of each frame.
+         * @param window The number of frames on either side of a frame that
+         * the regression uses, usually 2. Throws std::invalid_argument if 
+         * either parameter is zero.
+         */
+        DeltaProcessor(size_t num_features, size_t window);
+        
+        /**
+         * Pushes the next frame of the stream.
+         * @param features num_features values.
+         * @param out The caller is responsible that the passed array 
+         * accomodates at least output_size() elements. If the method returns
+         * true, it holds the output of the frame latency() frames before the
+         * pushed one on return (or the first frame if fewer were pushed).
+         * @return False while the first frames are needed to fill the ring 
+         * buffers and no output was written.
+         */
+        bool push(const float* features, float* out);
+        
+        /**
+         * Ends the stream and writes the output of all frames pushed, but not
+         * returned yet, one after the other.
+         * @param out The caller is responsible that the passed array 
+         * accomodates at least latency() * output_size() elements.
+         * @return The number of frames written, at most latency().
+         */
+        size_t flush(float* out);
+        
+        /**
+         * Starts a new stream. Frames pushed before that are discarded.
+         */
+        void reset();
+        
+        /**
+         * @return The number of values of each output frame, 
+         * 3 * num_features.
+         */
+        size_t output_size() const { return 3 * num_features_; }
+        
+        /**
+         * @return The number of frames the output lags behind, 2 * window.
+         */
+        size_t latency() const { return 2 * window_; }
+        
+        const size_t& num_features() const { return num_features_; }
+        
+        const size_t& window() const { return window_; }
+        
+    private:
+        
+        //Adds a frame to the stream padded with copies of the first frame. 
+        //Returns true and writes out once the ring buffers are filled.
+        bool advance(const float* features, float* out);
+        
+        //Writes the regression of the frames around center of ring to out
+        void regression(const std::vector<float>& ring, 
+                        size_t center, 
+                        float* out) const;
+        
+        const size_t num_features_;
+        const size_t window_;
+        
+        //2*window+1, the number of frames either ring holds
+        const size_t ring_size_;
+        
+        //n / (2 * sum n^2) for n = 1 .. window
+        std::vector<float> weights_;
+        
+        //Frame i of the padded stream is stored at slot i % ring_size_
+        std::vector<float> static_ring_;
+        std::vector<float> delta_ring_;
+        
+        //Copy of the last frame pushed, to repeat it by flush
+        std::vector<float> last_frame_;
+        
+        //Number of frames of the padded stream, and of the deltas calculated
+        size_t num_padded_frames_;
+        size_t num_deltas_;
+        
+        //Number of frames pushed, and of frames written by push and flush
+        size_t num_frames_pushed_;
+        size_t num_frames_written_;
+        
+    };
+    
+}
+
+#endif //WORD_MATCH_DELTA_PROCESSOR_HPP
@@ -0,0 +1,175 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <math.h>
+
+#include "DeltaProcessor.hpp"
+
+BOOST_AUTO_TEST_SUITE( DeltaProcessorTest )
+
+using namespace WM;
+
+//Straightforward deltas of a whole sequence of num_frames frames, with the 
+//first and the last frame repeated at the borders, as DeltaProcessor does.
+std::vector<float> reference_deltas(const std::vector<float>& frames, 
+                                    size_t num_features, 
+                                    size_t window) 
+{
+    const size_t num_frames = frames.size() / num_features;
+    const size_t padding = 2*window;
+    const size_t num_padded = num_frames + 2*padding;
+    
+    std::vector<float> padded(num_padded * num_features);
+    for (size_t i = 0; i<num_padded; ++i) {
+        size_t frame = (i < padding) ? 0 : std::min(i - padding, num_frames - 1);
+        std::copy(&frames[frame*num_features], 
+                  &frames[(frame+1)*num_features], 
+                  &padded[i*num_features]);
+    }
+    
+    float denominator = 0;
+    for (size_t n = 1; n<=window; ++n)
+        denominator += 2.0f*n*n;
+    
+    std::vector<float> deltas(num_padded * num_features, 0);
+    for (size_t i = window; i<num_padded - window; ++i)
+        for (size_t k = 0; k<num_features; ++k)
+            for (size_t n = 1; n<=window; ++n)
+                deltas[i*num_features + k] += n * (padded[(i+n)*num_features + k] - 
+                                                   padded[(i-n)*num_features + k]) / denominator;
+    
+    std::vector<float> out;
+    for (size_t i = padding; i<padding + num_frames; ++i) {
+        
+        out.insert(out.end(), &padded[i*num_features], &padded[(i+1)*num_features]);
+        out.insert(out.end(), &deltas[i*num_features], &deltas[(i+1)*num_features]);
+        
+        for (size_t k = 0; k<num_features; ++k) {
+            float delta_delta = 0;
+            for (size_t n = 1; n<=window; ++n)
+                delta_delta += n * (deltas[(i+n)*num_features + k] - 
+                                    deltas[(i-n)*num_features + k]) / denominator;
+            out.push_back(delta_delta);
+        }
+    }
+    
+    return out;
+}
+
+//Pushes all frames and flushes, returns the output of all frames
+std::vector<float> stream_deltas(DeltaProcessor& dp, const std::vector<float>& frames)
+{
+    const size_t num_frames = frames.size() / dp.num_features();
+    std::vector<float> out(num_frames * dp.output_size());
+    
+    size_t num_written = 0;
+    for (size_t f = 0; f<num_frames; ++f) {
+        if (dp.push(&frames[f*dp.num_features()], &out[num_written*dp.output_size()]))
+            ++num_written;
+        
+        BOOST_CHECK_EQUAL(num_written, (f < dp.latency()) ? 0 : f + 1 - dp.latency());
+    }
+    
+    num_written += dp.flush(&out[num_written*dp.output_size()]);
+    BOOST_CHECK_EQUAL(num_written, num_frames);
+    
+    return out;
+}
+
+BOOST_AUTO_TEST_CASE(SanityCheck) {
+    
+    BOOST_REQUIRE_THROW(DeltaProcessor dp(0, 2), std::invalid_argument);
+    BOOST_REQUIRE_THROW(DeltaProcessor dp(13, 0), std::invalid_argument);
+    
+    DeltaProcessor dp(13, 2);
+    BOOST_CHECK_EQUAL(dp.output_size(), 39u);
+    BOOST_CHECK_EQUAL(dp.latency(), 4u);
+    
+    //nothing to flush without frames
+    BOOST_CHECK_EQUAL(dp.flush(NULL), 0u);
+}
+
+/**
+ * For a linear ramp, the deltas are the slope and the delta-deltas zero, 
+ * except for the frames near the borders.
+ */
+BOOST_AUTO_TEST_CASE(LinearRamp) {
+    
+    const size_t num_frames = 30;
+    const size_t window = 2;
+    
+    std::vector<float> frames(num_frames*2);
+    for (size_t f = 0; f<num_frames; ++f) {
+        frames[f*2] = 0.5f * f;
+        frames[f*2 + 1] = 3.0f - 2.0f * f;
+    }
+    
+    DeltaProcessor dp(2, window);
+    std::vector<float> out = stream_deltas(dp, frames);
+    
+    for (size_t f = 2*window; f<num_frames - 2*window; ++f) {
+        BOOST_CHECK_EQUAL(out[f*6 + 0], frames[f*2]);
+        BOOST_CHECK_EQUAL(out[f*6 + 1], frames[f*2 + 1]);
+        BOOST_CHECK_CLOSE(out[f*6 + 2], 0.5f, 1e-3);
+        BOOST_CHECK_CLOSE(out[f*6 + 3], -2.0f, 1e-3);
+        BOOST_CHECK_SMALL(out[f*6 + 4], 1e-5f);
+        BOOST_CHECK_SMALL(out[f*6 + 5], 1e-5f);
+    }
+}
+
+/**
+ * The streamed output has to match the deltas of the whole sequence, for 
+ * streams shorter and longer than the latency, and after a reset.
+ */
+BOOST_AUTO_TEST_CASE(StreamMatchesSequence) {
+    
+    const size_t num_features = 13;
+    const size_t lengths[] = { 1, 3, 4, 5, 40 };
+    const size_t windows[] = { 1, 2, 3 };
+    
+    for (size_t w = 0; w<3; ++w) {
+        
+        DeltaProcessor dp(num_features, windows[w]);
+        
+        for (size_t l = 0; l<5; ++l) {
+            
+            std::vector<float> frames(lengths[l]*num_features);
+            for (size_t i = 0; i<frames.size(); ++i)
+                frames[i] = sinf(0.37f*i) + 0.1f*(i % 7);
+            
+            dp.reset();
+            std::vector<float> out = stream_deltas(dp, frames);
+            std::vector<float> expected = reference_deltas(frames, num_features, windows[w]);
+            
+            BOOST_REQUIRE_EQUAL(out.size(), expected.size());
+            for (size_t i = 0; i<out.size(); ++i)
+                BOOST_CHECK_SMALL(out[i] - expected[i], 1e-5f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -21,10 +21,10 @@
 
 #include "MFCCProcessor.hpp"
 
-#include "CABitOperations.h"
-
 #include <stdexcept>
+#include <algorithm>
 #include <sstream>
+#include <cstring>
 #include <math.h>
 
 #include <iostream>
@@ -36,13 +36,16 @@
 
 using namespace WM;
 
+const size_t MFCCProcessor::kFramesPerBatch;
+
 MFCCProcessor::MFCCProcessor(size_t user_window_size,
                              float pre_emph_alpha,
                              int sampling_rate, 
                              float mel_min_freq, 
-                             float mel_max_freq) :
+                             float mel_max_freq,
+                             FFTPadding fft_padding) :
     user_window_size_(user_window_size), 
-    fft_size_(NextPowerOfTwo((UInt32)user_window_size_*2)),
+    fft_size_(padded_fft_size(user_window_size_, fft_padding)),
     fft_size_half_(fft_size_ >> 1),
     pre_emph_alpha_(pre_emph_alpha),
     process_buffer_(new float[fft_size_]),
@@ -53,10 +56,11 @@ MFCCProcessor::MFCCProcessor(size_t user_window_size,
                      kNumMelBands(), 
                      (int)(fft_size_half_), // half of FFT size 
                      sampling_rate),
-    fft_data_real_part_(new float[fft_size_half_]),
-    fft_data_imag_part_(new float[fft_size_half_]),
+    fft_(fft_size_),
     mel_bands_buffer_(new float[kNumMelBands()]),
-    dct_ii_matrix_(new float[kNumMelBands() * kNumMelCepstra()])
+    dct_ii_matrix_(new float[kNumMelBands() * kNumMelCepstra()]),
+    batch_spectra_(new float[kFramesPerBatch * fft_size_half_]),
+    batch_mel_bands_(new float[kFramesPerBatch * kNumMelBands()])
 {
     std::ostringstream oss;
     //input checks
@@ -89,28 +93,13 @@ MFCCProcessor::MFCCProcessor(size_t user_window_size,
     }
     
     //Set FFT buffer to zero
-    vDSP_vclr(process_buffer_.get(), 1, fft_size_);
+    DSP::clear(process_buffer_.get(), fft_size_);
     
     //initialize a symmetric hamming window. This is later going to be used
     //to be applied to our sample window.
-    vDSP_hamm_window(hamming_window_.get(), user_window_size_, 0);
-    
-    fft_log2n_ = static_cast<int>(log2l(static_cast<long>(fft_size_)));
-    
-    // FFT setup, will be reused
-    fft_setup_ = vDSP_create_fftsetup(fft_log2n_, FFT_RADIX2);
-    if (fft_setup_ == NULL) {
-        throw std::runtime_error("Could not create FFT setup.");
-    }
-    
-    //set to zero 
-    vDSP_vclr(fft_data_real_part_.get(), 1, fft_size_half_);
-    vDSP_vclr(fft_data_imag_part_.get(), 1, fft_size_half_);
-    
-    fft_data_split_complex_.realp = fft_data_real_part_.get();
-    fft_data_split_complex_.imagp = fft_data_imag_part_.get();
+    DSP::hamming_window(hamming_window_.get(), user_window_size_);
     
-    vDSP_vclr(mel_bands_buffer_.get(), 1, kNumMelBands());
+    DSP::clear(mel_bands_buffer_.get(), kNumMelBands());
     
     //Calculate the matrix to perform DCT
     //see
@@ -136,9 +125,7 @@ MFCCProcessor::MFCCProcessor(size_t user_window_size,
     // vDSP Documentation suggests using 16byte aligned pointers, malloc does 
     // that by default, just check that the "new" implementation took care of 
     // that as well...
-    bool is_aligned = ( MEM_IS_ALIGNED(fft_data_real_part_.get(), 16) ||
-                        MEM_IS_ALIGNED(fft_data_imag_part_.get(), 16) ||
-                        MEM_IS_ALIGNED(process_buffer_.get(), 16) || 
+    bool is_aligned = ( MEM_IS_ALIGNED(process_buffer_.get(), 16) || 
                         MEM_IS_ALIGNED(hamming_window_.get(), 16) ||
                         MEM_IS_ALIGNED(mel_bands_buffer_.get(), 16) ||
                         MEM_IS_ALIGNED(dct_ii_matrix_.get(), 16) );
@@ -150,11 +137,7 @@ MFCCProcessor::MFCCProcessor(size_t user_window_size,
     
 }
 
-MFCCProcessor::~MFCCProcessor() {
-
-    vDSP_destroy_fftsetup(fft_setup_);
-    
-}
+MFCCProcessor::~MFCCProcessor() {}
 
 void MFCCProcessor::process(const WMAudioSampleType * samples,
                             WMAudioSampleType pre_emph_filter_border,
@@ -166,26 +149,7 @@ void MFCCProcessor::process(const WMAudioSampleType * samples,
     if ( samples == NULL )
         return;
     
-    //we either copy straight to the process buffer, or we perform 
-    //pre-emphasis and set the process buffer as the target
-
-    
-    // Pre-emphasis, a high-pass filter
-    if (pre_emph_alpha_ != 0) {
-        pre_emphasize_to_buffer(pre_emph_filter_border, samples);
-    } else {
-        size_t num_bytes = sizeof(WMAudioSampleType)*user_window_size_;
-        memcpy(process_buffer_.get(), samples, num_bytes);        
-    }
-    
-    //make sure that the rest of process buffer is set to zero
-    vDSP_vclr(&process_buffer_[user_window_size_], 1, fft_size_ - user_window_size_);    
-    
-    // Apply Hamming Window before performing FFT
-    apply_hamming_window();
-    
-    // FWD FFT Real, in-place
-    calculate_spectrum_magnitudes();
+    calculate_spectrum(samples, pre_emph_filter_border);
     
     // Copy FFT magnitudes, if requested.
     if (spectrum_mag_out != NULL) {
@@ -209,51 +173,223 @@ void MFCCProcessor::process(const WMAudioSampleType * samples,
                   mel_spectrum_mag_out);        
     }    
     
-    // take the log of the mel bands
+    // take the log of the mel bands, and transform them to cepstra
 
     if (mfcc_out != NULL) {    
     
-        //We only have a vectorized version to get the log10 on OS X
-#ifdef HAVE_VDSP_FORCE_LIB
-        const int num_mel_bands = kNumMelBands();
-        vvlog10f(mel_bands_buffer_.get(), mel_bands_buffer_.get(), &num_mel_bands);
-#else
-        for (int i = 0; i < kNumMelBands(); ++i)
-            mel_bands_buffer_[i] = log10f(mel_bands_buffer_[i]);
-#endif
-    
-        // Perform the discrete cosine transform. We have prepared a matrix that
-        // we can simply multiply with the vector of mel_bands
-        
-        vDSP_vclr(mfcc_out->c_array(), 1, kNumMelCepstra());
+        DSP::log10(mel_bands_buffer_.get(), kNumMelBands());
+    
+        discrete_cosine_transform(mel_bands_buffer_.get(), 1, mfcc_out->c_array());
         
-        // Vectorized matrix multiplication
+    }
+    
+    // Differential values are calculated over the sequence of cepstra by 
+    // DeltaProcessor.
+    // TODO: Add optional other features like energy/packet
+    
+}
+
+void MFCCProcessor::process(const WMAudioSampleType * samples,
+                            WMAudioSampleType pre_emph_filter_border,
+                            OutputMode mode,
+                            WMFeatureType * out)
+{
+    if ( (samples == NULL) || (out == NULL) )
+        return;
+    
+    prepare_window(samples, pre_emph_filter_border);
+    
+    if (mode == kOutputPowerSpectrum) {
+        fft_.power_spectrum(process_buffer_.get(), out);
+        return;
+    }
+    
+    calculate_spectrum_magnitudes();
+    
+    // the log mel energies are either the output, or the input of the DCT
+    float* mel_bands = (mode == kOutputLogMelEnergies) ? out : mel_bands_buffer_.get();
+    
+    mel_filter_bank_.apply(process_buffer_.get(), mel_bands);
+    DSP::log10(mel_bands, kNumMelBands());
+    
+    if (mode == kOutputMFCC)
+        discrete_cosine_transform(mel_bands, 1, out);
+}
+
+size_t MFCCProcessor::output_size(OutputMode mode) const
+{
+    switch (mode) {
+        case kOutputPowerSpectrum:
+            return fft_size_half_;
+        case kOutputLogMelEnergies:
+            return kNumMelBands();
+        default:
+            return kNumMelCepstra();
+    }
+}
+
+size_t MFCCProcessor::padded_fft_size(size_t user_window_size, 
+                                      FFTPadding fft_padding)
+{
+    switch (fft_padding) {
+        case kFFTPaddingPowerOfTwo:
+            return DSP::next_power_of_two(user_window_size);
+        case kFFTPaddingMixedRadix:
+            return DSP::next_fft_size(user_window_size);
+        default:
+            return DSP::next_power_of_two(user_window_size*2);
+    }
+}
+
+size_t MFCCProcessor::num_frames(size_t num_samples, size_t hop_size) const
+{
+    if ( (hop_size == 0) || (num_samples < user_window_size_) )
+        return 0;
+    
+    return 1 + (num_samples - user_window_size_) / hop_size;
+}
+
+size_t MFCCProcessor::process_frames(const WMAudioSampleType * samples,
+                                     size_t num_samples,
+                                     size_t hop_size,
+                                     WMAudioSampleType pre_emph_filter_border,
+                                     WMFeatureType * mfcc_out)
+{
+    return process_frames(samples, 
+                          num_samples, 
+                          hop_size, 
+                          pre_emph_filter_border, 
+                          kOutputMFCC, 
+                          mfcc_out);
+}
+
+size_t MFCCProcessor::process_frames(const WMAudioSampleType * samples,
+                                     size_t num_samples,
+                                     size_t hop_size,
+                                     WMAudioSampleType pre_emph_filter_border,
+                                     OutputMode mode,
+                                     WMFeatureType * out)
+{
+    if (hop_size == 0)
+        throw std::invalid_argument("Hop size is zero.");
+    
+    if ( (samples == NULL) || (out == NULL) )
+        return 0;
+    
+    const size_t frames = num_frames(num_samples, hop_size);
+    const size_t frame_size = output_size(mode);
+    
+    for (size_t first = 0; first < frames; first += kFramesPerBatch) {
         
-        cblas_sgemm(CblasColMajor,
-                    CblasNoTrans, 
-                    CblasNoTrans,
-                    kNumMelCepstra(),
-                    1, 
-                    kNumMelBands(), 
-                    1, 
-                    dct_ii_matrix_.get(), 
-                    kNumMelCepstra(), 
-                    mel_bands_buffer_.get(), 
-                    kNumMelBands(), 
-                    0.0f, 
-                    mfcc_out->c_array(), 
-                    kNumMelCepstra());
+        const size_t batch_size = std::min(frames - first, kFramesPerBatch);
         
-        // for orthogonalized DCT version we have to multiply the first cepstral
-        // value with 1/sqrt(2)
-        const float sqrt_two_inv = 1.0f/sqrtf(2.0f);
-        mfcc_out->c_array()[0] *= sqrt_two_inv;
+        for (size_t f = 0; f < batch_size; ++f) {
+            
+            const size_t begin = (first + f) * hop_size;
+            
+            //the sample left of the window is the border of the 
+            //pre-emphasis filter
+            prepare_window(&samples[begin], 
+                           (begin == 0) ? pre_emph_filter_border : samples[begin - 1]);
+            
+            //the FFT writes straight to the output or the batch
+            if (mode == kOutputPowerSpectrum) {
+                fft_.power_spectrum(process_buffer_.get(), 
+                                    &out[(first + f)*frame_size]);
+            } else {
+                fft_.magnitudes(process_buffer_.get(), 
+                                &batch_spectra_[f*fft_size_half_]);
+            }
+        }
         
+        if (mode == kOutputLogMelEnergies) {
+            log_mel_energies(batch_spectra_.get(), 
+                             batch_size, 
+                             &out[first*frame_size]);
+        } else if (mode == kOutputMFCC) {
+            log_mel_energies(batch_spectra_.get(), 
+                             batch_size, 
+                             batch_mel_bands_.get());
+            discrete_cosine_transform(batch_mel_bands_.get(), 
+                                      batch_size, 
+                                      &out[first*frame_size]);
+        }
     }
     
-    // TODO: Add optional other features like differential values or energy/
-    // packet
+    return frames;
+}
+
+void MFCCProcessor::calculate_spectrum(const WMAudioSampleType* samples,
+                                       WMAudioSampleType pre_emph_filter_border)
+{
+    prepare_window(samples, pre_emph_filter_border);
     
+    // FWD FFT Real, in-place
+    calculate_spectrum_magnitudes();
+}
+
+void MFCCProcessor::prepare_window(const WMAudioSampleType* samples,
+                                   WMAudioSampleType pre_emph_filter_border)
+{
+    //we either copy straight to the process buffer, or we perform 
+    //pre-emphasis and set the process buffer as the target
+
+    
+    // Pre-emphasis, a high-pass filter
+    if (pre_emph_alpha_ != 0) {
+        pre_emphasize_to_buffer(pre_emph_filter_border, samples);
+    } else {
+        size_t num_bytes = sizeof(WMAudioSampleType)*user_window_size_;
+        memcpy(process_buffer_.get(), samples, num_bytes);        
+    }
+    
+    //make sure that the rest of process buffer is set to zero
+    DSP::clear(&process_buffer_[user_window_size_], fft_size_ - user_window_size_);    
+    
+    // Apply Hamming Window before performing FFT
+    apply_hamming_window();
+}
+
+void MFCCProcessor::log_mel_energies(const float* spectra, 
+                                     size_t num_frames, 
+                                     float* mel_bands_out)
+{
+    // mel triangular bandpass filter for all spectra at once
+    mel_filter_bank_.apply(spectra, 
+                           num_frames, 
+                           fft_size_half_, 
+                           mel_bands_out);
+    
+    // take the log of the mel bands
+    DSP::log10(mel_bands_out, num_frames * kNumMelBands());
+}
+
+void MFCCProcessor::discrete_cosine_transform(const float* mel_bands, 
+                                              size_t num_frames, 
+                                              WMFeatureType* mfcc_out)
+{
+    // DCT of all frames: (frames x bands) * (bands x cepstra). Stored in 
+    // column major order, dct_ii_matrix_ is the bands x cepstra matrix in 
+    // row major order.
+    DSP::matrix_multiply(num_frames,
+                         kNumMelCepstra(),
+                         kNumMelBands(),
+                         mel_bands,
+                         kNumMelBands(),
+                         dct_ii_matrix_.get(),
+                         kNumMelCepstra(),
+                         mfcc_out,
+                         kNumMelCepstra());
+    
+    // for orthogonalized DCT version we have to multiply the first cepstral
+    // value with 1/sqrt(2)
+    const float sqrt_two_inv = 1.0f/sqrtf(2.0f);
+    DSP::scale(mfcc_out, 
+               kNumMelCepstra(), 
+               sqrt_two_inv, 
+               mfcc_out, 
+               kNumMelCepstra(), 
+               num_frames);
 }
 
 void MFCCProcessor::pre_emphasize_to_buffer(float border_value,
@@ -268,14 +404,11 @@ void MFCCProcessor::pre_emphasize_to_buffer(float border_value,
     
     // vector add + factor, mind the offset
     const float pre_emph_neg = -pre_emph_alpha_;
-    vDSP_vsma(orig_audio, 
-              1, 
-              &pre_emph_neg, 
-              &orig_audio[1], 
-              1, 
-              &(process_buffer_.get())[1], 
-              1, 
-              user_window_size_-1);
+    DSP::scale_add(orig_audio, 
+                   pre_emph_neg, 
+                   &orig_audio[1], 
+                   &(process_buffer_.get())[1], 
+                   user_window_size_-1);
     
     // deal with border properly
     process_buffer_[0] = orig_audio[0] - pre_emph_alpha_*  border_value;
@@ -285,54 +418,20 @@ void MFCCProcessor::pre_emphasize_to_buffer(float border_value,
 void MFCCProcessor::apply_hamming_window()
 {
     // Simply apply the previously generated hamming window
-    vDSP_vmul(process_buffer_.get(), 1, 
-              hamming_window_.get(), 1, 
-              process_buffer_.get(), 1, 
-              user_window_size_);
+    DSP::multiply(process_buffer_.get(), 
+                  hamming_window_.get(), 
+                  process_buffer_.get(), 
+                  user_window_size_);
     
 }
 
 void MFCCProcessor::calculate_spectrum_magnitudes() {
     
-    // Convert to a special packed data format (see vDSP programming guide, 
-    // single array packed data format)
-    
-    vDSP_ctoz((DSPComplex*)process_buffer_.get(), 
-              2, 
-              &fft_data_split_complex_, 
-              1, 
-              fft_size_half_);
-    
-    // Perform the actual FFT
-    
-    vDSP_fft_zrip(fft_setup_, 
-                  &fft_data_split_complex_, 
-                  1, 
-                  fft_log2n_, 
-                  FFT_FORWARD);
-    
-    // Get the magnitudes (our actual power spectrum we are interested in)
-    // we re-use the same memory, but we need only half of its size
-    vDSP_zvabs(&fft_data_split_complex_, 
-               1, 
-               process_buffer_.get(), 
-               1, 
-               fft_size_half_);
-    
-    // We still need to divide by 2 as the previous FWD FFT introduced a factor
-    // of 2 due to optimization techniques (see vDSP programming guide)
-    float scale = 0.5f;
-    
-    vDSP_vsmul(process_buffer_.get(), 
-               1, 
-               &scale, 
-               process_buffer_.get(), 
-               1, 
-               fft_size_half_);
+    // Perform the actual FFT, and get the magnitudes (our actual power 
+    // spectrum we are interested in). We re-use the same memory, but we need
+    // only half of its size.
+    fft_.magnitudes(process_buffer_.get(), process_buffer_.get());
     
     // Done, the first half of process_buffer_ now holds the magnitude spectrum
     
 }
-
-
-
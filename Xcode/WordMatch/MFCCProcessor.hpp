@@ -30,8 +30,7 @@
 #include <boost/array.hpp>
 
 #include "MelFilterBank.hpp"
-
-#include <Accelerate/Accelerate.h>
+#include "DSPBackend.hpp"
 
 namespace WM {
 
@@ -52,13 +51,54 @@ namespace WM {
      * and James Martin.
      *
      * This class uses mostly vectorized versions of transformations using the
-     * vDSP framework and should therefore provide very good performance on 
-     * Mac OS X and iOS devices (iOS 4 required).
+     * DSP backend (see DSPBackend.hpp), i.e. the vDSP framework on Mac OS X 
+     * and iOS devices (iOS 4 required), and a portable implementation on 
+     * other platforms.
      */
     class MFCCProcessor : boost::noncopyable {
 
     public:
         
+        /**
+         * Defines how the window is zero-padded to the size of the FFT.
+         *
+         *      ] kFFTPaddingDoublePowerOfTwo: the next power-of-two of twice 
+         *        the window size, e.g. 1024 for 400 frames. This is the 
+         *        default, the regression data was generated with it.
+         *      ] kFFTPaddingPowerOfTwo: the next power-of-two of the window 
+         *        size, e.g. 512 for 400 frames.
+         *      ] kFFTPaddingMixedRadix: the smallest size of at least the 
+         *        window size that the mixed-radix FFT supports (see 
+         *        DSP::next_fft_size), e.g. 400 for 400 frames.
+         *
+         * Smaller FFTs are faster but sample the spectrum more coarsely, 
+         * which slightly changes the output of the mel filter bank.
+         */
+        enum FFTPadding {
+            kFFTPaddingDoublePowerOfTwo,
+            kFFTPaddingPowerOfTwo,
+            kFFTPaddingMixedRadix
+        };
+        
+        /**
+         * Defines what MFCCProcessor::process and 
+         * MFCCProcessor::process_frames write for each window. Only the 
+         * stages needed for the requested output are run.
+         *
+         *      ] kOutputPowerSpectrum: the squared magnitudes of the FFT, 
+         *        fft_size_half elements. The first element holds 
+         *        dc^2 + nyquist^2, see DSP::RealFFT::power_spectrum.
+         *      ] kOutputLogMelEnergies: the log10 of the mel filter bank 
+         *        energies, kNumMelBands elements, i.e. the MFCC's before the
+         *        DCT.
+         *      ] kOutputMFCC: the cepstra, kNumMelCepstra elements.
+         */
+        enum OutputMode {
+            kOutputPowerSpectrum,
+            kOutputLogMelEnergies,
+            kOutputMFCC
+        };
+        
         /**
          * @param user_window_size The window size, i.e. number of frames which 
          * is going to be used for the FFT in order to calculate the MFCC 
@@ -83,12 +123,15 @@ namespace WM {
          * Mel-Frequency warping (for a sampling rate of 16khz this is usually
          * around 6855). This value must not be greater than the nyquist limit
          * (sampling_rate / 2).
+         * @param fft_padding How the window is padded for the FFT, see 
+         * MFCCProcessor::FFTPadding.
          */
         MFCCProcessor(size_t user_window_size,
                       float pre_emph_alpha,
                       int sampling_rate, 
                       float mel_min_freq,
-                      float mel_max_freq);
+                      float mel_max_freq,
+                      FFTPadding fft_padding = kFFTPaddingDoublePowerOfTwo);
         
         ~MFCCProcessor();
         
@@ -146,8 +189,71 @@ namespace WM {
                      WMFeatureType * mel_spectrum_mag_out = NULL);
         
         /**
-         *@return The number of frames of the FFT buffer. This is the next
-         *power-of-two of user_window_size*2
+         * Like the previous method, but writes only the output selected by 
+         * mode, directly into out.
+         *
+         * @param out The caller is responsible that the passed array 
+         * accomodates at least output_size(mode) elements.
+         */
+        void process(const WMAudioSampleType * samples,
+                     WMAudioSampleType pre_emph_filter_border,
+                     OutputMode mode,
+                     WMFeatureType * out);
+        
+        /**
+         * @return The number of elements MFCCProcessor::process writes for 
+         * each window in the given mode.
+         */
+        size_t output_size(OutputMode mode) const;
+        
+        /**
+         * @return The number of frames MFCCProcessor::process_frames yields
+         * for a signal of num_samples samples, i.e. the number of windows of
+         * user_window_size samples, hop_size samples apart, that fit into the
+         * signal.
+         */
+        size_t num_frames(size_t num_samples, size_t hop_size) const;
+        
+        /**
+         * Calculates the MFCC's of all windows of a signal. Window f starts at
+         * sample f*hop_size, its pre-emphasis border is the sample just before
+         * it (pre_emph_filter_border for the first window). This yields the 
+         * same cepstra as calling MFCCProcessor::process for each window, up
+         * to rounding. The spectra of many windows are collected first, so that
+         * the mel filter bank and the DCT run as (sparse) matrix products over
+         * all of them instead of once per window.
+         *
+         * @param samples The signal, num_samples samples.
+         * @param hop_size The distance between the beginnings of two 
+         * consecutive windows in samples.
+         * @param pre_emph_filter_border See MFCCProcessor::process.
+         * @param mfcc_out The caller is responsible that the passed array
+         * accomodates at least num_frames(num_samples, hop_size) * 
+         * kNumMelCepstra elements. On return it holds the cepstra of window f
+         * at mfcc_out[f*kNumMelCepstra].
+         * @return The number of windows processed.
+         */
+        size_t process_frames(const WMAudioSampleType * samples,
+                              size_t num_samples,
+                              size_t hop_size,
+                              WMAudioSampleType pre_emph_filter_border,
+                              WMFeatureType * mfcc_out);
+        
+        /**
+         * Like the previous method, but writes the output selected by mode. 
+         * The output of window f is stored at out[f*output_size(mode)].
+         */
+        size_t process_frames(const WMAudioSampleType * samples,
+                              size_t num_samples,
+                              size_t hop_size,
+                              WMAudioSampleType pre_emph_filter_border,
+                              OutputMode mode,
+                              WMFeatureType * out);
+        
+        /**
+         *@return The number of frames of the FFT buffer. By default this is 
+         *the next power-of-two of user_window_size*2, see 
+         *MFCCProcessor::FFTPadding.
          */
         const size_t& fft_size() const { return fft_size_; }
         
@@ -170,14 +276,42 @@ namespace WM {
         
     private:
         
+        //The size of the FFT for a window of user_window_size frames
+        static size_t padded_fft_size(size_t user_window_size, 
+                                      FFTPadding fft_padding);
+        
         //Pre-emphasizes the signal. See MFCCProcessor::process for an
         //explanation of the border value.
         void pre_emphasize_to_buffer(float border_value, 
                                      const WMAudioSampleType* orig_audio);
         
+        //Pre-emphasis, zero-padding and windowing of a single window into 
+        //process_buffer_, ready for the FFT.
+        void prepare_window(const WMAudioSampleType* samples,
+                            WMAudioSampleType pre_emph_filter_border);
+        
+        //Pre-emphasis, windowing and FFT of a single window. Leaves the 
+        //magnitude spectrum in the first half of process_buffer_.
+        void calculate_spectrum(const WMAudioSampleType* samples,
+                                WMAudioSampleType pre_emph_filter_border);
+        
         void apply_hamming_window();
         void calculate_spectrum_magnitudes();
         
+        //Mel filter bank and log of num_frames magnitude spectra, stored 
+        //row by row with a stride of fft_size_half_
+        void log_mel_energies(const float* spectra, 
+                              size_t num_frames, 
+                              float* mel_bands_out);
+        
+        //DCT of num_frames rows of log mel energies
+        void discrete_cosine_transform(const float* mel_bands, 
+                                       size_t num_frames, 
+                                       WMFeatureType* mfcc_out);
+        
+        //Number of windows process_frames transforms at once
+        static const size_t kFramesPerBatch = 64;
+        
         const size_t user_window_size_;
         const size_t fft_size_;
         const size_t fft_size_half_;
@@ -193,18 +327,16 @@ namespace WM {
         
         const MelFilterBank mel_filter_bank_;
         
-        int fft_log2n_;
-        FFTSetup fft_setup_;
-        
-        FloatScopedArray fft_data_real_part_;
-        FloatScopedArray fft_data_imag_part_;        
-        
-        DSPSplitComplex fft_data_split_complex_;
+        DSP::RealFFT fft_;
         
         FloatScopedArray mel_bands_buffer_;
         
         FloatScopedArray dct_ii_matrix_;
         
+        //Spectra and mel bands of kFramesPerBatch windows, row by row
+        FloatScopedArray batch_spectra_;
+        FloatScopedArray batch_mel_bands_;
+        
     };
     
 }
@@ -139,6 +139,183 @@ BOOST_AUTO_TEST_CASE( DeterministicBehaviour ) {
     }
 }
 
+/**
+ * Checks that MFCCProcessor::process_frames yields the same cepstra as 
+ * processing each window on its own.
+ */
+BOOST_AUTO_TEST_CASE( BatchedFramesTest ) {
+    
+    //more windows than fit into a single batch
+    const size_t test_sample_size = 16000;
+    const size_t hop_size = 160;
+    FloatScopedArray data(new float[test_sample_size]);
+    
+    for (int i = 0; i<test_sample_size; ++i) {
+        data[i] = 0.5f*sinf(0.05f*i) + 0.3f*sinf(0.31f*i + 1) + 0.1f*sinf(1.7f*i);
+    }
+    
+    MFCCProcessor mp(400, 0.97f, 16000, 133.33f, 6855.6);
+    
+    BOOST_CHECK_EQUAL(mp.num_frames(399, hop_size), 0u);
+    BOOST_CHECK_EQUAL(mp.num_frames(400, hop_size), 1u);
+    BOOST_CHECK_EQUAL(mp.num_frames(559, hop_size), 1u);
+    BOOST_CHECK_EQUAL(mp.num_frames(560, hop_size), 2u);
+    BOOST_REQUIRE_THROW(mp.process_frames(data.get(), test_sample_size, 0, 0, NULL), 
+                        std::invalid_argument);
+    
+    const size_t num_frames = mp.num_frames(test_sample_size, hop_size);
+    FloatScopedArray cepstra(new float[num_frames*13]);
+    BOOST_REQUIRE_EQUAL(mp.process_frames(data.get(), 
+                                          test_sample_size, 
+                                          hop_size, 
+                                          0, 
+                                          cepstra.get()), 
+                        num_frames);
+    
+    for (size_t f = 0; f<num_frames; ++f) {
+        
+        MFCCProcessor::CepstraBuffer window_cepstra;
+        mp.process(&data[f*hop_size], 
+                   (f == 0) ? 0 : data[f*hop_size - 1], 
+                   &window_cepstra);
+        
+        for (int i = 0; i<13; ++i) {
+            BOOST_CHECK_SMALL(cepstra[f*13 + i] - window_cepstra[i], 1e-4f);
+        }
+    }
+}
+
+/**
+ * Smaller FFT sizes sample the spectrum more coarsely, but must yield roughly
+ * the same cepstra as the default padding on average.
+ */
+BOOST_AUTO_TEST_CASE( FFTPaddingTest ) {
+    
+    const size_t test_sample_size = 4000;
+    const size_t hop_size = 160;
+    FloatScopedArray data(new float[test_sample_size]);
+    
+    //a broadband signal, harmonics of 123hz with decaying amplitude
+    std::fill(&data[0], &data[test_sample_size], 0);
+    for (int k = 1; k<=60; ++k) {
+        const float omega = 2.0f * float(M_PI) * 123.0f * k / 16000.0f;
+        for (int i = 0; i<test_sample_size; ++i) {
+            data[i] += sinf(omega*i + k*k) / k;
+        }
+    }
+    
+    MFCCProcessor mp_default(400, 0.97f, 16000, 133.33f, 6855.6);
+    MFCCProcessor mp_power_of_two(400, 0.97f, 16000, 133.33f, 6855.6, 
+                                  MFCCProcessor::kFFTPaddingPowerOfTwo);
+    MFCCProcessor mp_mixed_radix(400, 0.97f, 16000, 133.33f, 6855.6, 
+                                 MFCCProcessor::kFFTPaddingMixedRadix);
+    
+    BOOST_CHECK_EQUAL(mp_default.fft_size(), 1024u);
+    BOOST_CHECK_EQUAL(mp_power_of_two.fft_size(), 512u);
+    BOOST_CHECK_EQUAL(mp_mixed_radix.fft_size(), 400u);
+    BOOST_CHECK_EQUAL(MFCCProcessor(401, 0.97f, 16000, 133.33f, 6855.6, 
+                                    MFCCProcessor::kFFTPaddingMixedRadix).fft_size(), 
+                      432u);
+    
+    const size_t num_frames = mp_default.num_frames(test_sample_size, hop_size);
+    FloatScopedArray cepstra(new float[num_frames*13]);
+    FloatScopedArray padded_cepstra(new float[num_frames*13]);
+    
+    mp_default.process_frames(data.get(), test_sample_size, hop_size, 0, cepstra.get());
+    
+    MFCCProcessor* padded[] = { &mp_power_of_two, &mp_mixed_radix };
+    for (size_t p = 0; p<2; ++p) {
+        
+        BOOST_REQUIRE_EQUAL(padded[p]->process_frames(data.get(), 
+                                                      test_sample_size, 
+                                                      hop_size, 
+                                                      0, 
+                                                      padded_cepstra.get()), 
+                            num_frames);
+        
+        float deviation = 0;
+        for (size_t i = 0; i<num_frames*13; ++i) {
+            deviation += fabsf(padded_cepstra[i] - cepstra[i]);
+        }
+        BOOST_CHECK_SMALL(deviation / (num_frames*13), 0.2f);
+    }
+}
+
+/**
+ * Each output mode must yield the same values as the corresponding stage of
+ * the full pipeline, for single windows as well as for batches of windows.
+ */
+BOOST_AUTO_TEST_CASE( OutputModesTest ) {
+    
+    const size_t test_sample_size = 16000;
+    const size_t hop_size = 160;
+    FloatScopedArray data(new float[test_sample_size]);
+    
+    for (int i = 0; i<test_sample_size; ++i) {
+        data[i] = 0.5f*sinf(0.05f*i) + 0.3f*sinf(0.31f*i + 1) + 0.1f*sinf(1.7f*i);
+    }
+    
+    MFCCProcessor mp(400, 0.97f, 16000, 133.33f, 6855.6);
+    
+    const size_t spectrum_size = mp.fft_size_half();
+    const size_t num_bands = MFCCProcessor::kNumMelBands();
+    const size_t num_cepstra = MFCCProcessor::kNumMelCepstra();
+    
+    BOOST_CHECK_EQUAL(mp.output_size(MFCCProcessor::kOutputPowerSpectrum), spectrum_size);
+    BOOST_CHECK_EQUAL(mp.output_size(MFCCProcessor::kOutputLogMelEnergies), num_bands);
+    BOOST_CHECK_EQUAL(mp.output_size(MFCCProcessor::kOutputMFCC), num_cepstra);
+    
+    const size_t num_frames = mp.num_frames(test_sample_size, hop_size);
+    FloatScopedArray power(new float[num_frames*spectrum_size]);
+    FloatScopedArray log_mel(new float[num_frames*num_bands]);
+    FloatScopedArray cepstra(new float[num_frames*num_cepstra]);
+    
+    BOOST_REQUIRE_EQUAL(mp.process_frames(data.get(), test_sample_size, hop_size, 0, 
+                                          MFCCProcessor::kOutputPowerSpectrum, 
+                                          power.get()), 
+                        num_frames);
+    BOOST_REQUIRE_EQUAL(mp.process_frames(data.get(), test_sample_size, hop_size, 0, 
+                                          MFCCProcessor::kOutputLogMelEnergies, 
+                                          log_mel.get()), 
+                        num_frames);
+    BOOST_REQUIRE_EQUAL(mp.process_frames(data.get(), test_sample_size, hop_size, 0, 
+                                          MFCCProcessor::kOutputMFCC, 
+                                          cepstra.get()), 
+                        num_frames);
+    
+    std::vector<float> spectrum(spectrum_size);
+    std::vector<float> mel_spectrum(num_bands);
+    std::vector<float> window_output(spectrum_size);
+    
+    for (size_t f = 0; f<num_frames; f += 7) {
+        
+        const float* window = &data[f*hop_size];
+        const float border = (f == 0) ? 0 : data[f*hop_size - 1];
+        
+        MFCCProcessor::CepstraBuffer window_cepstra;
+        mp.process(window, border, &window_cepstra, &spectrum[0], &mel_spectrum[0]);
+        
+        mp.process(window, border, MFCCProcessor::kOutputPowerSpectrum, &window_output[0]);
+        for (size_t i = 0; i<spectrum_size; ++i) {
+            const float expected = spectrum[i]*spectrum[i];
+            BOOST_CHECK_SMALL(window_output[i] - expected, 1e-4f*(1 + expected));
+            BOOST_CHECK_EQUAL(power[f*spectrum_size + i], window_output[i]);
+        }
+        
+        mp.process(window, border, MFCCProcessor::kOutputLogMelEnergies, &window_output[0]);
+        for (size_t i = 0; i<num_bands; ++i) {
+            BOOST_CHECK_SMALL(window_output[i] - log10f(mel_spectrum[i]), 1e-4f);
+            BOOST_CHECK_SMALL(log_mel[f*num_bands + i] - window_output[i], 1e-4f);
+        }
+        
+        mp.process(window, border, MFCCProcessor::kOutputMFCC, &window_output[0]);
+        for (size_t i = 0; i<num_cepstra; ++i) {
+            BOOST_CHECK_EQUAL(window_output[i], window_cepstra[i]);
+            BOOST_CHECK_SMALL(cepstra[f*num_cepstra + i] - window_output[i], 1e-4f);
+        }
+    }
+}
+
 //TODO: if I was more familar with boost::serialization, I would have used
 //that instead.
 void print_reference_array(const std::string& array_name, 
@@ -22,133 +22,181 @@
 #include "MFCCUtils.h"
 
 #include <cassert>
+#include <iostream>
 #include "MFCCProcessor.hpp"
+#include "DeltaProcessor.hpp"
 #include "dtw.hpp"
 #include "DebugUtils.h"
 
-/**
- * Processes a complete file and returns a vector of MFCC features for DTW.
- */
-FeatureTypeDTW::Features get_mfcc_features(const boost::shared_ptr<WM::AudioFileReader>& reader, 
-                                           WMAudioFilePreProcessInfo* reader_info) 
-{
+namespace {
+    
+    //Reads the trimmed and normalized signal of a file and calculates the 
+    //cepstra of all its packets, kNumMelCepstra per packet. Returns the 
+    //number of packets, zero if there are none or on errors.
+    size_t calculate_cepstra(const AudioFileReaderRef& reader, 
+                             WMAudioFilePreProcessInfo* reader_info,
+                             FloatScopedArray& cepstra)
+    {
+    
+        //This seems to be a pretty robust configuration, and is the same
+        //as we used in our Matlab prototype.
+    
+        static const size_t window_frame_size = 400;
+        static const Float64 sample_rate = 16000.0f;
+        static const float interval_time_duration = kMFCCIntervalTimeDuration;
+        static const float preemphasis_coefficient = 0.97f;
+        static const float min_frequency = 133.33f;
+        static const float max_frequency = 6855.6f;
 
-    FeatureTypeDTW::Features mfcc_features;
+        static const float normalized_amplitude = 0.9f;
     
-    //This seems to be a pretty robust configuration, and is the same
-    //as we used in our Matlab prototype.
+        WM::MFCCProcessor mp(window_frame_size, 
+                             preemphasis_coefficient, 
+                             (float)sample_rate, 
+                             min_frequency, 
+                             max_frequency);
     
-    static const size_t window_frame_size = 400;
-    static const Float64 sample_rate = 16000.0f;
-    static const float interval_time_duration = 0.01f;
-    static const float preemphasis_coefficient = 0.97f;
-    static const float min_frequency = 133.33f;
-    static const float max_frequency = 6855.6f;
-
-    static const float normalized_amplitude = 0.9f;
-    
-    WMAudioSampleType data[window_frame_size];
-    
-    WM::MFCCProcessor mp(window_frame_size, 
-                         preemphasis_coefficient, 
-                         (float)sample_rate, 
-                         min_frequency, 
-                         max_frequency);
+        static const size_t interval_frame_size = interval_time_duration * (size_t)sample_rate;
+        static const float window_time_duration = window_frame_size / (float)sample_rate;
+        static const int overlap_frame_size = window_frame_size - interval_frame_size;
     
-    std::fill(&data[0], &data[window_frame_size], 0);    
+        //sanity check
+        assert(window_frame_size > overlap_frame_size);
     
-    static const size_t interval_frame_size = interval_time_duration * (size_t)sample_rate;
-    static const float window_time_duration = window_frame_size / (float)sample_rate;
-    static const int overlap_frame_size = window_frame_size - interval_frame_size;
+        WMAudioFilePreProcessInfo info;
     
-    //sanity check
-    assert(window_frame_size > overlap_frame_size);
-    
-    WMAudioFilePreProcessInfo info;
-    
-    //Get trimming and normalization info
-    if (reader_info == NULL) {
+        //Get trimming and normalization info
+        if (reader_info == NULL) {
         
-        std::cout << "Warning: no pre process info was given, calculating it "
-                  << "using default values (-27db, -40db)." << std::endl;
+            std::cout << "Warning: no pre process info was given, calculating it "
+                      << "using default values (-27db, -40db)." << std::endl;
         
-        info = reader->preprocess(-27,
-                                  -40,
-                                  normalized_amplitude);
+            info = reader->preprocess(-27,
+                                      -40,
+                                      normalized_amplitude);
         
-    } else {
-        info = *reader_info;
-    }
+        } else {
+            info = *reader_info;
+        }
     
-    float duration = info.threshold_end_time - info.threshold_start_time;
-    if (duration <= 0) {
-        std::cout << "Error: thresholding yields negative duration." << std::endl;
-        return mfcc_features;
-    }
+        float duration = info.threshold_end_time - info.threshold_start_time;
+        if (duration <= 0) {
+            std::cout << "Error: thresholding yields negative duration." << std::endl;
+            return 0;
+        }
     
-    //Ensure that we are always reading full packages
-    if ((reader->duration() - info.threshold_end_time) < window_time_duration)
-        duration -= window_time_duration;
+        //Ensure that we are always reading full packages
+        if ((reader->duration() - info.threshold_end_time) < window_time_duration)
+            duration -= window_time_duration;
     
-    //Notice that we have to make sure that all packets have useful information, 
-    //therefore we clip the last incomplete package to read.
+        //Notice that we have to make sure that all packets have useful information, 
+        //therefore we clip the last incomplete package to read.
     
-    size_t num_packets = (size_t)(duration / interval_time_duration);    
+        size_t num_packets = (size_t)(duration / interval_time_duration);    
     
-    //Tmp buffer, as we want only the first few MFCC components...
-    WM::MFCCProcessor::CepstraBuffer cepstra;
-    cepstra.assign(0);
+        if (num_packets == 0)
+            return 0;
     
-    //Memorize the element which is going to be just left of the next
-    //packet to read. This is used by the preemphasis filter which otherwise
-    //would generate repeated spikes in the time-domain (as sample[0-1] would
-    //be zero for each packet).
-    float left_of_packet = .0f;
+        //Read all packets at once, each one starts interval_frame_size samples
+        //after the previous one.
+        size_t num_samples = (num_packets - 1) * interval_frame_size + window_frame_size;
+        FloatScopedArray signal(new WMAudioSampleType[num_samples]);
+        std::fill(&signal[0], &signal[num_samples], 0);
     
-    //Let's find the maximum amplitude in order to normalize the following
-    //processes
+        bool success = reader->read_floats(num_samples, signal.get(), info.threshold_start_time);
+        if (!success) {
+            std::cout << "Error: could not read samples." << std::endl;
+            return 0;
+        }
     
-    for (int iPacket = 0; iPacket < num_packets; ++iPacket) {
-        
-        size_t num_samples = window_frame_size;
-
-        std::fill(&data[0], &data[window_frame_size], 0);
-
-        float iteration_time = info.threshold_start_time + iPacket * interval_time_duration;
-
-        bool success = reader->read_floats(num_samples, data, iteration_time);
-        
-        if (num_samples != window_frame_size) {
+        if (mp.num_frames(num_samples, interval_frame_size) != num_packets) {
             std::cout << "Warning: could not retrieve a full package of samples.";
             std::cout << std::endl;
-            continue;
         }
-        
+    
         //scale to normalize
-        vDSP_vsmul(data, 1, 
-                   &info.normalization_factor, 
-                   data, 1, num_samples);
-
-        assert(success);
+        WM::DSP::scale(signal.get(), 1, 
+                       info.normalization_factor, 
+                       signal.get(), 1, num_samples);
+    
+        //The preemphasis filter of each packet uses the sample left of it, which
+        //avoids repeated spikes in the time-domain (as sample[0-1] would be zero
+        //for each packet).
+        const size_t num_frames = mp.num_frames(num_samples, interval_frame_size);
+        cepstra.reset(new float[num_frames * WM::MFCCProcessor::kNumMelCepstra()]);
+        mp.process_frames(signal.get(), 
+                          num_samples, 
+                          interval_frame_size, 
+                          0, 
+                          cepstra.get());
         
-        mp.process(data,
-                   left_of_packet,
-                   &cepstra);
+        return num_frames;
+    }
+    
+}
 
+/**
+ * Processes a complete file and returns a vector of MFCC features for DTW.
+ */
+FeatureTypeDTW::Features get_mfcc_features(const boost::shared_ptr<WM::AudioFileReader>& reader, 
+                                           WMAudioFilePreProcessInfo* reader_info) 
+{
 
+    FeatureTypeDTW::Features mfcc_features;
+    
+    FloatScopedArray cepstra;
+    const size_t num_frames = calculate_cepstra(reader, reader_info, cepstra);
+    mfcc_features.reserve(num_frames);
+    
+    for (size_t iPacket = 0; iPacket < num_frames; ++iPacket) {
+        
         //copy MFCC's 2th to 8th as our features (as in Matlab prototype)
+        const float* packet_cepstra = &cepstra[iPacket * WM::MFCCProcessor::kNumMelCepstra()];
         FeatureTypeDTW::FeatureVector mfcc_vector;
         const size_t offset = 1;
-        std::copy(&cepstra[offset], 
-                  &cepstra[offset + FeatureTypeDTW::feature_number_size], 
+        std::copy(&packet_cepstra[offset], 
+                  &packet_cepstra[offset + FeatureTypeDTW::feature_number_size], 
                   mfcc_vector.begin());
 
         mfcc_features.push_back(mfcc_vector);
-
-        left_of_packet = data[num_samples - overlap_frame_size - 1];
     }
     
     return mfcc_features;
 }
 
+FeatureTypeDeltaDTW::Features get_mfcc_delta_features(const AudioFileReaderRef& reader,
+                                                      WMAudioFilePreProcessInfo* reader_info,
+                                                      size_t delta_window)
+{
+    FeatureTypeDeltaDTW::Features delta_features;
+    
+    FloatScopedArray cepstra;
+    const size_t num_frames = calculate_cepstra(reader, reader_info, cepstra);
+    if (num_frames == 0)
+        return delta_features;
+    
+    //The same MFCC's as get_mfcc_features. Each frame is streamed through 
+    //the delta processor, which writes static values, deltas and 
+    //delta-deltas straight into the feature vectors.
+    WM::DeltaProcessor delta_processor(FeatureTypeDTW::feature_number_size, delta_window);
+    assert(delta_processor.output_size() == FeatureTypeDeltaDTW::feature_number_size);
+    
+    delta_features.resize(num_frames);
+    
+    const size_t offset = 1;
+    size_t num_written = 0;
+    for (size_t iPacket = 0; iPacket < num_frames; ++iPacket) {
+        
+        const float* packet_cepstra = &cepstra[iPacket * WM::MFCCProcessor::kNumMelCepstra()];
+        if (delta_processor.push(&packet_cepstra[offset], 
+                                 delta_features[num_written].c_array()))
+            ++num_written;
+    }
+    
+    num_written += delta_processor.flush(delta_features[num_written].c_array());
+    assert(num_written == num_frames);
+    
+    return delta_features;
+}
+
 
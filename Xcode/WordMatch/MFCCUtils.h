@@ -27,13 +27,49 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_array.hpp>
 #include "dtw.hpp"
+#include "dtw_distance.hpp"
+#include "dtw_engine.hpp"
+#include "template_search.hpp"
+#include "distance_matrix.hpp"
+#include "fast_dtw.hpp"
+#include "subsequence_dtw.hpp"
+#include "online_dtw.hpp"
+#include "hirschberg_dtw.hpp"
+#include "quantized_features.hpp"
+#include "barycenter_averaging.hpp"
 
 typedef boost::shared_ptr<WM::AudioFileReader> AudioFileReaderRef;
 typedef boost::scoped_array<float> FloatScopedArray;
 typedef boost::scoped_array<WMFeatureType> FeatureTypeArray;
 typedef simod1::DTW<WMFeatureType, 7> FeatureTypeDTW;
+//Static features, deltas and delta-deltas, see get_mfcc_delta_features
+typedef simod1::DTW<WMFeatureType, 21> FeatureTypeDeltaDTW;
+typedef simod1::DTWDistance<WMFeatureType, 7> FeatureTypeDTWDistance;
+typedef simod1::DTWEngine<WMFeatureType, 7> FeatureTypeDTWEngine;
+typedef simod1::TemplateSearch<WMFeatureType, 7> FeatureTypeTemplateSearch;
+typedef simod1::AllPairsDistances<WMFeatureType, 7> FeatureTypeAllPairsDistances;
+typedef simod1::FastDTW<WMFeatureType, 7> FeatureTypeFastDTW;
+typedef simod1::SubsequenceDTW<WMFeatureType, 7> FeatureTypeSubsequenceDTW;
+typedef simod1::OnlineDTW<WMFeatureType, 7> FeatureTypeOnlineDTW;
+typedef simod1::HirschbergDTW<WMFeatureType, 7> FeatureTypeHirschbergDTW;
+typedef simod1::QuantizedFeatures<WMFeatureType, 7, simod1::Int8Encoding<WMFeatureType, 7> > FeatureTypeInt8Features;
+typedef simod1::QuantizedFeatures<WMFeatureType, 7, simod1::Float16Encoding<WMFeatureType, 7> > FeatureTypeFloat16Features;
+typedef simod1::BarycenterAveraging<WMFeatureType, 7> FeatureTypeBarycenterAveraging;
+
+//Time in seconds between the beginnings of two consecutive feature vectors
+//returned by get_mfcc_features.
+const float kMFCCIntervalTimeDuration = 0.01f;
+
+//Number of frames on either side of a frame used for its deltas
+const size_t kMFCCDeltaWindow = 2;
 
 FeatureTypeDTW::Features get_mfcc_features(const AudioFileReaderRef& reader,
                                            WMAudioFilePreProcessInfo* reader_info = NULL);
 
+//Like get_mfcc_features, but each feature vector holds the 7 MFCC's followed
+//by their deltas and delta-deltas (see WM::DeltaProcessor).
+FeatureTypeDeltaDTW::Features get_mfcc_delta_features(const AudioFileReaderRef& reader,
+                                                      WMAudioFilePreProcessInfo* reader_info = NULL,
+                                                      size_t delta_window = kMFCCDeltaWindow);
+
 #endif //WORD_MATCH_MFCC_UTILS_H
\ No newline at end of file
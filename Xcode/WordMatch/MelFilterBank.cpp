@@ -20,10 +20,13 @@
 //THE SOFTWARE.
 
 #include "MelFilterBank.hpp"
+#include "TriangleFilter.hpp"
+#include "DSPBackend.hpp"
 
 #include <sstream>
 #include <stdexcept>
 #include <math.h>
+#include <iostream>
 
 using namespace WM;
 
@@ -83,6 +86,8 @@ MelFilterBank::MelFilterBank(float min_freq,
     
     // Fill up equidistant spacing in mel-space
     
+    band_offsets_.push_back(0);
+    
     float mel_left = mel_min;
     for (int i = 0; i<num_mel_bands_; i++) {
         
@@ -102,9 +107,11 @@ MelFilterBank::MelFilterBank(float min_freq,
         if (normalize_filter_area_)
             height = 2.0f / (right_bin - left_bin);
         
-        // Create the actual filter
-        TriangleFilterRef fltr( new TriangleFilter(left_bin, right_bin, height) );
-        filters_.push_back(fltr);
+        // Create the actual filter, and append its weights to the table
+        const TriangleFilter fltr(left_bin, right_bin, height);
+        weights_.insert(weights_.end(), fltr.data(), fltr.data() + fltr.size());
+        band_offsets_.push_back((int)weights_.size());
+        band_begins_.push_back(fltr.left_edge());
         
         //next left edge is current center
         mel_left = mel_center;
@@ -114,11 +121,34 @@ MelFilterBank::MelFilterBank(float min_freq,
 
 void MelFilterBank::apply(const float* fft_data, float* mel_bands) const {
     
-    //TODO: is dereferencing a smart pointer in here really necessary??
-    
     //we assume the caller passes arrays with appropriates sizes
-    for (int i = 0; i<num_mel_bands_; ++i)
-        mel_bands[i] = filters_[i]->apply(fft_data);
+    for (int i = 0; i<num_mel_bands_; ++i) {
+        mel_bands[i] = DSP::dot(&fft_data[band_begins_[i]], 
+                                &weights_[band_offsets_[i]], 
+                                band_offsets_[i+1] - band_offsets_[i]);
+    }
+    
+}
+
+void MelFilterBank::apply(const float* fft_data, 
+                          size_t num_frames, 
+                          size_t fft_stride, 
+                          float* mel_bands) const {
+    
+    if (num_frames == 0)
+        return;
+    
+    //Each band is the product of the spectra's columns it covers with its
+    //weights, written to every num_mel_bands_ th element of mel_bands.
+    for (int i = 0; i<num_mel_bands_; ++i) {
+        DSP::matrix_vector_multiply(num_frames,
+                                    band_offsets_[i+1] - band_offsets_[i],
+                                    &fft_data[band_begins_[i]],
+                                    fft_stride,
+                                    &weights_[band_offsets_[i]],
+                                    &mel_bands[i],
+                                    num_mel_bands_);
+    }
     
 }
 
@@ -138,11 +168,19 @@ float MelFilterBank::mel_to_hz(float mel) {
 void MelFilterBank::print() const {
 
     std::cout << "cpp_mel_filters = [";
-    for (int i =0; i<filters_.size(); ++i) {
+    for (int i =0; i<num_mel_bands_; ++i) {
         if (i != 0)
             std::cout << "; ";
         
-        std::cout << *filters_.at(i);
+        for (int bin = 0; bin<band_begins_[i]; ++bin) {
+            if (bin != 0)
+                std::cout << ", ";
+            std::cout << "0 ";
+        }
+        
+        for (int k = band_offsets_[i]; k<band_offsets_[i+1]; ++k) {
+            std::cout << ", " << weights_[k];        
+        }
     }
     
     std::cout << "]; " << std::endl << std::endl;
@@ -22,16 +22,18 @@
 #ifndef WORD_MATCH_MEL_FILTER_BANK_HPP
 #define WORD_MATCH_MEL_FILTER_BANK_HPP
 
-#include "TriangleFilter.hpp"
-
 #include <vector>
+#include <cstddef>
 
 namespace WM {
     
     /**
      * This class represents the filters necessary to warp an audio spectrum
      * into Mel-Frequency scaling. It is basically a collection of properly
-     * placed TriangleFilters.
+     * placed TriangleFilters. The weights of all triangles are stored in one
+     * contiguous table, band after band (compressed sparse rows), together 
+     * with the first bin of each band, so that filtering a spectrum touches
+     * no memory besides the table and the spectrum.
      */
     class MelFilterBank {
         
@@ -74,6 +76,22 @@ namespace WM {
          */
         void apply(const float* fft_data, float* mel_bands) const;
         
+        /**
+         * Applies all filters on a batch of spectra, band by band as a 
+         * sparse-dense matrix product over all of them.
+         * @param fft_data The spectra, the first at fft_data, each following
+         * one fft_stride elements after the previous one.
+         * @param num_frames The number of spectra.
+         * @param fft_stride The distance of two spectra in elements.
+         * @param mel_bands The caller is responsible that the passed array 
+         * accomodates at least num_frames * num_mel_bands elements. On output
+         * it holds the mel bands of spectrum f at mel_bands[f*num_mel_bands].
+         */
+        void apply(const float* fft_data, 
+                   size_t num_frames, 
+                   size_t fft_stride, 
+                   float* mel_bands) const;
+        
         /**
          * Utility function to convert HZ to Mel.
          */
@@ -99,8 +117,14 @@ namespace WM {
         int sample_rate_;
         const bool normalize_filter_area_;
         
-        typedef std::vector<TriangleFilterRef> TriangleFilterArray;
-        TriangleFilterArray filters_;
+        //Weights of all bands, band i occupies the elements 
+        //band_offsets_[i] .. band_offsets_[i+1]-1 and starts at the bin
+        //band_begins_[i]. The bands are not padded to aligned offsets: each
+        //is multiplied with the spectrum from an arbitrary bin on, so one
+        //operand of the dot product is unaligned in any case.
+        std::vector<float> weights_;
+        std::vector<int> band_offsets_;
+        std::vector<int> band_begins_;
         
     };
     
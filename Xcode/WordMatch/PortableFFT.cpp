@@ -0,0 +1,361 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#include "PortableFFT.hpp"
+#include "DSPBackend.hpp"
+
+#include <stdexcept>
+#include <sstream>
+#include <math.h>
+
+#ifdef WM_DSP_SIMD_SSE
+#  include <xmmintrin.h>
+#endif
+
+using namespace WM;
+
+// The real signal of N samples is transformed as a complex signal z of N/2
+// samples, z[n] = x[2n] + i*x[2n+1], by a recursive mixed-radix FFT
+// (decimation in time) with radices 4, 2, 3 and 5. The spectrum X of x 
+// follows from the spectrum Z of z,
+// 
+//      X[k] = 1/2 * (Z[k] + Z*[N/2-k]) - i/2 * W^k * (Z[k] - Z*[N/2-k]), 
+//
+// with W = exp(-2*pi*i/N).
+
+namespace {
+    
+    //The butterflies are written once for single floats and once more for
+    //SSE vectors, which process four consecutive bins at a time.
+    struct ScalarOps {
+        typedef float Vec;
+        static const size_t width = 1;
+        static Vec load(const float* p) { return *p; }
+        static void store(float* p, Vec v) { *p = v; }
+        static Vec set(float v) { return v; }
+        static Vec add(Vec a, Vec b) { return a + b; }
+        static Vec sub(Vec a, Vec b) { return a - b; }
+        static Vec mul(Vec a, Vec b) { return a * b; }
+    };
+    
+#ifdef WM_DSP_SIMD_SSE
+    struct SSEOps {
+        typedef __m128 Vec;
+        static const size_t width = 4;
+        static Vec load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+        static Vec set(float v) { return _mm_set1_ps(v); }
+        static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+        static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+        static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    };
+#endif
+    
+    // Combines the sub-transforms at real/imag + r*sub_size into the outputs
+    // k + q*sub_size for the Ops::width bins starting at k.
+    template <class Ops>
+    void radix_butterflies(size_t radix,
+                           size_t sub_size,
+                           size_t k,
+                           const float* twiddle_real,
+                           const float* twiddle_imag,
+                           float* real,
+                           float* imag)
+    {
+        typedef typename Ops::Vec Vec;
+        
+        // t_r = W^(r*k) * Y_r[k]
+        Vec t_re[5];
+        Vec t_im[5];
+        t_re[0] = Ops::load(&real[k]);
+        t_im[0] = Ops::load(&imag[k]);
+        for (size_t r = 1; r < radix; ++r) {
+            const Vec y_re = Ops::load(&real[r*sub_size + k]);
+            const Vec y_im = Ops::load(&imag[r*sub_size + k]);
+            const Vec w_re = Ops::load(&twiddle_real[(r-1)*sub_size + k]);
+            const Vec w_im = Ops::load(&twiddle_imag[(r-1)*sub_size + k]);
+            t_re[r] = Ops::sub(Ops::mul(w_re, y_re), Ops::mul(w_im, y_im));
+            t_im[r] = Ops::add(Ops::mul(w_re, y_im), Ops::mul(w_im, y_re));
+        }
+        
+        // a radix point DFT over t
+        Vec x_re[5];
+        Vec x_im[5];
+        
+        switch (radix) {
+            case 2: {
+                x_re[0] = Ops::add(t_re[0], t_re[1]);
+                x_im[0] = Ops::add(t_im[0], t_im[1]);
+                x_re[1] = Ops::sub(t_re[0], t_re[1]);
+                x_im[1] = Ops::sub(t_im[0], t_im[1]);
+                break;
+            }
+            case 3: {
+                // X1,2 = t0 - (t1+t2)/2 -/+ i*sin(pi/3)*(t1-t2)
+                const Vec half = Ops::set(0.5f);
+                const Vec sin60 = Ops::set(0.866025403784f);
+                const Vec s_re = Ops::add(t_re[1], t_re[2]);
+                const Vec s_im = Ops::add(t_im[1], t_im[2]);
+                const Vec d_re = Ops::mul(sin60, Ops::sub(t_re[1], t_re[2]));
+                const Vec d_im = Ops::mul(sin60, Ops::sub(t_im[1], t_im[2]));
+                const Vec m_re = Ops::sub(t_re[0], Ops::mul(half, s_re));
+                const Vec m_im = Ops::sub(t_im[0], Ops::mul(half, s_im));
+                x_re[0] = Ops::add(t_re[0], s_re);
+                x_im[0] = Ops::add(t_im[0], s_im);
+                x_re[1] = Ops::add(m_re, d_im);
+                x_im[1] = Ops::sub(m_im, d_re);
+                x_re[2] = Ops::sub(m_re, d_im);
+                x_im[2] = Ops::add(m_im, d_re);
+                break;
+            }
+            case 4: {
+                const Vec a0_re = Ops::add(t_re[0], t_re[2]);
+                const Vec a0_im = Ops::add(t_im[0], t_im[2]);
+                const Vec a1_re = Ops::sub(t_re[0], t_re[2]);
+                const Vec a1_im = Ops::sub(t_im[0], t_im[2]);
+                const Vec a2_re = Ops::add(t_re[1], t_re[3]);
+                const Vec a2_im = Ops::add(t_im[1], t_im[3]);
+                const Vec a3_re = Ops::sub(t_re[1], t_re[3]);
+                const Vec a3_im = Ops::sub(t_im[1], t_im[3]);
+                x_re[0] = Ops::add(a0_re, a2_re);
+                x_im[0] = Ops::add(a0_im, a2_im);
+                x_re[2] = Ops::sub(a0_re, a2_re);
+                x_im[2] = Ops::sub(a0_im, a2_im);
+                // X1 = a1 - i*a3, X3 = a1 + i*a3
+                x_re[1] = Ops::add(a1_re, a3_im);
+                x_im[1] = Ops::sub(a1_im, a3_re);
+                x_re[3] = Ops::sub(a1_re, a3_im);
+                x_im[3] = Ops::add(a1_im, a3_re);
+                break;
+            }
+            default: {
+                // radix 5, with c_j = cos(2*pi*j/5) and s_j = sin(2*pi*j/5)
+                const Vec c1 = Ops::set(0.309016994375f);
+                const Vec c2 = Ops::set(-0.809016994375f);
+                const Vec s1 = Ops::set(0.951056516295f);
+                const Vec s2 = Ops::set(0.587785252292f);
+                const Vec p1_re = Ops::add(t_re[1], t_re[4]);
+                const Vec p1_im = Ops::add(t_im[1], t_im[4]);
+                const Vec m1_re = Ops::sub(t_re[1], t_re[4]);
+                const Vec m1_im = Ops::sub(t_im[1], t_im[4]);
+                const Vec p2_re = Ops::add(t_re[2], t_re[3]);
+                const Vec p2_im = Ops::add(t_im[2], t_im[3]);
+                const Vec m2_re = Ops::sub(t_re[2], t_re[3]);
+                const Vec m2_im = Ops::sub(t_im[2], t_im[3]);
+                x_re[0] = Ops::add(t_re[0], Ops::add(p1_re, p2_re));
+                x_im[0] = Ops::add(t_im[0], Ops::add(p1_im, p2_im));
+                // X1,4 = A1 -/+ i*B1 and X2,3 = A2 -/+ i*B2
+                const Vec a1_re = Ops::add(t_re[0], Ops::add(Ops::mul(c1, p1_re), Ops::mul(c2, p2_re)));
+                const Vec a1_im = Ops::add(t_im[0], Ops::add(Ops::mul(c1, p1_im), Ops::mul(c2, p2_im)));
+                const Vec a2_re = Ops::add(t_re[0], Ops::add(Ops::mul(c2, p1_re), Ops::mul(c1, p2_re)));
+                const Vec a2_im = Ops::add(t_im[0], Ops::add(Ops::mul(c2, p1_im), Ops::mul(c1, p2_im)));
+                const Vec b1_re = Ops::add(Ops::mul(s1, m1_re), Ops::mul(s2, m2_re));
+                const Vec b1_im = Ops::add(Ops::mul(s1, m1_im), Ops::mul(s2, m2_im));
+                const Vec b2_re = Ops::sub(Ops::mul(s2, m1_re), Ops::mul(s1, m2_re));
+                const Vec b2_im = Ops::sub(Ops::mul(s2, m1_im), Ops::mul(s1, m2_im));
+                x_re[1] = Ops::add(a1_re, b1_im);
+                x_im[1] = Ops::sub(a1_im, b1_re);
+                x_re[4] = Ops::sub(a1_re, b1_im);
+                x_im[4] = Ops::add(a1_im, b1_re);
+                x_re[2] = Ops::add(a2_re, b2_im);
+                x_im[2] = Ops::sub(a2_im, b2_re);
+                x_re[3] = Ops::sub(a2_re, b2_im);
+                x_im[3] = Ops::add(a2_im, b2_re);
+                break;
+            }
+        }
+        
+        for (size_t q = 0; q < radix; ++q) {
+            Ops::store(&real[q*sub_size + k], x_re[q]);
+            Ops::store(&imag[q*sub_size + k], x_im[q]);
+        }
+    }
+    
+#ifdef WM_DSP_SIMD_SSE
+    inline __m128 reverse(__m128 v) {
+        return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+#endif
+    
+}
+
+DSP::PortableRealFFT::PortableRealFFT(size_t size) :
+    size_(size),
+    size_half_(size/2)
+{
+    if (!is_fft_size(size)) {
+        std::ostringstream oss;
+        oss << "FFT size is not supported: size='" << size << "'. The size "
+            << "has to be even, at least 4, and half of it must not have other "
+            << "prime factors than 2, 3 and 5.";
+        throw std::invalid_argument(oss.str());
+    }
+    
+    //factorize, larger radices first
+    size_t sub_size = size_half_;
+    static const size_t radices[] = { 4, 2, 3, 5 };
+    for (size_t i = 0; i < 4; ++i) {
+        while (sub_size % radices[i] == 0) {
+            Stage stage;
+            stage.radix = radices[i];
+            stage.sub_size = sub_size / radices[i];
+            stage.twiddle_offset = twiddle_real_.size();
+            
+            for (size_t r = 1; r < stage.radix; ++r) {
+                for (size_t k = 0; k < stage.sub_size; ++k) {
+                    const double angle = -2.0 * M_PI * (double)(r*k) / (double)sub_size;
+                    twiddle_real_.push_back((float)cos(angle));
+                    twiddle_imag_.push_back((float)sin(angle));
+                }
+            }
+            
+            stages_.push_back(stage);
+            sub_size = stage.sub_size;
+        }
+    }
+    
+    split_real_.resize(size_half_);
+    split_imag_.resize(size_half_);
+    for (size_t k = 0; k < size_half_; ++k) {
+        const double angle = -2.0 * M_PI * (double)k / (double)size;
+        split_real_[k] = (float)cos(angle);
+        split_imag_[k] = (float)sin(angle);
+    }
+    
+    real_part_.resize(size_half_);
+    imag_part_.resize(size_half_);
+}
+
+void DSP::PortableRealFFT::transform(const float* signal, 
+                                     size_t stride, 
+                                     size_t first_stage, 
+                                     float* out_real, 
+                                     float* out_imag)
+{
+    const Stage& stage = stages_[first_stage];
+    
+    if (stage.sub_size == 1) {
+        // transforms of a single complex sample, i.e. a pair of real ones
+        for (size_t r = 0; r < stage.radix; ++r) {
+            out_real[r] = signal[2*r*stride];
+            out_imag[r] = signal[2*r*stride + 1];
+        }
+    } else {
+        // the sub-transforms of every radix th sample, starting at r
+        for (size_t r = 0; r < stage.radix; ++r) {
+            transform(&signal[2*r*stride], 
+                      stride*stage.radix, 
+                      first_stage + 1, 
+                      &out_real[r*stage.sub_size], 
+                      &out_imag[r*stage.sub_size]);
+        }
+    }
+    
+    butterflies(stage, out_real, out_imag);
+}
+
+void DSP::PortableRealFFT::butterflies(const Stage& stage, float* real, float* imag)
+{
+    const float* twiddle_real = &twiddle_real_[0] + stage.twiddle_offset;
+    const float* twiddle_imag = &twiddle_imag_[0] + stage.twiddle_offset;
+    
+    size_t k = 0;
+#ifdef WM_DSP_SIMD_SSE
+    for (; k + SSEOps::width <= stage.sub_size; k += SSEOps::width) {
+        radix_butterflies<SSEOps>(stage.radix, stage.sub_size, k, 
+                                  twiddle_real, twiddle_imag, real, imag);
+    }
+#endif
+    for (; k < stage.sub_size; ++k) {
+        radix_butterflies<ScalarOps>(stage.radix, stage.sub_size, k, 
+                                     twiddle_real, twiddle_imag, real, imag);
+    }
+}
+
+void DSP::PortableRealFFT::magnitudes(const float* signal, float* magnitudes)
+{
+    spectrum(signal, magnitudes, false);
+}
+
+void DSP::PortableRealFFT::power_spectrum(const float* signal, float* power)
+{
+    spectrum(signal, power, true);
+}
+
+void DSP::PortableRealFFT::spectrum(const float* signal, float* out, bool squared)
+{
+    const size_t size_half = size_half_;
+    float* re = &real_part_[0];
+    float* im = &imag_part_[0];
+    
+    transform(signal, 1, 0, re, im);
+    
+    // separate the spectrum of the real signal. DC and nyquist are both real
+    // and share the first bin.
+    const float dc = re[0] + im[0];
+    const float nyquist = re[0] - im[0];
+    out[0] = dc*dc + nyquist*nyquist;
+    if (!squared)
+        out[0] = sqrtf(out[0]);
+    
+    const float* w_re = &split_real_[0];
+    const float* w_im = &split_imag_[0];
+    
+    size_t k = 1;
+#ifdef WM_DSP_SIMD_SSE
+    const __m128 half4 = _mm_set1_ps(0.5f);
+    for (; k + 4 <= size_half; k += 4) {
+        // Z[k] and Z*[N/2-k] 
+        const __m128 z_re = _mm_loadu_ps(&re[k]);
+        const __m128 z_im = _mm_loadu_ps(&im[k]);
+        const __m128 c_re = reverse(_mm_loadu_ps(&re[size_half - k - 3]));
+        const __m128 c_im = _mm_sub_ps(_mm_setzero_ps(), 
+                                       reverse(_mm_loadu_ps(&im[size_half - k - 3])));
+        const __m128 e_re = _mm_add_ps(z_re, c_re);
+        const __m128 e_im = _mm_add_ps(z_im, c_im);
+        const __m128 o_re = _mm_sub_ps(z_re, c_re);
+        const __m128 o_im = _mm_sub_ps(z_im, c_im);
+        // -i * W^k * o
+        const __m128 wk_re = _mm_loadu_ps(&w_re[k]);
+        const __m128 wk_im = _mm_loadu_ps(&w_im[k]);
+        const __m128 p_re = _mm_add_ps(_mm_mul_ps(wk_re, o_im), _mm_mul_ps(wk_im, o_re));
+        const __m128 p_im = _mm_sub_ps(_mm_mul_ps(wk_im, o_im), _mm_mul_ps(wk_re, o_re));
+        const __m128 x_re = _mm_mul_ps(half4, _mm_add_ps(e_re, p_re));
+        const __m128 x_im = _mm_mul_ps(half4, _mm_add_ps(e_im, p_im));
+        const __m128 power = _mm_add_ps(_mm_mul_ps(x_re, x_re), _mm_mul_ps(x_im, x_im));
+        _mm_storeu_ps(&out[k], squared ? power : _mm_sqrt_ps(power));
+    }
+#endif
+    for (; k < size_half; ++k) {
+        const float c_re = re[size_half - k];
+        const float c_im = -im[size_half - k];
+        const float e_re = re[k] + c_re;
+        const float e_im = im[k] + c_im;
+        const float o_re = re[k] - c_re;
+        const float o_im = im[k] - c_im;
+        const float p_re = w_re[k] * o_im + w_im[k] * o_re;
+        const float p_im = w_im[k] * o_im - w_re[k] * o_re;
+        const float x_re = 0.5f * (e_re + p_re);
+        const float x_im = 0.5f * (e_im + p_im);
+        const float power = x_re*x_re + x_im*x_im;
+        out[k] = squared ? power : sqrtf(power);
+    }
+}
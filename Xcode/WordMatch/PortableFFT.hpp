@@ -0,0 +1,107 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#ifndef WORD_MATCH_PORTABLE_FFT_HPP
+#define WORD_MATCH_PORTABLE_FFT_HPP
+
+#include <boost/utility.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace WM {
+    
+    namespace DSP {
+        
+        /**
+         * A self-contained mixed-radix implementation of RealFFT. It is the 
+         * FFT of the portable backend, and the vDSP backend uses it for sizes
+         * that are not powers of two.
+         */
+        class PortableRealFFT : boost::noncopyable {
+            
+        public:
+            
+            /**
+             * Creates a new PortableRealFFT.
+             * @param size The number of samples of a signal, see is_fft_size.
+             * Throws std::invalid_argument otherwise.
+             */
+            explicit PortableRealFFT(size_t size);
+            
+            size_t size() const { return size_; }
+            
+            /**
+             * See RealFFT::magnitudes.
+             */
+            void magnitudes(const float* signal, float* magnitudes);
+            
+            /**
+             * See RealFFT::power_spectrum.
+             */
+            void power_spectrum(const float* signal, float* power);
+            
+        private:
+            
+            //One pass of the transform, combining radix transforms of 
+            //sub_size samples each into transforms of radix*sub_size samples
+            struct Stage {
+                size_t radix;
+                size_t sub_size;
+                //Offset of the stage's twiddle factors, 
+                //exp(-2*pi*i*r*k / (radix*sub_size)) for r = 1 .. radix-1 and
+                //k = 0 .. sub_size-1 (in this order)
+                size_t twiddle_offset;
+            };
+            
+            void transform(const float* signal, size_t stride, size_t first_stage, 
+                           float* out_real, float* out_imag);
+            
+            void butterflies(const Stage& stage, float* real, float* imag);
+            
+            //Transforms the signal and writes the squared magnitudes of the 
+            //bins to out, or the magnitudes unless squared is set
+            void spectrum(const float* signal, float* out, bool squared);
+            
+            const size_t size_;
+            const size_t size_half_;
+            
+            std::vector<Stage> stages_;
+            
+            std::vector<float> twiddle_real_;
+            std::vector<float> twiddle_imag_;
+            
+            //W^k for k = 0 .. size/2-1 to separate the spectrum of the real 
+            //signal
+            std::vector<float> split_real_;
+            std::vector<float> split_imag_;
+            
+            //The spectrum of the complex signal
+            std::vector<float> real_part_;
+            std::vector<float> imag_part_;
+            
+        };
+        
+    }
+    
+}
+
+#endif //WORD_MATCH_PORTABLE_FFT_HPP
@@ -21,7 +21,7 @@
 
 #include "TriangleFilter.hpp"
 
-#include <Accelerate/Accelerate.h>
+#include "DSPBackend.hpp"
 
 #include <sstream>
 #include <stdexcept>
@@ -56,21 +56,18 @@ TriangleFilter::TriangleFilter(int left_edge, int right_edge, float height) :
     // left rising part with positive slope, without setting center
     int left_side_length = (center - left_edge);
     float left_dx = height / left_side_length;
-    float zero = 0;
-    vDSP_vramp(&zero, 
-               &left_dx, 
-               filter_data_.get(), 
-               1, 
-               left_side_length);    
+    DSP::ramp(0, 
+              left_dx, 
+              filter_data_.get(), 
+              left_side_length);    
     
     // right falling part with negative slope, also setting center
     int right_side_length = right_edge - center;
     float right_dx = - height / right_side_length;
-    vDSP_vramp(&height, 
-               &right_dx, 
-               &filter_data_.get()[size_-right_side_length-1], 
-               1, 
-               right_side_length+1);
+    DSP::ramp(height, 
+              right_dx, 
+              &filter_data_.get()[size_-right_side_length-1], 
+              right_side_length+1);
     
 }
 
@@ -81,15 +78,9 @@ float TriangleFilter::apply(const float* buffer) {
     //we can simply apply the filter as the dot product with the sample buffer
     //within its range
     
-    float result = 0;
-    vDSP_dotpr(&buffer[left_edge_], 
-               1, 
-               filter_data_.get(), 
-               1, 
-               &result, 
-               size_);
-    
-    return result;
+    return DSP::dot(&buffer[left_edge_], 
+                    filter_data_.get(), 
+                    size_);
     
 }
 
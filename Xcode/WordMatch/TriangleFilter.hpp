@@ -71,6 +71,22 @@ namespace WM {
          */
         float apply(const float* buffer);
         
+        /**
+         * @return The index of the left edge of the triangle.
+         */
+        int left_edge() const { return left_edge_; }
+        
+        /**
+         * @return The number of weights of the triangle, i.e. it covers the 
+         * indices left_edge .. left_edge + size - 1.
+         */
+        int size() const { return size_; }
+        
+        /**
+         * @return The weights of the triangle, size() elements.
+         */
+        const float* data() const { return filter_data_.get(); }
+        
         /**
          * Used for debugging purposes.
          */
@@ -24,8 +24,12 @@
 
 #include <algorithm>
 #include <stdexcept>
+#include <vector>
+#include <math.h>
 
 #include "TriangleFilter.hpp"
+#include "MelFilterBank.hpp"
+#include "DSPBackend.hpp"
 
 #include <iostream>
 
@@ -44,7 +48,7 @@ BOOST_AUTO_TEST_CASE(ImpulseTest) {
     
     // define an impulse and apply triangle filter
     FloatScopedArray arr(new float[100]);
-    vDSP_vclr(arr.get(), 1, 100);
+    DSP::clear(arr.get(), 100);
     
     // set one dirac impulse at idx  = 10
     arr[10] = 1.0f;
@@ -145,4 +149,35 @@ BOOST_AUTO_TEST_CASE(JunkInput) {
     
 }
 
+/**
+ * The filter bank keeps all triangles in one table. Filtering single spectra
+ * and a batch of spectra must agree.
+ */
+BOOST_AUTO_TEST_CASE(MelFilterBankTest) {
+    
+    const int num_bands = 40;
+    const int num_bins = 256;
+    const int num_frames = 3;
+    const int stride = 300;
+    
+    MelFilterBank bank(133.33f, 6855.6f, num_bands, num_bins, 16000);
+    
+    std::vector<float> spectra(num_frames*stride);
+    for (int i = 0; i<num_frames*stride; ++i)
+        spectra[i] = 1.0f + 0.5f*sinf(0.1f*i);
+    
+    std::vector<float> batch_bands(num_frames*num_bands);
+    bank.apply(&spectra[0], num_frames, stride, &batch_bands[0]);
+    
+    std::vector<float> bands(num_bands);
+    for (int f = 0; f<num_frames; ++f) {
+        
+        bank.apply(&spectra[f*stride], &bands[0]);
+        
+        for (int i = 0; i<num_bands; ++i)
+            BOOST_CHECK_CLOSE(batch_bands[f*num_bands + i], bands[i], 0.01);
+    }
+    
+}
+
 BOOST_AUTO_TEST_SUITE_END()
\ No newline at end of file
@@ -22,6 +22,15 @@
 #ifndef WORD_MATCH_TYPES_H
 #define WORD_MATCH_TYPES_H
 
+//On Mac OS X and iOS the MacTypes come with the prefix header
+#ifndef __APPLE__
+#include <stddef.h>
+#include <stdint.h>
+typedef double Float64;
+typedef int16_t SInt16;
+typedef uint32_t UInt32;
+#endif
+
 typedef float WMAudioSampleType;
 typedef float WMFeatureType;
 
@@ -77,4 +86,50 @@ typedef SInt16 WMSessionResult;
 
 typedef struct opaqueWMSession* WMSessionRef;
 
+
+enum {
+    kWMTemplateIndexResultOK = 0,
+    kWMTemplateIndexResultErrorGeneric = 1,
+    kWMTemplateIndexResultErrorInvalidArgument = 2,
+    kWMTemplateIndexResultErrorUnknownID = 3
+};
+
+typedef SInt16 WMTemplateIndexResult;
+
+/**
+ * Identifies a template within a WMTemplateIndex. IDs are never reused during
+ * the lifetime of an index.
+ */
+typedef UInt32 WMTemplateID;
+
+/**
+ * One result of a query against a WMTemplateIndex.
+ *
+ * template_id : The ID that was returned when the template was inserted.
+ * distance : The DTW distance between the query and the template.
+ */
+typedef struct WMTemplateMatch {
+    
+    WMTemplateID template_id;
+    WMFeatureType distance;
+    
+} WMTemplateMatch;
+
+typedef struct opaqueWMTemplateIndex* WMTemplateIndexRef;
+
+/**
+ * The location of a word found within a longer audio file.
+ *
+ * start_time : The time within the file where the word begins, in seconds.
+ * end_time : The time within the file where the word ends, in seconds.
+ * distance : The DTW distance between the word and this part of the file.
+ */
+typedef struct WMWordLocation {
+    
+    float start_time;
+    float end_time;
+    WMFeatureType distance;
+    
+} WMWordLocation;
+
 #endif //WORD_MATCH_TYPES_H
\ No newline at end of file
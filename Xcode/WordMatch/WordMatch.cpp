@@ -30,12 +30,16 @@
 
 #include <stdexcept>
 #include <iostream>
+#include <limits>
+#include <vector>
+#include <algorithm>
 
-extern "C" bool WMGetMinDistanceForFile(CFURLRef file_a,
-                                        CFURLRef file_b,
-                                        WMFeatureType* min_distance,
-                                        WMAudioFilePreProcessInfo* file_a_info,
-                                        WMAudioFilePreProcessInfo* file_b_info)
+extern "C" bool WMGetMinDistanceForFileWithThreshold(CFURLRef file_a,
+                                                     CFURLRef file_b,
+                                                     WMFeatureType threshold,
+                                                     WMFeatureType* min_distance,
+                                                     WMAudioFilePreProcessInfo* file_a_info,
+                                                     WMAudioFilePreProcessInfo* file_b_info)
 {
     
     if (min_distance == NULL)
@@ -52,7 +56,9 @@ extern "C" bool WMGetMinDistanceForFile(CFURLRef file_a,
         FeatureTypeDTW::Features mfcc_features_b = get_mfcc_features(reader_b, 
                                                                      file_b_info);        
         
-        FeatureTypeDTW dtw(mfcc_features_a, mfcc_features_b, 20);    
+        //We only need the distance, not the alignment path. The calculation
+        //stops early if the distance is known to exceed the threshold.
+        FeatureTypeDTWDistance dtw(mfcc_features_a, mfcc_features_b, 20, threshold);
         
         *min_distance = dtw.minimum_distance();
   
@@ -75,6 +81,111 @@ extern "C" bool WMGetMinDistanceForFile(CFURLRef file_a,
     
 }
 
+extern "C" bool WMGetMinDistanceForFile(CFURLRef file_a,
+                                        CFURLRef file_b,
+                                        WMFeatureType* min_distance,
+                                        WMAudioFilePreProcessInfo* file_a_info,
+                                        WMAudioFilePreProcessInfo* file_b_info)
+{
+    
+    return WMGetMinDistanceForFileWithThreshold(file_a,
+                                                file_b,
+                                                std::numeric_limits<WMFeatureType>::infinity(),
+                                                min_distance,
+                                                file_a_info,
+                                                file_b_info);
+    
+}
+
+namespace {
+    
+    bool closer_location(const WMWordLocation& a, const WMWordLocation& b)
+    {
+        return a.distance < b.distance;
+    }
+    
+    bool earlier_location(const WMWordLocation& a, const WMWordLocation& b)
+    {
+        return a.start_time < b.start_time;
+    }
+    
+}
+
+extern "C" bool WMFindWordInFile(CFURLRef word_file,
+                                 WMAudioFilePreProcessInfo* word_info,
+                                 CFURLRef file,
+                                 WMAudioFilePreProcessInfo* file_info,
+                                 WMFeatureType threshold,
+                                 WMWordLocation* locations_out,
+                                 size_t max_locations,
+                                 size_t* num_locations_out)
+{
+    
+    if ( (locations_out == NULL) || (num_locations_out == NULL) )
+        return false;
+    
+    try {
+        
+        AudioFileReaderRef word_reader(new WM::AudioFileReader(word_file));
+        AudioFileReaderRef reader(new WM::AudioFileReader(file));
+        
+        //We need to know where the features of the file begin in order to 
+        //convert frames to times. These are the same default values 
+        //get_mfcc_features uses.
+        WMAudioFilePreProcessInfo info;
+        if (file_info != NULL)
+            info = *file_info;
+        else
+            info = reader->preprocess(-27, -40, 0.9f);
+        
+        FeatureTypeDTW::Features word_features = get_mfcc_features(word_reader,
+                                                                   word_info);
+        
+        FeatureTypeDTW::Features features = get_mfcc_features(reader, &info);
+        
+        FeatureTypeSubsequenceDTW search(word_features, features, threshold);
+        
+        std::vector<WMWordLocation> locations;
+        for (size_t i = 0; i < search.matches().size(); ++i) {
+            const FeatureTypeSubsequenceDTW::Match& match = search.matches()[i];
+            WMWordLocation location;
+            location.start_time = info.threshold_start_time + 
+                                  match.first * kMFCCIntervalTimeDuration;
+            location.end_time = info.threshold_start_time + 
+                                (match.last + 1) * kMFCCIntervalTimeDuration;
+            location.distance = match.distance;
+            locations.push_back(location);
+        }
+        
+        //Keep the best locations if there are too many
+        if (locations.size() > max_locations) {
+            std::stable_sort(locations.begin(), locations.end(), closer_location);
+            locations.resize(max_locations);
+            std::sort(locations.begin(), locations.end(), earlier_location);
+        }
+        
+        std::copy(locations.begin(), locations.end(), locations_out);
+        *num_locations_out = locations.size();
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Exception during word search: " << e.what() 
+                  << std::endl;
+        
+        return false;
+        
+    } catch (...) {
+        //Note: a C++ exception must not leave the C/C++ realm. Objective-C
+        //exception model is completely different.
+        std::cerr << "Unknown exception caught." << std::endl;
+        
+        return false;
+    }
+    
+    return true;
+    
+}
+
 extern "C" bool WMGetPreProcessInfoForFile(CFURLRef file, 
                                 float begin_threshold_db,
                                 float end_threshold_db,
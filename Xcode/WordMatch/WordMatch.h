@@ -29,6 +29,7 @@
 #include "Types.h"
 
 #include "WordMatchSession.h"
+#include "WordMatchTemplateIndex.h"
 
 #include <CoreAudio/CoreAudioTypes.h>
 
@@ -43,6 +44,44 @@ bool WMGetMinDistanceForFile(CFURLRef file_a,
                              WMAudioFilePreProcessInfo* file_a_info,
                              WMAudioFilePreProcessInfo* file_b_info);
 
+/**
+ * Same as WMGetMinDistanceForFile, but stops comparing the two files as soon 
+ * as their distance is known to be greater than threshold. In that case 
+ * distance is set to infinity. Otherwise distance is exactly the value that
+ * WMGetMinDistanceForFile returns. Use this if all distances above some
+ * value are treated the same, e.g. as a mismatch.
+ */
+bool WMGetMinDistanceForFileWithThreshold(CFURLRef file_a,
+                                          CFURLRef file_b,
+                                          WMFeatureType threshold,
+                                          WMFeatureType* distance,
+                                          WMAudioFilePreProcessInfo* file_a_info,
+                                          WMAudioFilePreProcessInfo* file_b_info);
+
+/**
+ * Finds all occurrences of a spoken word within a longer audio file in a
+ * single pass over the file. The word should be trimmed, i.e. use 
+ * WMGetPreProcessInfoForFile for it before and pass the result to word_info.
+ * The long file does not need to be trimmed, pass NULL for file_info to use
+ * default values.
+ * @param threshold Only locations with a distance below threshold are
+ * reported. Overlapping locations are reported only once, with the smallest 
+ * distance.
+ * @param locations_out A pointer to an array of at least max_locations
+ * elements. On return it holds the locations ordered by start time. If there
+ * are more than max_locations locations, the ones with the smallest distance
+ * are returned.
+ * @param num_locations_out The number of locations written to locations_out.
+ */
+bool WMFindWordInFile(CFURLRef word_file,
+                      WMAudioFilePreProcessInfo* word_info,
+                      CFURLRef file,
+                      WMAudioFilePreProcessInfo* file_info,
+                      WMFeatureType threshold,
+                      WMWordLocation* locations_out,
+                      size_t max_locations,
+                      size_t* num_locations_out);
+
 /**
  * Processes a given file, and returns a structure on output that contains
  * additional data about the recorded sound.
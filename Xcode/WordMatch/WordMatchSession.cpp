@@ -21,9 +21,11 @@
 #include "Types.h"
 #include <CoreMedia/CMSampleBuffer.h>
 #include "MFCCProcessor.hpp"
+#include "DeltaProcessor.hpp"
 #include "CAStreamBasicDescription.h"
 #include <stdexcept>
 #include <algorithm>
+#include <iostream>
 #include <Accelerate/Accelerate.h>
 
 struct opaqueWMSession {
@@ -37,6 +39,11 @@ struct opaqueWMSession {
     size_t num_of_features_set;
     size_t num_read_samples;
     WM::MFCCProcessor* mfcc_processor;
+    //Deltas are only calculated if the session was created with them, 
+    //delta_data holds the output of delta_processor for each feature.
+    WM::DeltaProcessor* delta_processor;
+    float* delta_data;
+    size_t num_of_delta_features_set;
     float *overlap_buffer;
     float preemph_border;
     size_t num_of_overlap_samples;
@@ -50,6 +57,9 @@ struct opaqueWMSession {
                         num_of_features_set(0),
                         num_read_samples(0),
                         mfcc_processor(NULL),
+                        delta_processor(NULL),
+                        delta_data(NULL),
+                        num_of_delta_features_set(0),
                         overlap_buffer(NULL),
                         preemph_border(0),
                         num_of_overlap_samples(0),
@@ -73,6 +83,16 @@ void cleanup_session(opaqueWMSession* session) {
         session->mfcc_processor = NULL;
     }
     
+    if (session->delta_processor != NULL) {
+        delete session->delta_processor;
+        session->delta_processor = NULL;
+    }
+    
+    if (session->delta_data != NULL) {
+        delete[] session->delta_data;
+        session->delta_data = NULL;
+    }
+    
     if (session->non_interleaved_stereo_buffer != NULL) {
         free(session->non_interleaved_stereo_buffer->mBuffers[0].mData);
         free(session->non_interleaved_stereo_buffer->mBuffers[1].mData); 
@@ -88,9 +108,11 @@ void cleanup_session(opaqueWMSession* session) {
     delete session;
 }
 
-extern "C" WMSessionResult WMSessionCreate(float session_duration,
-                                           WMMfccConfiguration mfcc_configuration,
-                                           WMSessionRef* session_out)
+//Creates a session, which calculates deltas unless delta_window is zero
+WMSessionResult create_session(float session_duration,
+                               WMMfccConfiguration mfcc_configuration,
+                               size_t delta_window,
+                               WMSessionRef* session_out)
 {
     if (session_duration <= 0)
         return kWMSessionResultErrorInvalidArgument;
@@ -134,6 +156,14 @@ extern "C" WMSessionResult WMSessionCreate(float session_duration,
                   1, 
                   num_mfcc_values_expected);
         
+        if (delta_window != 0) {
+            new_session->delta_processor = 
+                new WM::DeltaProcessor(kWMSessionNumberOfMFCCs, delta_window);
+            new_session->delta_data = 
+                new float[new_session->num_of_features_expected * 
+                          new_session->delta_processor->output_size()];
+        }
+        
         // Note that the upper-bound size of hop_size * 3 results from the worst 
         // case scenario for the overlap where would have to use the tmp buffer 
         // to cover overlap mfcc extraction for two times. That of course is
@@ -159,6 +189,27 @@ extern "C" WMSessionResult WMSessionCreate(float session_duration,
     return kWMSessionResultOK;
 }
 
+extern "C" WMSessionResult WMSessionCreate(float session_duration,
+                                           WMMfccConfiguration mfcc_configuration,
+                                           WMSessionRef* session_out)
+{
+    return create_session(session_duration, mfcc_configuration, 0, session_out);
+}
+
+extern "C" WMSessionResult WMSessionCreateWithDeltas(float session_duration,
+                                                     WMMfccConfiguration mfcc_configuration,
+                                                     size_t delta_window,
+                                                     WMSessionRef* session_out)
+{
+    if (delta_window == 0)
+        return kWMSessionResultErrorInvalidArgument;
+    
+    return create_session(session_duration, 
+                          mfcc_configuration, 
+                          delta_window, 
+                          session_out);
+}
+
 extern "C" WMSessionResult WMSessionDestroy(WMSessionRef session)
 {
     
@@ -182,6 +233,10 @@ extern "C" WMSessionResult WMSessionReset(WMSessionRef session)
     session->num_of_overlap_samples = 0;
     session->preemph_border = 0;
     
+    session->num_of_delta_features_set = 0;
+    if (session->delta_processor != NULL)
+        session->delta_processor->reset();
+    
     return kWMSessionResultOK;
 }
 
@@ -194,6 +249,22 @@ void copy_mfcc_and_advance(const WM::MFCCProcessor::CepstraBuffer& mfcc_data,
                mfcc_data.data(), 
                sizeof(float)*kWMSessionNumberOfMFCCs);
         session->num_of_features_set++;
+        
+        if (session->delta_processor != NULL) {
+            
+            //The deltas are written as soon as the frames after the feature
+            //are known, the last ones when the session completes.
+            const size_t delta_size = session->delta_processor->output_size();
+            
+            if (session->delta_processor->push(mfcc_data.data(), 
+                                               &session->delta_data[session->num_of_delta_features_set*delta_size]))
+                session->num_of_delta_features_set++;
+            
+            if (session->num_of_features_set == session->num_of_features_expected) {
+                session->num_of_delta_features_set += 
+                    session->delta_processor->flush(&session->delta_data[session->num_of_delta_features_set*delta_size]);
+            }
+        }
     } else {
         std::cerr << "Error: feature tmp buffer overflow!" << std::endl;
     }
@@ -503,3 +574,22 @@ extern "C" WMSessionResult WMSessionGetAverage(WMFeatureType* average_out,
     
     return kWMSessionResultOK;
 }
+
+extern "C" WMSessionResult WMSessionGetDeltaFeatures(const WMFeatureType** features_out,
+                                                     size_t* num_features_out,
+                                                     WMSessionRef session)
+{
+    if ( (session == NULL) || (features_out == NULL) || (num_features_out == NULL) )
+        return kWMSessionResultErrorInvalidArgument;
+    
+    if (session->delta_processor == NULL) {
+        std::cerr << "Error: deltas were requested, but the session was not "
+                  << "created with WMSessionCreateWithDeltas." << std::endl;
+        return kWMSessionResultErrorInvalidArgument;
+    }
+    
+    *features_out = session->delta_data;
+    *num_features_out = session->num_of_delta_features_set;
+    
+    return kWMSessionResultOK;
+}
@@ -52,6 +52,18 @@ WMSessionResult WMSessionCreate(float session_duration,
                                 WMMfccConfiguration mfcc_configuration,
                                 WMSessionRef* session_out);
 
+/**
+ * Like WMSessionCreate, but the session additionally calculates the deltas 
+ * and delta-deltas of the MFCC features while they are extracted, see
+ * WMSessionGetDeltaFeatures.
+ * @param delta_window The number of features on either side of a feature that
+ * are used to calculate its deltas, usually 2. Must not be zero.
+ */
+WMSessionResult WMSessionCreateWithDeltas(float session_duration,
+                                          WMMfccConfiguration mfcc_configuration,
+                                          size_t delta_window,
+                                          WMSessionRef* session_out);
+
 /**
  * Destroys a previously created session.
  */
@@ -84,6 +96,20 @@ bool WMSessionIsCompleted(WMSessionRef session);
 WMSessionResult WMSessionGetAverage(WMFeatureType* average_out, 
                                     WMSessionRef session);
 
+/**
+ * Returns the features of a session that was created with 
+ * WMSessionCreateWithDeltas. Each feature consists of 39 consecutive values: 
+ * the 13 MFCC's, followed by their deltas and their delta-deltas. As the 
+ * deltas depend on the following features, the last features only become 
+ * available when the session is completed.
+ * @param features_out On return points to the features. They are owned by
+ * the session and stay valid until it is reset or destroyed.
+ * @param num_features_out On return holds the number of features available.
+ */
+WMSessionResult WMSessionGetDeltaFeatures(const WMFeatureType** features_out,
+                                          size_t* num_features_out,
+                                          WMSessionRef session);
+
 #endif
 
 #endif //WORD_MATCH_SESSION_H
\ No newline at end of file
@@ -0,0 +1,369 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#include "Types.h"
+#include "AudioFileReader.hpp"
+#include "MFCCUtils.h"
+
+#include <CoreFoundation/CoreFoundation.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdexcept>
+#include <iostream>
+
+struct opaqueWMTemplateIndex {
+    
+    struct Entry {
+        size_t search_index;
+        std::string label;
+    };
+    
+    typedef std::map<WMTemplateID, Entry> Entries;
+    
+    FeatureTypeTemplateSearch search;
+    Entries entries;
+    //Maps the indices of the template search back to template IDs
+    std::vector<WMTemplateID> ids;
+    WMTemplateID next_id;
+    
+    explicit opaqueWMTemplateIndex(unsigned adjustment_window_size) 
+        : search(adjustment_window_size),
+          next_id(0)
+    {}
+    
+};
+
+static const size_t kWMTemplateIndexNumberOfFeatures = FeatureTypeDTW::feature_number_size;
+
+WMTemplateIndexResult insert_features(WMTemplateIndexRef index,
+                                      const FeatureTypeDTW::FeatureSequence& features,
+                                      const char* label,
+                                      WMTemplateID* id_out)
+{
+    const WMTemplateID template_id = index->next_id;
+    
+    //Everything that may throw happens before the template is added (or is
+    //undone if adding it fails), so that a template never stays in the 
+    //search without an ID.
+    const size_t max_search_index = index->search.index_bound();
+    if (index->ids.size() <= max_search_index)
+        index->ids.resize(max_search_index + 1);
+    
+    opaqueWMTemplateIndex::Entries::iterator it = 
+        index->entries.insert(std::make_pair(template_id, 
+                                             opaqueWMTemplateIndex::Entry())).first;
+    
+    try {
+        
+        if (label != NULL)
+            it->second.label = label;
+        
+        it->second.search_index = index->search.add_template(features);
+        
+    } catch (...) {
+        
+        index->entries.erase(it);
+        
+        throw;
+    }
+    
+    index->ids[it->second.search_index] = template_id;
+    ++index->next_id;
+    
+    *id_out = template_id;
+    
+    return kWMTemplateIndexResultOK;
+}
+
+WMTemplateIndexResult query_features(WMTemplateIndexRef index,
+                                     const FeatureTypeDTW::FeatureSequence& features,
+                                     size_t k,
+                                     unsigned adjustment_window_size,
+                                     WMTemplateMatch* matches_out,
+                                     size_t* num_matches_out)
+{
+    std::vector<FeatureTypeTemplateSearch::Match> matches = 
+        index->search.nearest(features, k, adjustment_window_size);
+    
+    for (size_t i = 0; i < matches.size(); ++i) {
+        matches_out[i].template_id = index->ids[matches[i].index];
+        matches_out[i].distance = matches[i].distance;
+    }
+    
+    *num_matches_out = matches.size();
+    
+    return kWMTemplateIndexResultOK;
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexCreate(unsigned adjustment_window_size,
+                                                       WMTemplateIndexRef* index_out)
+{
+    if ( (adjustment_window_size == 0) || (index_out == NULL) )
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        *index_out = new opaqueWMTemplateIndex(adjustment_window_size);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexCreate: " << e.what() << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        //Note: a C++ exception must not leave the C/C++ realm.
+        std::cerr << "Error: WMTemplateIndexCreate: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+    
+    return kWMTemplateIndexResultOK;
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexDestroy(WMTemplateIndexRef index)
+{
+    if (index == NULL)
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    delete index;
+    
+    return kWMTemplateIndexResultOK;
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexInsertFile(WMTemplateIndexRef index,
+                                                           CFURLRef file,
+                                                           WMAudioFilePreProcessInfo* file_info,
+                                                           const char* label,
+                                                           WMTemplateID* id_out)
+{
+    if ( (index == NULL) || (id_out == NULL) )
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        AudioFileReaderRef reader(new WM::AudioFileReader(file));
+        
+        return insert_features(index, 
+                               get_mfcc_features(reader, file_info), 
+                               label, 
+                               id_out);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexInsertFile: " << e.what() 
+                  << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        std::cerr << "Error: WMTemplateIndexInsertFile: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexInsertFeatures(WMTemplateIndexRef index,
+                                                               const WMFeatureType* features,
+                                                               size_t num_feature_vectors,
+                                                               const char* label,
+                                                               WMTemplateID* id_out)
+{
+    if ( (index == NULL) || (features == NULL) || 
+         (num_feature_vectors == 0) || (id_out == NULL) )
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        return insert_features(index, 
+                               FeatureTypeDTW::FeatureSequence(features, num_feature_vectors), 
+                               label, 
+                               id_out);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexInsertFeatures: " << e.what() 
+                  << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        std::cerr << "Error: WMTemplateIndexInsertFeatures: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexRemove(WMTemplateIndexRef index,
+                                                       WMTemplateID template_id)
+{
+    if (index == NULL)
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        opaqueWMTemplateIndex::Entries::iterator it = index->entries.find(template_id);
+        
+        if (it == index->entries.end())
+            return kWMTemplateIndexResultErrorUnknownID;
+        
+        index->search.remove_template(it->second.search_index);
+        index->entries.erase(it);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexRemove: " << e.what() << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        std::cerr << "Error: WMTemplateIndexRemove: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+    
+    return kWMTemplateIndexResultOK;
+}
+
+extern "C" size_t WMTemplateIndexGetCount(WMTemplateIndexRef index)
+{
+    if (index == NULL)
+        return 0;
+    
+    return index->entries.size();
+}
+
+extern "C" const char* WMTemplateIndexGetLabel(WMTemplateIndexRef index,
+                                               WMTemplateID template_id)
+{
+    if (index == NULL)
+        return NULL;
+    
+    opaqueWMTemplateIndex::Entries::const_iterator it = index->entries.find(template_id);
+    
+    if (it == index->entries.end())
+        return NULL;
+    
+    return it->second.label.c_str();
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexQueryFile(WMTemplateIndexRef index,
+                                                          CFURLRef file,
+                                                          WMAudioFilePreProcessInfo* file_info,
+                                                          size_t k,
+                                                          unsigned adjustment_window_size,
+                                                          WMTemplateMatch* matches_out,
+                                                          size_t* num_matches_out)
+{
+    if ( (index == NULL) || (adjustment_window_size == 0) ||
+         (matches_out == NULL) || (num_matches_out == NULL) )
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        AudioFileReaderRef reader(new WM::AudioFileReader(file));
+        
+        return query_features(index, 
+                              get_mfcc_features(reader, file_info), 
+                              k, 
+                              adjustment_window_size, 
+                              matches_out, 
+                              num_matches_out);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexQueryFile: " << e.what() 
+                  << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        std::cerr << "Error: WMTemplateIndexQueryFile: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexQueryFeaturesWithStride(WMTemplateIndexRef index,
+                                                                        const WMFeatureType* features,
+                                                                        size_t num_feature_vectors,
+                                                                        size_t feature_stride,
+                                                                        size_t k,
+                                                                        unsigned adjustment_window_size,
+                                                                        WMTemplateMatch* matches_out,
+                                                                        size_t* num_matches_out)
+{
+    if ( (index == NULL) || (features == NULL) || (num_feature_vectors == 0) ||
+         (feature_stride < kWMTemplateIndexNumberOfFeatures) ||
+         (adjustment_window_size == 0) || (matches_out == NULL) || 
+         (num_matches_out == NULL) )
+        return kWMTemplateIndexResultErrorInvalidArgument;
+    
+    try {
+        
+        return query_features(index, 
+                              FeatureTypeDTW::FeatureSequence(features, 
+                                                              num_feature_vectors, 
+                                                              feature_stride), 
+                              k, 
+                              adjustment_window_size, 
+                              matches_out, 
+                              num_matches_out);
+        
+    } catch (const std::exception& e) {
+        
+        std::cerr << "Error: WMTemplateIndexQueryFeaturesWithStride: " << e.what() 
+                  << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+        
+    } catch (...) {
+        
+        std::cerr << "Error: WMTemplateIndexQueryFeaturesWithStride: unknown exception." << std::endl;
+        
+        return kWMTemplateIndexResultErrorGeneric;
+    }
+}
+
+extern "C" WMTemplateIndexResult WMTemplateIndexQueryFeatures(WMTemplateIndexRef index,
+                                                              const WMFeatureType* features,
+                                                              size_t num_feature_vectors,
+                                                              size_t k,
+                                                              unsigned adjustment_window_size,
+                                                              WMTemplateMatch* matches_out,
+                                                              size_t* num_matches_out)
+{
+    return WMTemplateIndexQueryFeaturesWithStride(index, 
+                                                  features, 
+                                                  num_feature_vectors, 
+                                                  kWMTemplateIndexNumberOfFeatures, 
+                                                  k, 
+                                                  adjustment_window_size, 
+                                                  matches_out, 
+                                                  num_matches_out);
+}
@@ -0,0 +1,158 @@
+//Copyright (c) 2011 Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_TEMPLATE_INDEX_H
+#define WORD_MATCH_TEMPLATE_INDEX_H
+
+#include "Types.h"
+
+#include <CoreFoundation/CoreFoundation.h>
+
+/**
+ * The following functions describe an API to keep the MFCC features of many
+ * recorded words in memory, and to look up the words closest to a new 
+ * recording. Each template is decoded once when it is inserted. A query only
+ * decodes the query itself, and most templates are discarded by cheap lower
+ * bounds before the exact DTW distance is calculated.
+ *
+ * An index can be created, filled, queried and destroyed. The client of this
+ * API is responsible for doing so. Queries don't modify the index, so several
+ * threads may query the same index concurrently as long as no thread inserts
+ * or removes templates at the same time.
+ */
+
+enum {
+    /**
+     * The number of values per feature vector that are expected by
+     * WMTemplateIndexInsertFeatures and WMTemplateIndexQueryFeatures.
+     */
+    kWMTemplateIndexFeatureVectorSize = 7
+};
+
+/**
+ * Creates a new WMTemplateIndex object.
+ * @param adjustment_window_size The adjustment window size the lower bounds
+ * of each template are prepared for. Queries with a different adjustment 
+ * window size are still exact, but prune less efficiently.
+ * @param index_out Out parameter of the new index created.
+ */
+WMTemplateIndexResult WMTemplateIndexCreate(unsigned adjustment_window_size,
+                                            WMTemplateIndexRef* index_out);
+
+/**
+ * Destroys a previously created index.
+ */
+WMTemplateIndexResult WMTemplateIndexDestroy(WMTemplateIndexRef index);
+
+/**
+ * Extracts the MFCC features of an audio file and stores them as a new 
+ * template. 
+ * @param file_info The result of WMGetPreProcessInfoForFile for this file.
+ * If NULL, it is calculated using default values.
+ * @param label An arbitrary string that is stored along with the template,
+ * e.g. the word that was spoken. May be NULL.
+ * @param id_out Out parameter of the ID of the new template.
+ */
+WMTemplateIndexResult WMTemplateIndexInsertFile(WMTemplateIndexRef index,
+                                                CFURLRef file,
+                                                WMAudioFilePreProcessInfo* file_info,
+                                                const char* label,
+                                                WMTemplateID* id_out);
+
+/**
+ * Stores previously extracted features as a new template.
+ * @param features num_feature_vectors consecutive feature vectors of 
+ * kWMTemplateIndexFeatureVectorSize values each.
+ */
+WMTemplateIndexResult WMTemplateIndexInsertFeatures(WMTemplateIndexRef index,
+                                                    const WMFeatureType* features,
+                                                    size_t num_feature_vectors,
+                                                    const char* label,
+                                                    WMTemplateID* id_out);
+
+/**
+ * Removes a template from the index.
+ */
+WMTemplateIndexResult WMTemplateIndexRemove(WMTemplateIndexRef index,
+                                            WMTemplateID template_id);
+
+/**
+ * Returns the number of templates currently stored in the index.
+ */
+size_t WMTemplateIndexGetCount(WMTemplateIndexRef index);
+
+/**
+ * Returns the label of a template, or NULL if there is no such template. The
+ * returned string is valid until the template is removed.
+ */
+const char* WMTemplateIndexGetLabel(WMTemplateIndexRef index,
+                                    WMTemplateID template_id);
+
+/**
+ * Finds the templates closest to an audio file.
+ * @param file_info The result of WMGetPreProcessInfoForFile for this file.
+ * If NULL, it is calculated using default values.
+ * @param k The maximum number of matches to return.
+ * @param adjustment_window_size The adjustment window size used for DTW.
+ * @param matches_out A pointer to an array of at least k matches. It's the 
+ * callers responsibility to pre-allocate this array. On return it holds the
+ * matches ordered by increasing distance.
+ * @param num_matches_out Out parameter of the number of matches written, 
+ * which is less than k if the index holds less than k templates.
+ */
+WMTemplateIndexResult WMTemplateIndexQueryFile(WMTemplateIndexRef index,
+                                               CFURLRef file,
+                                               WMAudioFilePreProcessInfo* file_info,
+                                               size_t k,
+                                               unsigned adjustment_window_size,
+                                               WMTemplateMatch* matches_out,
+                                               size_t* num_matches_out);
+
+/**
+ * Same as WMTemplateIndexQueryFile, but for previously extracted features.
+ * See WMTemplateIndexInsertFeatures for the layout of features. The features
+ * are read in place, they are not copied.
+ */
+WMTemplateIndexResult WMTemplateIndexQueryFeatures(WMTemplateIndexRef index,
+                                                   const WMFeatureType* features,
+                                                   size_t num_feature_vectors,
+                                                   size_t k,
+                                                   unsigned adjustment_window_size,
+                                                   WMTemplateMatch* matches_out,
+                                                   size_t* num_matches_out);
+
+/**
+ * Same as WMTemplateIndexQueryFeatures, but the feature vectors may be part
+ * of wider frames, e.g. of all MFCC coefficients of each frame.
+ * @param features The first value of the first feature vector.
+ * @param feature_stride The number of values from the start of one feature
+ * vector to the start of the next one. Must not be smaller than 
+ * kWMTemplateIndexFeatureVectorSize.
+ */
+WMTemplateIndexResult WMTemplateIndexQueryFeaturesWithStride(WMTemplateIndexRef index,
+                                                             const WMFeatureType* features,
+                                                             size_t num_feature_vectors,
+                                                             size_t feature_stride,
+                                                             size_t k,
+                                                             unsigned adjustment_window_size,
+                                                             WMTemplateMatch* matches_out,
+                                                             size_t* num_matches_out);
+
+#endif //WORD_MATCH_TEMPLATE_INDEX_H
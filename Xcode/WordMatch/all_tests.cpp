@@ -24,7 +24,26 @@
 #include <boost/test/unit_test.hpp>
 
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+#include "feature_distance.hpp"
 #include "dtw.hpp"
+#include "dtw_distance.hpp"
+#include "banded_dtw.hpp"
+#include "template_search.hpp"
+#include "work_stealing_pool.hpp"
+#include "distance_matrix.hpp"
+#include "tiled_dtw.hpp"
+#include "fast_dtw.hpp"
+#include "subsequence_dtw.hpp"
+#include "online_dtw.hpp"
+#include "hirschberg_dtw.hpp"
+#include "quantized_features.hpp"
+#include "barycenter_averaging.hpp"
+#include "gemm_distances.hpp"
+#include "dtw_engine.hpp"
 
 namespace
 {
@@ -34,6 +53,89 @@ namespace
     const boost::test_tools::fraction_tolerance_t<T> tolerance(1.e-5);
     return boost::test_tools::check_is_close(a, b, tolerance);
   }
+
+  // deterministic pseudo-random features for comparing DTW implementations
+  template <typename DtwType>
+  typename DtwType::Features random_features(size_t size, unsigned seed)
+  {
+    std::srand(seed);
+    typename DtwType::Features features(size);
+    for (size_t i=0; i<size; ++i)
+      for (size_t k=0; k<DtwType::feature_number_size; ++k)
+        features[i][k] = static_cast<typename DtwType::FeatureVector::value_type>(std::rand())/RAND_MAX - 0.5;
+    return features;
+  }
+}
+
+namespace
+{
+  // number of calls of the global operator new, for checking that code does
+  // not allocate
+  size_t allocation_count = 0;
+}
+
+// All forms of the global operators are replaced, so that every allocation
+// and deallocation goes through the same pair of functions.
+#if __cplusplus >= 201103L
+#  define SIMOD1_TEST_NOTHROW noexcept
+#else
+#  define SIMOD1_TEST_NOTHROW throw()
+#endif
+
+#if defined(__GNUC__)
+#  define SIMOD1_TEST_NOINLINE __attribute__((noinline))
+#else
+#  define SIMOD1_TEST_NOINLINE
+#endif
+
+namespace
+{
+  // Not inlined into the operators, otherwise the compiler pairs the
+  // operator new of a caller with the free of operator delete and warns
+  // about mismatched allocation functions.
+  SIMOD1_TEST_NOINLINE void* counted_allocate(std::size_t size)
+  {
+    ++allocation_count;
+    void* p = std::malloc(size ? size : 1);
+    if (p == NULL)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  SIMOD1_TEST_NOINLINE void counted_free(void* p)
+  {
+    std::free(p);
+  }
+}
+
+void* operator new(std::size_t size)
+{
+  return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return counted_allocate(size);
+}
+
+void operator delete(void* p) SIMOD1_TEST_NOTHROW
+{
+  counted_free(p);
+}
+
+void operator delete[](void* p) SIMOD1_TEST_NOTHROW
+{
+  counted_free(p);
+}
+
+void operator delete(void* p, std::size_t) SIMOD1_TEST_NOTHROW
+{
+  counted_free(p);
+}
+
+void operator delete[](void* p, std::size_t) SIMOD1_TEST_NOTHROW
+{
+  counted_free(p);
 }
 
 BOOST_AUTO_TEST_SUITE(vector_distance)
@@ -55,6 +157,106 @@ BOOST_AUTO_TEST_CASE(different_vectors)
   BOOST_CHECK_EQUAL(simod1::vector_distance(a, b), 5.0);
 }
 
+BOOST_AUTO_TEST_CASE(fractional_distance)
+{
+  // the sum of squares must not be truncated to an integer
+  typedef simod1::DTW<float, 2> DtwType;
+  DtwType::FeatureVector a = { {0.3f, 0.4f} };
+  DtwType::FeatureVector b = { {0.0f, 0.0f} };
+  BOOST_CHECK(almost_equal(simod1::vector_distance(a, b), 0.5f));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(feature_distance)
+
+BOOST_AUTO_TEST_CASE(same_as_double_reference)
+{
+  std::srand(42);
+  for (size_t n=1; n<=40; ++n)
+  {
+    std::vector<float> a(n), b(n);
+    double reference = 0;
+    for (size_t k=0; k<n; ++k)
+    {
+      a[k] = static_cast<float>(std::rand())/RAND_MAX*20 - 10;
+      b[k] = static_cast<float>(std::rand())/RAND_MAX*20 - 10;
+      const double d = static_cast<double>(a[k]) - b[k];
+      reference += d*d;
+    }
+    BOOST_CHECK_CLOSE(static_cast<double>(simod1::squared_distance(&a[0], &b[0], n)),
+                      reference,
+                      1.e-4);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(row_kernel_same_as_single_kernel)
+{
+  // one frame against many must be bit-identical to frame by frame
+  std::srand(7);
+  const size_t sizes[] = { 1, 3, 4, 7, 8, 13, 21 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+  {
+    const size_t n = sizes[s];
+    const size_t stride = n+3;
+    const size_t num_frames = 11;
+    std::vector<float> query(n), frames(stride*num_frames), out(num_frames);
+    for (size_t k=0; k<n; ++k)
+      query[k] = static_cast<float>(std::rand())/RAND_MAX;
+    for (size_t k=0; k<frames.size(); ++k)
+      frames[k] = static_cast<float>(std::rand())/RAND_MAX;
+    simod1::squared_distances(&query[0], &frames[0], stride, num_frames, n, &out[0]);
+    for (size_t f=0; f<num_frames; ++f)
+      BOOST_CHECK_EQUAL(out[f], simod1::squared_distance(&query[0], &frames[f*stride], n));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(metrics)
+{
+  typedef simod1::DTW<double, 3> DtwType;
+  typedef simod1::WeightedEuclidean<double, 3> WeightedType;
+  DtwType::FeatureVector a = { {1, 2, 0} };
+  DtwType::FeatureVector b = { {2, 4, 0} };
+  DtwType::FeatureVector c = { {-2, 1, 0} };
+  DtwType::FeatureVector zero = { {0, 0, 0} };
+
+  BOOST_CHECK_EQUAL(simod1::SquaredEuclidean().distance(a, c), 10.0);
+  DtwType::FeatureVector weights = { {4, 0, 1} };
+  BOOST_CHECK_EQUAL(WeightedType(weights).distance(a, c), 6.0);
+  BOOST_CHECK_EQUAL(WeightedType().distance(a, c),
+                    simod1::Euclidean().distance(a, c));
+
+  // parallel, orthogonal and opposite vectors
+  BOOST_CHECK(almost_equal(1+simod1::Cosine().distance(a, b), 1.0));
+  BOOST_CHECK(almost_equal(simod1::Cosine().distance(a, c), 1.0));
+  DtwType::FeatureVector minus_a = { {-1, -2, 0} };
+  BOOST_CHECK(almost_equal(simod1::Cosine().distance(a, minus_a), 2.0));
+  BOOST_CHECK_EQUAL(simod1::Cosine().distance(zero, zero), 0.0);
+  BOOST_CHECK_EQUAL(simod1::Cosine().distance(a, zero), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(one_to_many_metrics)
+{
+  // distances() gives the same values as distance() for each vector
+  typedef simod1::DTW<float, 7> DtwType;
+  const DtwType::Features features = random_features<DtwType>(50, 1);
+  DtwType::FeatureVector weights;
+  for (size_t k=0; k<weights.size(); ++k)
+    weights[k] = 1.f/(k+1);
+  const simod1::WeightedEuclidean<float, 7> weighted(weights);
+  std::vector<float> squared(features.size()), weighted_out(features.size()), cosine(features.size());
+  const float* frames = features[0].data();
+  simod1::SquaredEuclidean().distances<7>(frames, frames, 7, features.size(), &squared[0]);
+  weighted.distances<7>(frames, frames, 7, features.size(), &weighted_out[0]);
+  simod1::Cosine().distances<7>(frames, frames, 7, features.size(), &cosine[0]);
+  for (size_t k=0; k<features.size(); ++k)
+  {
+    BOOST_CHECK_EQUAL(squared[k], simod1::SquaredEuclidean().distance(features[0], features[k]));
+    BOOST_CHECK_EQUAL(weighted_out[k], weighted.distance(features[0], features[k]));
+    BOOST_CHECK_EQUAL(cosine[k], simod1::Cosine().distance(features[0], features[k]));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 BOOST_AUTO_TEST_SUITE(dtw)
@@ -108,7 +310,7 @@ BOOST_AUTO_TEST_CASE(same_distance_as_matlab)
   DtwType::Features a, b;
   for (int i=0; i<8; ++i)
   {
-    DtwType::FeatureVector fv = {{i}};
+    DtwType::FeatureVector fv = {{static_cast<double>(i)}};
     a.push_back(fv);
   }
   b.resize(a.size());
@@ -133,7 +335,7 @@ BOOST_AUTO_TEST_CASE(same_distance_as_matlab_multidim)
   DtwType::Features a, b;
   for (int i=0; i<4; ++i)
   {
-    DtwType::FeatureVector fv = {{i, i+4}};
+    DtwType::FeatureVector fv = {{static_cast<double>(i), static_cast<double>(i+4)}};
     a.push_back(fv);
   }
   b.resize(a.size());
@@ -179,7 +381,7 @@ BOOST_AUTO_TEST_CASE(same_path_as_matlab)
 
   for (int i=0; i<8; ++i)
   {
-    DtwType::FeatureVector fv = {{i}};
+    DtwType::FeatureVector fv = {{static_cast<double>(i)}};
     a.push_back(fv);
   }
   b.resize(a.size());
@@ -195,4 +397,1025 @@ BOOST_AUTO_TEST_CASE(same_path_as_matlab)
   }
 }
 
+BOOST_AUTO_TEST_CASE(equal_features_for_every_step_pattern)
+{
+  // every step pattern aligns equal features along the diagonal
+  typedef simod1::DTW<float, 7> P0Type;
+  typedef simod1::DTW<float, 7, simod1::SymmetricP1_2> P1_2Type;
+  typedef simod1::DTW<float, 7, simod1::AsymmetricP0> AsymmetricType;
+  typedef simod1::DTW<float, 7, simod1::Itakura> ItakuraType;
+  const P0Type::Features a = random_features<P0Type>(20, 1);
+  P0Type::Path diagonal;
+  for (unsigned k=0; k+1<a.size(); ++k)
+    diagonal.push_back(std::make_pair(a.size()-2-k, a.size()-2-k));
+  std::reverse(diagonal.begin(), diagonal.end());
+
+  P0Type p0(a, a, 5);
+  P1_2Type p1_2(a, a, 5);
+  AsymmetricType asymmetric(a, a, 5);
+  ItakuraType itakura(a, a, 5);
+  BOOST_CHECK_EQUAL(p0.minimum_distance(), 0.f);
+  BOOST_CHECK_EQUAL(p1_2.minimum_distance(), 0.f);
+  BOOST_CHECK_EQUAL(asymmetric.minimum_distance(), 0.f);
+  BOOST_CHECK_EQUAL(itakura.minimum_distance(), 0.f);
+  BOOST_CHECK(p0.minimal_path() == diagonal);
+  BOOST_CHECK(p1_2.minimal_path() == diagonal);
+  BOOST_CHECK(asymmetric.minimal_path() == diagonal);
+  BOOST_CHECK(itakura.minimal_path() == diagonal);
+}
+
+BOOST_AUTO_TEST_CASE(slope_constraint_of_step_patterns)
+{
+  // P=1/2 only allows a subset of the paths of P=0 with the same weights
+  typedef simod1::DTW<float, 7> P0Type;
+  typedef simod1::DTW<float, 7, simod1::SymmetricP1_2> P1_2Type;
+  const size_t sizes[][2] = { {2, 9}, {17, 5}, {100, 100}, {230, 171} };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+  {
+    P0Type::Features a = random_features<P0Type>(sizes[s][0], 2*s+1);
+    P0Type::Features b = random_features<P0Type>(sizes[s][1], 2*s+2);
+    P0Type p0(a, b, 20);
+    P1_2Type p1_2(a, b, 20);
+    BOOST_CHECK(p1_2.minimum_distance() >= p0.minimum_distance());
+
+    // consecutive cells of the path are neighbours
+    const P1_2Type::Path path = p1_2.minimal_path();
+    for (size_t k=1; k<path.size(); ++k)
+    {
+      BOOST_CHECK(path[k].first - path[k-1].first <= 1);
+      BOOST_CHECK(path[k].second - path[k-1].second <= 1);
+      BOOST_CHECK(path[k] != path[k-1]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(itakura_parallelogram)
+{
+  // Itakura's pattern follows a sequence played at half speed, but cannot
+  // follow one played at a third of the speed
+  typedef simod1::DTW<float, 7, simod1::Itakura> ItakuraType;
+  const ItakuraType::Features a = random_features<ItakuraType>(30, 1);
+  ItakuraType::Features half_speed, third_speed;
+  for (size_t i=0; i<a.size(); ++i)
+  {
+    half_speed.insert(half_speed.end(), 2, a[i]);
+    third_speed.insert(third_speed.end(), 3, a[i]);
+  }
+  BOOST_CHECK_EQUAL(ItakuraType(half_speed, a, 100).minimum_distance(), 0.f);
+  BOOST_CHECK_EQUAL(ItakuraType(third_speed, a, 100).minimum_distance(),
+                    std::numeric_limits<float>::infinity());
+}
+
+BOOST_AUTO_TEST_CASE(metric_policy)
+{
+  // local distances come from the metric given to DTW
+  typedef simod1::DTW<float, 7> EuclideanType;
+  typedef simod1::DTW<float, 7, simod1::SymmetricP0, simod1::SquaredEuclidean> SquaredType;
+  typedef simod1::DTW<float, 7, simod1::SymmetricP0, simod1::WeightedEuclidean<float, 7> > WeightedType;
+  const EuclideanType::Features a = random_features<EuclideanType>(30, 1);
+  const EuclideanType::Features b = random_features<EuclideanType>(40, 2);
+  EuclideanType::FeatureVector weights;
+  weights.assign(4.f);
+
+  EuclideanType euclidean(a, b, 10);
+  SquaredType squared(a, b, 10);
+  WeightedType weighted(a, b, 10, simod1::WeightedEuclidean<float, 7>(weights));
+  const EuclideanType::DistanceMatrix d = euclidean.local_distances();
+  const SquaredType::DistanceMatrix squared_d = squared.local_distances();
+  for (size_t i=0; i<a.size(); ++i)
+    for (size_t j=0; j<b.size(); ++j)
+      BOOST_CHECK(almost_equal(squared_d[i][j], d[i][j]*d[i][j]));
+  // weighting every dimension with 4 doubles every distance
+  BOOST_CHECK(almost_equal(weighted.minimum_distance(), 2*euclidean.minimum_distance()));
+  BOOST_CHECK(weighted.minimal_path() == euclidean.minimal_path());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(dtw_distance)
+
+BOOST_AUTO_TEST_CASE(empty_features)
+{
+  typedef simod1::DTWDistance<double, 3> DtwType;
+  DtwType::Features a, b;
+  BOOST_CHECK_THROW(DtwType(a, b, 42), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(same_distance_as_full_dtw)
+{
+  // the distance-only engine must reproduce the full matrix bit by bit
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  const size_t sizes[][2] = { {1, 1}, {1, 9}, {17, 5}, {40, 40}, {83, 61} };
+  const unsigned radii[] = { 1, 3, 20 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      DistanceType distance_only(a, b, radii[r]);
+      BOOST_CHECK_EQUAL(full.minimum_distance(), distance_only.minimum_distance());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(threshold)
+{
+  // abandoning is only allowed above the threshold, otherwise the result must
+  // be the unbounded one
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  const size_t sizes[][2] = { {1, 1}, {17, 5}, {40, 40}, {83, 61} };
+  size_t abandoned = 0;
+  const float thresholds[] = { 0.f, 0.1f, 0.5f, 1.f, 2.f };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t t=0; t<sizeof(thresholds)/sizeof(thresholds[0]); ++t)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      DistanceType unbounded(a, b, 20);
+      DistanceType bounded(a, b, 20, thresholds[t]);
+      if (bounded.abandoned())
+      {
+        ++abandoned;
+        BOOST_CHECK(unbounded.minimum_distance() > thresholds[t]);
+        BOOST_CHECK(bounded.abandoned_row() >= 1);
+        BOOST_CHECK(bounded.abandoned_row() <= sizes[s][0]);
+      }
+      else
+        BOOST_CHECK_EQUAL(unbounded.minimum_distance(), bounded.minimum_distance());
+    }
+  BOOST_CHECK(abandoned > 0);
+  FullType::Features a = random_features<FullType>(10, 1);
+  BOOST_CHECK_THROW(DistanceType(a, a, 20, -1.f), std::logic_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(banded_dtw)
+
+BOOST_AUTO_TEST_CASE(window_matches_adjustment_window)
+{
+  // the band must hold exactly the cells DTW does not skip
+  const size_t sizes[][2] = { {1, 1}, {3, 50}, {50, 3}, {37, 41}, {120, 64} };
+  const unsigned radii[] = { 1, 2, 20 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      const size_t I = sizes[s][0];
+      const size_t J = sizes[s][1];
+      const float slope = static_cast<float>(J)/static_cast<float>(I);
+      simod1::SearchWindow window(simod1::SakoeChibaBand<float>(I, J, radii[r]));
+      for (size_t i=1; i<=I; ++i)
+        for (size_t j=1; j<=J; ++j)
+          BOOST_CHECK_EQUAL(window.contains(i, j),
+                            !simod1::outside_adjustment_window(i, j, slope, radii[r]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(same_results_as_full_dtw)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::BandedDTW<float, 7> BandedType;
+  const size_t sizes[][2] = { {1, 1}, {2, 9}, {17, 5}, {40, 40}, {83, 61} };
+  const unsigned radii[] = { 1, 3, 20 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      BandedType banded(a, b, radii[r]);
+      BOOST_CHECK_EQUAL(full.minimum_distance(), banded.minimum_distance());
+
+      const FullType::DistanceMatrix g = full.global_distances();
+      for (size_t i=0; i<g.size(); ++i)
+        for (size_t j=0; j<g[i].size(); ++j)
+          BOOST_CHECK_EQUAL(g[i][j], banded.global_distance(i, j));
+
+      FullType::Path full_path = full.minimal_path();
+      BandedType::Path banded_path = banded.minimal_path();
+      BOOST_CHECK(full_path == banded_path);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(template_search)
+
+BOOST_AUTO_TEST_CASE(no_templates)
+{
+  typedef simod1::TemplateSearch<float, 7> SearchType;
+  SearchType search(20);
+  BOOST_CHECK_THROW(search.nearest(random_features<simod1::DTW<float, 7> >(10, 1)), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(same_nearest_neighbour_as_exhaustive_search)
+{
+  typedef simod1::TemplateSearch<float, 7> SearchType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  const unsigned radii[] = { 2, 5, 20 };
+  for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+  {
+    SearchType search(radii[r]);
+    for (unsigned t=0; t<40; ++t)
+      search.add_template(random_features<simod1::DTW<float, 7> >(20+(t*7)%30, 100+t));
+
+    for (unsigned q=0; q<5; ++q)
+    {
+      SearchType::Features query = random_features<simod1::DTW<float, 7> >(25+q*3, 1000+q);
+      SearchType::Statistics stats;
+      SearchType::Match match = search.nearest(query, &stats);
+
+      size_t best_index = 0;
+      float best_distance = std::numeric_limits<float>::infinity();
+      for (size_t t=0; t<search.size(); ++t)
+      {
+        const float d = DistanceType(query, search.features(t), radii[r]).minimum_distance();
+        if (d < best_distance)
+        {
+          best_distance = d;
+          best_index = t;
+        }
+      }
+      BOOST_CHECK_EQUAL(match.index, best_index);
+      BOOST_CHECK_EQUAL(match.distance, best_distance);
+      BOOST_CHECK_EQUAL(stats.candidates,
+                        stats.pruned_by_kim+stats.pruned_by_keogh+stats.full_comparisons);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(same_k_nearest_as_exhaustive_search)
+{
+  // removed templates must not be returned, and queries may use another
+  // adjustment window size than the envelopes
+  typedef simod1::TemplateSearch<float, 7> SearchType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  SearchType search(5);
+  for (unsigned t=0; t<40; ++t)
+    search.add_template(random_features<simod1::DTW<float, 7> >(20+(t*7)%30, 100+t));
+  for (size_t t=0; t<40; t+=3)
+    search.remove_template(t);
+  BOOST_CHECK_EQUAL(search.size(), 26u);
+  BOOST_CHECK(!search.contains(3));
+  BOOST_CHECK_THROW(search.remove_template(3), std::logic_error);
+
+  const unsigned radii[] = { 2, 5, 20 };
+  for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+  {
+    SearchType::Features query = random_features<simod1::DTW<float, 7> >(30, 1000+r);
+    std::vector<SearchType::Match> exhaustive;
+    for (size_t t=0; t<40; ++t)
+      if (search.contains(t))
+      {
+        SearchType::Match m;
+        m.index = t;
+        m.distance = DistanceType(query, search.features(t), radii[r]).minimum_distance();
+        exhaustive.push_back(m);
+      }
+    for (size_t i=1; i<exhaustive.size(); ++i)
+      for (size_t j=i; (j>0) && ((exhaustive[j].distance < exhaustive[j-1].distance) ||
+                                 ((exhaustive[j].distance == exhaustive[j-1].distance) &&
+                                  (exhaustive[j].index < exhaustive[j-1].index))); --j)
+        std::swap(exhaustive[j], exhaustive[j-1]);
+
+    std::vector<SearchType::Match> matches = search.nearest(query, 5, radii[r]);
+    BOOST_REQUIRE_EQUAL(matches.size(), 5u);
+    for (size_t i=0; i<matches.size(); ++i)
+    {
+      BOOST_CHECK_EQUAL(matches[i].index, exhaustive[i].index);
+      BOOST_CHECK_EQUAL(matches[i].distance, exhaustive[i].distance);
+    }
+  }
+
+  // freed indices are reused
+  BOOST_CHECK_EQUAL(search.add_template(random_features<simod1::DTW<float, 7> >(10, 1)), 39u);
+  BOOST_CHECK_EQUAL(search.nearest(random_features<simod1::DTW<float, 7> >(10, 2), 100, 5).size(), 27u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+namespace
+{
+  // counts how often each iteration was visited
+  struct CountIterations
+  {
+    std::vector<int> counts;
+    pthread_mutex_t mutex;
+    explicit CountIterations(size_t n) : counts(n, 0) { pthread_mutex_init(&mutex, NULL); }
+    ~CountIterations() { pthread_mutex_destroy(&mutex); }
+    void operator()(size_t begin, size_t end)
+    {
+      pthread_mutex_lock(&mutex);
+      for (size_t i=begin; i<end; ++i)
+        ++counts[i];
+      pthread_mutex_unlock(&mutex);
+    }
+  };
+
+  struct ThrowAt
+  {
+    size_t iteration;
+    void operator()(size_t begin, size_t end)
+    {
+      if ((begin <= iteration) && (iteration < end))
+        throw std::logic_error("thrown by body");
+    }
+  };
+}
+
+BOOST_AUTO_TEST_SUITE(work_stealing_pool)
+
+BOOST_AUTO_TEST_CASE(every_iteration_once)
+{
+  const size_t threads[] = { 1, 3, 8 };
+  const size_t counts[] = { 0, 1, 7, 1000 };
+  const size_t grains[] = { 1, 3, 64 };
+  for (size_t t=0; t<sizeof(threads)/sizeof(threads[0]); ++t)
+  {
+    simod1::WorkStealingPool pool(threads[t]);
+    BOOST_CHECK_EQUAL(pool.size(), threads[t]);
+    for (size_t c=0; c<sizeof(counts)/sizeof(counts[0]); ++c)
+      for (size_t g=0; g<sizeof(grains)/sizeof(grains[0]); ++g)
+      {
+        CountIterations body(counts[c]);
+        pool.parallel_for(counts[c], grains[g], body);
+        BOOST_CHECK(std::count(body.counts.begin(), body.counts.end(), 1) ==
+                    static_cast<std::ptrdiff_t>(counts[c]));
+      }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(exceptions_reach_the_caller)
+{
+  simod1::WorkStealingPool pool(4);
+  ThrowAt body = { 500 };
+  BOOST_CHECK_THROW(pool.parallel_for(1000, 10, body), std::runtime_error);
+  // the pool must still be usable afterwards
+  CountIterations count(100);
+  pool.parallel_for(100, 1, count);
+  BOOST_CHECK(std::count(count.counts.begin(), count.counts.end(), 1) == 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(distance_matrix)
+
+BOOST_AUTO_TEST_CASE(packed_symmetric_layout)
+{
+  simod1::SymmetricMatrix<int> m(4);
+  BOOST_CHECK_EQUAL(m.packed().size(), 10u);
+  int value = 0;
+  for (size_t i=0; i<4; ++i)
+    for (size_t j=i; j<4; ++j)
+      m(i, j) = value++;
+  for (size_t k=0; k<m.packed().size(); ++k)
+    BOOST_CHECK_EQUAL(m.packed()[k], static_cast<int>(k));
+  BOOST_CHECK_EQUAL(m(3, 1), m(1, 3));
+}
+
+BOOST_AUTO_TEST_CASE(same_distances_as_serial_loop)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  std::vector<FullType::Features> sequences;
+  for (unsigned s=0; s<23; ++s)
+    sequences.push_back(random_features<FullType>(10+(s*11)%40, 300+s));
+
+  simod1::WorkStealingPool pool(4);
+  simod1::AllPairsDistances<float, 7> all_pairs(sequences, 5, pool);
+  const simod1::SymmetricMatrix<float>& d = all_pairs.distances();
+  BOOST_REQUIRE_EQUAL(d.size(), sequences.size());
+  for (size_t i=0; i<sequences.size(); ++i)
+  {
+    BOOST_CHECK_EQUAL(d(i, i), 0.f);
+    for (size_t j=i+1; j<sequences.size(); ++j)
+      BOOST_CHECK_EQUAL(d(j, i), DistanceType(sequences[i], sequences[j], 5).minimum_distance());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(only_listed_pairs)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  typedef simod1::AllPairsDistances<float, 7> AllPairsType;
+  std::vector<FullType::Features> sequences;
+  for (unsigned s=0; s<9; ++s)
+    sequences.push_back(random_features<FullType>(10+(s*7)%30, 400+s));
+
+  std::vector<AllPairsType::Pair> pairs;
+  pairs.push_back(AllPairsType::Pair(0, 5));
+  pairs.push_back(AllPairsType::Pair(3, 4));
+  pairs.push_back(AllPairsType::Pair(8, 2));
+
+  simod1::WorkStealingPool pool(3);
+  AllPairsType selected(sequences, pairs, 5, pool, -1.f);
+  const simod1::SymmetricMatrix<float>& d = selected.distances();
+  BOOST_CHECK_EQUAL(d(0, 5), DistanceType(sequences[0], sequences[5], 5).minimum_distance());
+  BOOST_CHECK_EQUAL(d(3, 4), DistanceType(sequences[3], sequences[4], 5).minimum_distance());
+  BOOST_CHECK_EQUAL(d(2, 8), DistanceType(sequences[8], sequences[2], 5).minimum_distance());
+  // the other elements are not compared
+  BOOST_CHECK_EQUAL(d(0, 1), -1.f);
+  BOOST_CHECK_EQUAL(d(4, 4), -1.f);
+
+  pairs.push_back(AllPairsType::Pair(1, 9));
+  BOOST_CHECK_THROW(AllPairsType(sequences, pairs, 5, pool), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(tiled_dtw)
+
+BOOST_AUTO_TEST_CASE(same_results_as_full_dtw)
+{
+  // serial and parallel tiling must reproduce distance and path bit by bit
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::TiledDTW<float, 7> TiledType;
+  simod1::WorkStealingPool pool(4);
+  const size_t sizes[][2] = { {1, 1}, {2, 9}, {17, 5}, {100, 100}, {230, 171} };
+  const unsigned radii[] = { 1, 20 };
+  const size_t tile_sizes[] = { 1, 7, 64 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      const FullType::Path path = full.minimal_path();
+      const FullType::DistanceMatrix g = full.global_distances();
+      for (size_t t=0; t<sizeof(tile_sizes)/sizeof(tile_sizes[0]); ++t)
+      {
+        TiledType serial(a, b, radii[r], tile_sizes[t]);
+        TiledType parallel(a, b, radii[r], tile_sizes[t], &pool);
+        BOOST_CHECK_EQUAL(serial.minimum_distance(), full.minimum_distance());
+        BOOST_CHECK_EQUAL(parallel.minimum_distance(), full.minimum_distance());
+        BOOST_CHECK(serial.minimal_path() == path);
+        BOOST_CHECK(parallel.minimal_path() == path);
+        BOOST_CHECK(parallel.global_distances() == g);
+      }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(fast_dtw)
+
+BOOST_AUTO_TEST_CASE(exact_for_short_sequences)
+{
+  // sequences not longer than radius+2 are aligned without approximation
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::FastDTW<float, 7> FastType;
+  FullType::Features a = random_features<FullType>(12, 1);
+  FullType::Features b = random_features<FullType>(9, 2);
+  FullType full(a, b, 12);
+  FastType fast(a, b, 10);
+  BOOST_CHECK_EQUAL(fast.minimum_distance(), full.minimum_distance());
+  BOOST_CHECK(fast.minimal_path() == full.minimal_path());
+}
+
+BOOST_AUTO_TEST_CASE(approximates_from_above)
+{
+  // every evaluated path is a valid warping path, so the distance can never
+  // be below the one of unconstrained DTW
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::FastDTW<float, 7> FastType;
+  const size_t sizes[][2] = { {40, 40}, {100, 37}, {250, 300} };
+  const unsigned radii[] = { 0, 1, 5 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+  {
+    FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+    FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+    FullType full(a, b, std::max(sizes[s][0], sizes[s][1]));
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FastType fast(a, b, radii[r]);
+      BOOST_CHECK(fast.minimum_distance() >= full.minimum_distance());
+      BOOST_CHECK(fast.evaluated_cells() < sizes[s][0]*sizes[s][1]);
+
+      // consecutive cells of the path are neighbours
+      const FastType::Path& path = fast.minimal_path();
+      for (size_t k=1; k<path.size(); ++k)
+      {
+        BOOST_CHECK(path[k].first - path[k-1].first <= 1);
+        BOOST_CHECK(path[k].second - path[k-1].second <= 1);
+        BOOST_CHECK(path[k] != path[k-1]);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(subsequence_dtw)
+
+BOOST_AUTO_TEST_CASE(finds_embedded_queries)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::SubsequenceDTW<float, 7> SubsequenceType;
+  const FullType::Features query = random_features<FullType>(20, 1);
+
+  // noise with two copies of the query, the second one slowed down
+  FullType::Features sequence = random_features<FullType>(300, 2);
+  std::copy(query.begin(), query.end(), sequence.begin()+50);
+  for (size_t i=0; i<30; ++i)
+    sequence[200+i] = query[i*2/3];
+
+  SubsequenceType search(query, sequence, 0.1f);
+  const SubsequenceType::Matches& matches = search.matches();
+  BOOST_REQUIRE_EQUAL(matches.size(), 2u);
+  BOOST_CHECK_EQUAL(matches[0].first, 50u);
+  BOOST_CHECK_EQUAL(matches[0].last, 69u);
+  BOOST_CHECK_EQUAL(matches[0].distance, 0.f);
+  BOOST_CHECK_EQUAL(matches[1].first, 200u);
+  BOOST_CHECK_EQUAL(matches[1].last, 229u);
+}
+
+BOOST_AUTO_TEST_CASE(same_distances_as_full_dtw)
+{
+  // every match is the DTW distance of the query to the matched frames
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::SubsequenceDTW<float, 7> SubsequenceType;
+  const FullType::Features query = random_features<FullType>(15, 3);
+  const FullType::Features sequence = random_features<FullType>(400, 4);
+
+  SubsequenceType search(query, sequence, 0.8f);
+  const SubsequenceType::Matches& matches = search.matches();
+  BOOST_CHECK(!matches.empty());
+  for (size_t k=0; k<matches.size(); ++k)
+  {
+    BOOST_CHECK(matches[k].distance < 0.8f);
+    if (k > 0)
+      BOOST_CHECK(matches[k-1].last < matches[k].first);
+    const FullType::Features part(sequence.begin()+matches[k].first,
+                                  sequence.begin()+matches[k].last+1);
+    FullType full(query, part, query.size()+part.size());
+    BOOST_CHECK_EQUAL(matches[k].distance, full.minimum_distance());
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(online_dtw)
+
+BOOST_AUTO_TEST_CASE(same_rows_as_full_dtw)
+{
+  // after i frames, the estimates come from row i of DTW's global distances
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::OnlineDTW<float, 7> OnlineType;
+  const size_t sizes[][2] = { {1, 1}, {2, 9}, {17, 5}, {100, 100}, {230, 171} };
+  const unsigned radii[] = { 1, 20 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      const FullType::DistanceMatrix g = full.global_distances();
+      const size_t J = b.size();
+
+      OnlineType online(b, radii[r], a.size());
+      for (size_t i=1; i<=a.size(); ++i)
+      {
+        online.add_frame(a[i-1]);
+        BOOST_CHECK_EQUAL(online.frames(), i);
+        BOOST_CHECK_EQUAL(online.distance(), g[i][J]/(i+J));
+
+        float minimum_cost = std::numeric_limits<float>::infinity();
+        float open_end_distance = std::numeric_limits<float>::infinity();
+        for (size_t j=1; j<=J; ++j)
+        {
+          minimum_cost = std::min(minimum_cost, g[i][j]);
+          open_end_distance = std::min(open_end_distance, g[i][j]/(i+j));
+        }
+        BOOST_CHECK_EQUAL(online.minimum_cost(), minimum_cost);
+        BOOST_CHECK_EQUAL(online.open_end_distance(), open_end_distance);
+        if (online.open_end_distance() < std::numeric_limits<float>::infinity())
+          BOOST_CHECK_EQUAL(g[i][online.open_end_frame()+1]/(i+online.open_end_frame()+1),
+                            open_end_distance);
+      }
+      BOOST_CHECK_EQUAL(online.distance(), full.minimum_distance());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(follows_the_reference)
+{
+  // a query that repeats the first half of the reference ends up there
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::OnlineDTW<float, 7> OnlineType;
+  const FullType::Features reference = random_features<FullType>(40, 5);
+  OnlineType online(reference, 10, reference.size());
+  BOOST_CHECK_EQUAL(online.frames(), 0u);
+  BOOST_CHECK_EQUAL(online.distance(), std::numeric_limits<float>::infinity());
+  for (size_t i=0; i<20; ++i)
+    online.add_frame(reference[i]);
+  BOOST_CHECK_EQUAL(online.open_end_frame(), 19u);
+  BOOST_CHECK_EQUAL(online.open_end_distance(), 0.f);
+  BOOST_CHECK_EQUAL(online.minimum_cost(), 0.f);
+}
+
+BOOST_AUTO_TEST_CASE(query_longer_than_expected)
+{
+  // frames beyond expected_length+r are aligned to the end of the reference
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::OnlineDTW<float, 7> OnlineType;
+  const FullType::Features reference = random_features<FullType>(40, 6);
+  const unsigned r = 5;
+  OnlineType online(reference, r, reference.size());
+  for (size_t i=0; i<reference.size(); ++i)
+    BOOST_CHECK(online.add_frame(reference[i]));
+  for (size_t i=0; i<r+10; ++i)
+    BOOST_CHECK(!online.add_frame(reference.back()));
+  BOOST_CHECK_EQUAL(online.frames(), reference.size()+r+10);
+  BOOST_CHECK_EQUAL(online.distance(), 0.f);
+  BOOST_CHECK_EQUAL(online.open_end_distance(), 0.f);
+  BOOST_CHECK_EQUAL(online.open_end_frame(), reference.size()-1);
+  BOOST_CHECK_EQUAL(online.minimum_cost(), 0.f);
+
+  // a different query keeps finite estimates
+  const FullType::Features query = random_features<FullType>(reference.size()+r+10, 7);
+  OnlineType other(reference, r, reference.size());
+  for (size_t i=0; i<query.size(); ++i)
+    other.add_frame(query[i]);
+  BOOST_CHECK(other.distance() < std::numeric_limits<float>::infinity());
+  BOOST_CHECK(other.open_end_distance() <= other.distance());
+  BOOST_CHECK(other.minimum_cost() < std::numeric_limits<float>::infinity());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(hirschberg_dtw)
+
+BOOST_AUTO_TEST_CASE(same_results_as_dtw)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::HirschbergDTW<float, 7> HirschbergType;
+  const size_t sizes[][2] = { {1, 1}, {1, 6}, {2, 9}, {17, 5}, {100, 100}, {230, 171} };
+  const unsigned radii[] = { 1, 3, 20, 1000 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      HirschbergType hirschberg(a, b, radii[r]);
+      BOOST_CHECK_EQUAL(hirschberg.minimum_distance(), full.minimum_distance());
+      if (full.minimum_distance() < std::numeric_limits<float>::infinity())
+        BOOST_CHECK(hirschberg.minimal_path() == full.minimal_path());
+      else
+        BOOST_CHECK(hirschberg.minimal_path().empty());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(feature_sequence)
+
+BOOST_AUTO_TEST_CASE(strided_views)
+{
+  // views on a part of wider frames give the same results as copies
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  typedef simod1::TemplateSearch<float, 7> SearchType;
+  const size_t stride = 13;
+  const FullType::Features a = random_features<FullType>(40, 1);
+  const FullType::Features b = random_features<FullType>(50, 2);
+  std::vector<float> frames(a.size()*stride, 42.f);
+  for (size_t i=0; i<a.size(); ++i)
+    std::copy(a[i].begin(), a[i].end(), frames.begin()+i*stride+1);
+  const FullType::FeatureSequence view(&frames[1], a.size(), stride);
+  BOOST_CHECK_EQUAL(view.size(), a.size());
+  BOOST_CHECK_EQUAL(view[3][0], a[3][0]);
+  BOOST_CHECK_THROW(FullType::FeatureSequence(&frames[0], a.size(), 6), std::logic_error);
+
+  FullType full(a, b, 10);
+  FullType full_view(view, b, 10);
+  BOOST_CHECK_EQUAL(full_view.minimum_distance(), full.minimum_distance());
+  BOOST_CHECK(full_view.local_distances() == full.local_distances());
+  BOOST_CHECK_EQUAL(DistanceType(view, b, 10).minimum_distance(), full.minimum_distance());
+  BOOST_CHECK_EQUAL(DistanceType(b, view, 10).minimum_distance(),
+                    FullType(b, a, 10).minimum_distance());
+
+  SearchType search(10);
+  search.add_template(b);
+  const size_t index = search.add_template(view);
+  BOOST_CHECK(search.features(index) == a);
+  BOOST_CHECK_EQUAL(search.nearest(view.subsequence(0, 30)).index, index);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+namespace
+{
+  // The kernels on codes sum in the same order as those on decoded values.
+  template <size_t n>
+  void check_encoded_kernels()
+  {
+    const size_t count = 11;
+    std::srand(3);
+    std::vector<float> query(n), weights(n);
+    std::vector<boost::int8_t> bytes(count*n);
+    std::vector<boost::uint16_t> halves(count*n);
+    for (size_t k=0; k<n; ++k)
+    {
+      query[k] = 8.f*std::rand()/RAND_MAX - 4;
+      weights[k] = 4.f*std::rand()/RAND_MAX;
+    }
+    for (size_t i=0; i<count*n; ++i)
+    {
+      bytes[i] = static_cast<boost::int8_t>(std::rand()%255 - 127);
+      halves[i] = simod1::float_to_half(8.f*std::rand()/RAND_MAX - 4);
+    }
+
+    std::vector<float> weighted(count), unweighted(count);
+    simod1::encoded_squared_distances<n>(&query[0], &bytes[0], &weights[0], count, &weighted[0]);
+    simod1::encoded_squared_distances<n>(&query[0], &halves[0], static_cast<const float*>(0), count, &unweighted[0]);
+    for (size_t f=0; f<count; ++f)
+    {
+      boost::array<float, n> bytes_decoded, halves_decoded;
+      for (size_t k=0; k<n; ++k)
+      {
+        bytes_decoded[k] = bytes[f*n+k];
+        halves_decoded[k] = simod1::half_to_float(halves[f*n+k]);
+      }
+      BOOST_CHECK_EQUAL(weighted[f], simod1::weighted_squared_distance(&query[0], bytes_decoded.data(), &weights[0], n));
+      BOOST_CHECK_EQUAL(unweighted[f], simod1::squared_distance(&query[0], halves_decoded.data(), n));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE(quantized_features)
+
+BOOST_AUTO_TEST_CASE(half_precision_conversion)
+{
+  // every half precision value except NaN survives the round trip
+  for (unsigned h=0; h<0x10000; ++h)
+    if (((h & 0x7c00) != 0x7c00) || ((h & 0x3ff) == 0))
+      BOOST_CHECK_EQUAL(simod1::float_to_half(simod1::half_to_float(static_cast<boost::uint16_t>(h))), h);
+
+  BOOST_CHECK_EQUAL(simod1::float_to_half(1.f), 0x3c00);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(-2.f), 0xc000);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(65504.f), 0x7bff);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(65520.f), 0x7c00);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(std::ldexp(1.f, -24)), 0x0001);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(std::ldexp(1.f, -26)), 0x0000);
+  // ties round to even
+  BOOST_CHECK_EQUAL(simod1::float_to_half(1.f+std::ldexp(1.f, -11)), 0x3c00);
+  BOOST_CHECK_EQUAL(simod1::float_to_half(1.f+3*std::ldexp(1.f, -11)), 0x3c02);
+}
+
+BOOST_AUTO_TEST_CASE(kernels_on_encoded_values)
+{
+  // lengths with and without 8-lane, 4-lane and scalar parts
+  check_encoded_kernels<3>();
+  check_encoded_kernels<4>();
+  check_encoded_kernels<7>();
+  check_encoded_kernels<8>();
+  check_encoded_kernels<13>();
+  check_encoded_kernels<16>();
+}
+
+BOOST_AUTO_TEST_CASE(distances_on_encoded_frames)
+{
+  // distances on the encoded frames are those to the decoded frames
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::QuantizedFeatures<float, 7, simod1::Int8Encoding<float, 7> > Int8Type;
+  typedef simod1::QuantizedFeatures<float, 7, simod1::Float16Encoding<float, 7> > Float16Type;
+  const FullType::Features a = random_features<FullType>(20, 1);
+  const FullType::Features b = random_features<FullType>(30, 2);
+  const Int8Type int8(b);
+  const Float16Type float16(b);
+  BOOST_CHECK_EQUAL(int8.size(), b.size());
+  BOOST_CHECK_EQUAL(int8.bytes(), 7*b.size());
+  BOOST_CHECK_EQUAL(float16.bytes(), 14*b.size());
+
+  std::vector<float> int8_distances(b.size()), float16_distances(b.size());
+  int8.distances(a[0].data(), 0, b.size(), &int8_distances[0]);
+  float16.distances(a[0].data(), 0, b.size(), &float16_distances[0]);
+  for (size_t j=0; j<b.size(); ++j)
+  {
+    for (size_t k=0; k<7; ++k)
+      // the features span [-0.5, 0.5], i.e. 1/254 per step
+      BOOST_CHECK(std::fabs(int8.frame(j)[k]-b[j][k]) <= 0.5f/254+1e-6f);
+    BOOST_CHECK(std::fabs(int8_distances[j]-simod1::vector_distance(a[0], int8.frame(j))) < 1e-5f);
+    BOOST_CHECK_EQUAL(float16_distances[j], simod1::vector_distance(a[0], float16.frame(j)));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(dtw_on_encoded_frames)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  typedef simod1::QuantizedFeatures<float, 7, simod1::Int8Encoding<float, 7> > Int8Type;
+  typedef simod1::QuantizedFeatures<float, 7, simod1::Float16Encoding<float, 7> > Float16Type;
+  const FullType::Features a = random_features<FullType>(100, 1);
+  const FullType::Features b = random_features<FullType>(80, 2);
+  const float exact = DistanceType(a, b, 20).minimum_distance();
+  BOOST_CHECK(std::fabs(DistanceType(a, Int8Type(b), 20).minimum_distance()-exact) < 1e-2f*exact);
+  BOOST_CHECK(std::fabs(DistanceType(a, Float16Type(b), 20).minimum_distance()-exact) < 1e-3f*exact);
+
+  // the threshold works as for float features
+  BOOST_CHECK(DistanceType(a, Int8Type(b), 20, exact/2).abandoned());
+  BOOST_CHECK(!DistanceType(a, Float16Type(b), 20, exact*2).abandoned());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(barycenter_averaging)
+
+BOOST_AUTO_TEST_CASE(identical_sequences)
+{
+  typedef simod1::BarycenterAveraging<float, 7> AveragingType;
+  const AveragingType::Features a = random_features<simod1::DTW<float, 7> >(40, 1);
+  const std::vector<AveragingType::Features> sequences(3, a);
+  const AveragingType averaging(sequences, 20);
+  BOOST_CHECK_EQUAL(averaging.medoid(), 0u);
+  BOOST_CHECK_EQUAL(averaging.iterations(), 0u);
+  BOOST_CHECK_EQUAL(averaging.mean_distance(), 0.f);
+  BOOST_CHECK(averaging.average() == a);
+}
+
+BOOST_AUTO_TEST_CASE(warped_copies)
+{
+  // copies of one sequence at different speeds, with a little noise
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::BarycenterAveraging<float, 7> AveragingType;
+  const FullType::Features base = random_features<FullType>(30, 1);
+  const size_t lengths[] = { 30, 45, 24, 60, 38 };
+  std::vector<AveragingType::Features> sequences;
+  for (size_t s=0; s<sizeof(lengths)/sizeof(lengths[0]); ++s)
+  {
+    const FullType::Features noise = random_features<FullType>(lengths[s], s+2);
+    AveragingType::Features sequence(lengths[s]);
+    for (size_t i=0; i<lengths[s]; ++i)
+      for (size_t k=0; k<7; ++k)
+        sequence[i][k] = base[i*base.size()/lengths[s]][k] + 0.1f*noise[i][k];
+    sequences.push_back(sequence);
+  }
+
+  const AveragingType averaging(sequences, 20);
+  float medoid_distance = 0;
+  for (size_t s=0; s<sequences.size(); ++s)
+    medoid_distance += simod1::DTWDistance<float, 7>(sequences[averaging.medoid()], 
+                                                     sequences[s], 20).minimum_distance();
+  medoid_distance /= sequences.size();
+
+  float mean_distance = 0;
+  for (size_t s=0; s<sequences.size(); ++s)
+    mean_distance += simod1::DTWDistance<float, 7>(averaging.average(), 
+                                                   sequences[s], 20).minimum_distance();
+  mean_distance /= sequences.size();
+
+  BOOST_CHECK_EQUAL(averaging.average().size(), sequences[averaging.medoid()].size());
+  BOOST_CHECK(averaging.iterations() > 0);
+  BOOST_CHECK(averaging.mean_distance() < medoid_distance);
+  BOOST_CHECK(almost_equal(averaging.mean_distance(), mean_distance));
+}
+
+BOOST_AUTO_TEST_CASE(invalid_arguments)
+{
+  typedef simod1::BarycenterAveraging<float, 7> AveragingType;
+  std::vector<AveragingType::Features> sequences;
+  BOOST_CHECK_THROW(AveragingType(sequences, 20), std::logic_error);
+  sequences.push_back(random_features<simod1::DTW<float, 7> >(10, 1));
+  BOOST_CHECK_THROW(AveragingType(sequences, 0), std::logic_error);
+  sequences.push_back(AveragingType::Features());
+  BOOST_CHECK_THROW(AveragingType(sequences, 20), std::logic_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(gemm_distances)
+
+BOOST_AUTO_TEST_CASE(multiply_transposed)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  const FullType::Features a = random_features<FullType>(37, 1);
+  const FullType::Features b = random_features<FullType>(101, 2);
+  // every other frame of a, and a C with padded rows
+  std::vector<float> c(19*110);
+  simod1::multiply_transposed(a[0].data(), 14, 19, b[0].data(), 7, 101, 7, &c[0], 110);
+  for (size_t i=0; i<19; ++i)
+    for (size_t j=0; j<101; ++j)
+    {
+      float dot = 0;
+      for (size_t k=0; k<7; ++k)
+        dot += a[2*i][k]*b[j][k];
+      BOOST_CHECK(std::fabs(c[i*110+j]-dot) < 1e-5f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_and_banded)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::BandedDTW<float, 7> BandedType;
+  typedef simod1::GemmDistances<float, 7> GemmType;
+  const FullType::Features a = random_features<FullType>(90, 1);
+  const FullType::Features b = random_features<FullType>(70, 2);
+  const GemmType gemm(b);
+  BOOST_CHECK_EQUAL(gemm.size(), b.size());
+
+  std::vector<float> block(a.size()*30);
+  gemm.block(a, 20, 30, &block[0], 30);
+  for (size_t i=0; i<a.size(); ++i)
+    for (size_t j=0; j<30; ++j)
+      BOOST_CHECK(std::fabs(block[i*30+j]-simod1::vector_distance(a[i], b[20+j])) < 1e-3f);
+
+  const BandedType banded_dtw(a, b, 10);
+  std::vector<float> banded(banded_dtw.window().num_cells());
+  gemm.banded(a, banded_dtw.window(), &banded[0]);
+  BOOST_CHECK(std::fabs(banded[0]-simod1::vector_distance(a[0], b[0])) < 1e-3f);
+  for (size_t i=0; i<a.size(); ++i)
+    for (size_t j=0; j<b.size(); ++j)
+      if (banded_dtw.window().contains(i+1, j+1))
+        BOOST_CHECK(std::fabs(banded[banded_dtw.window().index(i+1, j+1)]-
+                              banded_dtw.local_distance(i, j)) < 1e-3f);
+}
+
+BOOST_AUTO_TEST_CASE(dtw_with_gemm_metric)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTW<float, 7, simod1::SymmetricP0, simod1::GemmEuclidean> GemmType;
+  const FullType::Features a = random_features<FullType>(120, 1);
+  const FullType::Features b = random_features<FullType>(100, 2);
+  const FullType full(a, b, 20);
+  const GemmType gemm(a, b, 20);
+  BOOST_CHECK(std::fabs(gemm.minimum_distance()-full.minimum_distance()) < 1e-4f);
+
+  // a sequence is only about zero away from itself
+  BOOST_CHECK(GemmType(a, a, 20).minimum_distance() < 1e-3f);
+
+  // one GemmDistances per template serves every query
+  const simod1::GemmDistances<float, 7> prebuilt(b);
+  BOOST_CHECK_EQUAL(GemmType(a, prebuilt, 20).minimum_distance(), gemm.minimum_distance());
+  const FullType::Features c = random_features<FullType>(80, 3);
+  BOOST_CHECK_EQUAL(GemmType(c, prebuilt, 20).minimum_distance(), GemmType(c, b, 20).minimum_distance());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(dtw_engine)
+
+BOOST_AUTO_TEST_CASE(same_results_as_dtw)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWDistance<float, 7> DistanceType;
+  typedef simod1::DTWEngine<float, 7> EngineType;
+  EngineType engine;
+  const size_t sizes[][2] = { {1, 1}, {1, 6}, {17, 5}, {100, 100}, {230, 171}, {9, 2} };
+  const unsigned radii[] = { 1, 3, 20, 1000 };
+  for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+    for (size_t r=0; r<sizeof(radii)/sizeof(radii[0]); ++r)
+    {
+      FullType::Features a = random_features<FullType>(sizes[s][0], 2*s+1);
+      FullType::Features b = random_features<FullType>(sizes[s][1], 2*s+2);
+      FullType full(a, b, radii[r]);
+      BOOST_CHECK_EQUAL(engine.minimum_distance(a, b, radii[r]), 
+                        DistanceType(a, b, radii[r]).minimum_distance());
+      BOOST_CHECK_EQUAL(engine.align(a, b, radii[r]), full.minimum_distance());
+      BOOST_CHECK(engine.minimal_path() == full.minimal_path());
+
+      const float threshold = full.minimum_distance()/2;
+      const DistanceType abandoned(a, b, radii[r], threshold);
+      BOOST_CHECK_EQUAL(engine.minimum_distance(a, b, radii[r], threshold), 
+                        abandoned.minimum_distance());
+      BOOST_CHECK_EQUAL(engine.abandoned_row(), abandoned.abandoned_row());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(no_allocations_in_steady_state)
+{
+  typedef simod1::DTW<float, 7> FullType;
+  typedef simod1::DTWEngine<float, 7> EngineType;
+  std::vector<FullType::Features> sequences;
+  for (unsigned s=0; s<6; ++s)
+    sequences.push_back(random_features<FullType>(60+17*s, s+1));
+
+  // the first round grows the engine to the longest sequences
+  EngineType engine;
+  for (size_t p=0; p<sequences.size(); ++p)
+    for (size_t q=0; q<sequences.size(); ++q)
+    {
+      engine.minimum_distance(sequences[p], sequences[q], 20);
+      engine.align(sequences[p], sequences[q], 20);
+    }
+
+  const size_t allocations = allocation_count;
+  float sum = 0;
+  for (size_t p=0; p<sequences.size(); ++p)
+    for (size_t q=0; q<sequences.size(); ++q)
+    {
+      sum += engine.minimum_distance(sequences[p], sequences[q], 20);
+      sum += engine.minimum_distance(sequences[p], sequences[q], 20, 0.1f);
+      sum += engine.align(sequences[p], sequences[q], 20);
+      sum += engine.minimal_path().size();
+    }
+  BOOST_CHECK_EQUAL(allocation_count, allocations);
+  BOOST_CHECK(sum > 0);
+
+  // DTWDistance allocates its rows for every comparison
+  simod1::DTWDistance<float, 7>(sequences[0], sequences[1], 20);
+  BOOST_CHECK(allocation_count > allocations);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,218 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_BANDED_DTW_HPP
+#define WORD_MATCH_BANDED_DTW_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Banded variant of DTW. Only the cells within the Sakoe-Chiba adjustment
+  // window are stored (see SearchWindow for the layout), and local distances
+  // are only calculated for these cells. Memory and time are therefore
+  // O(I*r*J/I) instead of O(I*J). The results (distance and path) are
+  // identical to the ones of DTW for the same arguments.
+  //
+  // Alternatively, any other search window can be given, e.g. the one
+  // projected from a coarser resolution by FastDTW. Its last row has to end
+  // at column J.
+  template <typename T = double, size_t feature_number=3>
+  class BandedDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::Coordinate Coordinate;
+    typedef typename DTW<T, feature_number>::Path Path;
+    BandedDTW(const Features& a, const Features& b, unsigned adjustment_window_size);
+    BandedDTW(const Features& a, const Features& b, const SearchWindow& window);
+    ~BandedDTW() {}
+    T minimum_distance() const { return minimum_distance_; }
+    Path minimal_path() const;
+    const SearchWindow& window() const { return window_; }
+    // local distance of a[i] and b[j], or max_value outside of the window
+    T local_distance(size_t i, size_t j) const;
+    // g[i][j] as in DTW::global_distances(), max_value outside of the window
+    T global_distance(size_t i, size_t j) const;
+  private:
+    const size_t I;
+    const size_t J;
+    T max_value;
+    SearchWindow window_;
+    std::vector<T> d;
+    std::vector<T> g;
+    std::vector<unsigned char> steps;
+    T minimum_distance_;
+    void calculate(const Features& a, const Features& b);
+    void calculate_global_distances(const Features& a, const Features& b);
+    unsigned char step(size_t i, size_t j) const;
+  };
+
+  template <typename T, size_t feature_number>
+  BandedDTW<T, feature_number>::BandedDTW(const Features& a,
+                                          const Features& b,
+                                          unsigned adjustment_window_size)
+    : I(a.size()),
+      J(b.size())
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    window_ = SearchWindow(SakoeChibaBand<T>(I, J, adjustment_window_size));
+    calculate(a, b);
+  }
+
+  template <typename T, size_t feature_number>
+  BandedDTW<T, feature_number>::BandedDTW(const Features& a,
+                                          const Features& b,
+                                          const SearchWindow& window)
+    : I(a.size()),
+      J(b.size()),
+      window_(window)
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+    if (window.rows() != I+1)
+      throw std::logic_error("window does not match the feature arguments");
+    for (size_t i=1; i<=I; ++i)
+      if (window.end(i) > J+1)
+        throw std::logic_error("window does not match the feature arguments");
+
+    max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    calculate(a, b);
+  }
+
+  template <typename T, size_t feature_number>
+  void BandedDTW<T, feature_number>::calculate(const Features& a,
+                                               const Features& b)
+  {
+    d.resize(window_.num_cells());
+    g.resize(window_.num_cells());
+    steps.resize(window_.num_cells());
+
+    calculate_global_distances(a, b);
+    minimum_distance_ = global_distance(I, J)/(I+J);
+  }
+
+  template <typename T, size_t feature_number>
+  void BandedDTW<T, feature_number>::calculate_global_distances(const Features& a,
+                                                                const Features& b)
+  {
+    d[0] = vector_distance<T, feature_number>(a[0], b[0]);
+    g[0] = 2*d[0];
+    for (size_t i=1; i<=I; ++i)
+    {
+      const size_t begin = window_.begin(i);
+      const size_t end = window_.end(i);
+      if (begin < end)
+        vector_distances<T, feature_number>(a[i-1],
+                                            &b[begin-1],
+                                            end-begin,
+                                            &d[window_.offset(i)]);
+      for (size_t j=begin; j<end; ++j)
+      {
+        const size_t k = window_.index(i, j);
+        const T distances[] = {
+            ((j > begin) ? g[k-1] : max_value) + d[k],
+            global_distance(i-1, j-1)          + 2*d[k],
+            global_distance(i-1, j  )          + d[k]
+          };
+        const T* min_distance = std::min_element(distances, distances+3);
+        steps[k] = static_cast<unsigned char>(min_distance-distances);
+        g[k] = *min_distance;
+      }
+    }
+  }
+
+  template <typename T, size_t feature_number>
+  T BandedDTW<T, feature_number>::local_distance(size_t i, size_t j) const
+  {
+    if (!window_.contains(i+1, j+1))
+      return max_value;
+    return d[window_.index(i+1, j+1)];
+  }
+
+  template <typename T, size_t feature_number>
+  T BandedDTW<T, feature_number>::global_distance(size_t i, size_t j) const
+  {
+    if (!window_.contains(i, j))
+      return max_value;
+    return g[window_.index(i, j)];
+  }
+
+  // step taken to reach local distance cell (i, j). Cells outside of the
+  // window have never been reached, DTW reports step 0 for them.
+  template <typename T, size_t feature_number>
+  unsigned char BandedDTW<T, feature_number>::step(size_t i, size_t j) const
+  {
+    if (!window_.contains(i+1, j+1))
+      return 0;
+    return steps[window_.index(i+1, j+1)];
+  }
+
+  template <typename T, size_t feature_number>
+  typename BandedDTW<T, feature_number>::Path BandedDTW<T, feature_number>::minimal_path() const
+  {
+    size_t i = I-1;
+    size_t j = J-1;
+    Path min_path;
+
+    while ((i>0) && (j>0))
+    {
+      switch (step(i, j))
+      {
+        case 0:
+          --j;
+          break;
+        case 1:
+          --i;
+          --j;
+          break;
+        case 2:
+          --i;
+          break;
+        default:
+          throw std::logic_error("invalid step in banded traceback");
+      }
+      min_path.push_back(std::make_pair(i, j));
+    }
+    std::reverse(min_path.begin(), min_path.end());
+    return min_path;
+  }
+}
+
+#endif // WORD_MATCH_BANDED_DTW_HPP
@@ -0,0 +1,194 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#ifndef WORD_MATCH_BARYCENTER_AVERAGING_HPP
+#define WORD_MATCH_BARYCENTER_AVERAGING_HPP
+
+#include "dtw.hpp"
+#include "dtw_distance.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // DTW barycenter averaging (DBA): collapses several recordings of the
+  // same word into one template. The average starts as the medoid, i.e. the
+  // sequence with the smallest sum of DTW distances to all others. Each
+  // iteration aligns every sequence to the average with DTW and replaces
+  // each frame of the average with the mean of all frames aligned to it.
+  //
+  // Iterating stops after max_iterations updates, or as soon as an update
+  // does not lower the mean DTW distance of the average to the sequences;
+  // that update is discarded. The average keeps the length of the medoid.
+  template <typename T = double, size_t feature_number=3>
+  class BarycenterAveraging
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::Path Path;
+    BarycenterAveraging(const std::vector<Features>& sequences,
+                        unsigned adjustment_window_size,
+                        unsigned max_iterations = 10);
+    ~BarycenterAveraging() {}
+    const Features& average() const { return average_; }
+    // index of the sequence the average started from
+    size_t medoid() const { return medoid_; }
+    // number of updates applied to the medoid
+    unsigned iterations() const { return iterations_; }
+    // mean DTW distance of average() to the sequences
+    T mean_distance() const { return mean_distance_; }
+  private:
+    const std::vector<Features>& sequences_;
+    const unsigned r;
+    Features average_;
+    size_t medoid_;
+    unsigned iterations_;
+    T mean_distance_;
+    // sum and number of the frames aligned to each frame of the average
+    std::vector<T> sums;
+    std::vector<size_t> counts;
+
+    void find_medoid();
+    T align();
+    void update();
+    static void complete_path(Path& path, size_t I, size_t J);
+  };
+
+  template <typename T, size_t feature_number>
+  BarycenterAveraging<T, feature_number>::BarycenterAveraging(const std::vector<Features>& sequences,
+                                                              unsigned adjustment_window_size,
+                                                              unsigned max_iterations)
+    : sequences_(sequences),
+      r(adjustment_window_size),
+      medoid_(0),
+      iterations_(0)
+  {
+    if (sequences.empty())
+      throw std::logic_error("no sequences to average");
+    for (size_t s=0; s<sequences.size(); ++s)
+      if (sequences[s].empty())
+        throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    find_medoid();
+    average_ = sequences[medoid_];
+
+    Features previous;
+    T previous_distance = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      previous_distance = std::numeric_limits<T>::infinity();
+    for (;;)
+    {
+      const T distance = align();
+      if ((iterations_ > 0) && !(distance < previous_distance))
+      {
+        // the last update did not help
+        average_.swap(previous);
+        --iterations_;
+        mean_distance_ = previous_distance;
+        break;
+      }
+      mean_distance_ = distance;
+      if (iterations_ == max_iterations)
+        break;
+      previous = average_;
+      previous_distance = distance;
+      update();
+      ++iterations_;
+    }
+  }
+
+  template <typename T, size_t feature_number>
+  void BarycenterAveraging<T, feature_number>::find_medoid()
+  {
+    const size_t N = sequences_.size();
+    std::vector<T> sum_distances(N, T(0));
+    for (size_t s=0; s<N; ++s)
+      for (size_t t=0; t<N; ++t)
+        if (s != t)
+          sum_distances[s] += DTWDistance<T, feature_number>(sequences_[s], sequences_[t], r).minimum_distance();
+    medoid_ = std::min_element(sum_distances.begin(), sum_distances.end()) - sum_distances.begin();
+  }
+
+  // Aligns all sequences to the average and sums up the frames aligned to
+  // each of its frames. Returns the mean DTW distance.
+  template <typename T, size_t feature_number>
+  T BarycenterAveraging<T, feature_number>::align()
+  {
+    const size_t I = average_.size();
+    sums.assign(I*feature_number, T(0));
+    counts.assign(I, 0);
+
+    T sum_distances = 0;
+    for (size_t s=0; s<sequences_.size(); ++s)
+    {
+      const Features& b = sequences_[s];
+      DTW<T, feature_number> dtw(average_, b, r);
+      sum_distances += dtw.minimum_distance();
+
+      Path path = dtw.minimal_path();
+      complete_path(path, I, b.size());
+      for (size_t p=0; p<path.size(); ++p)
+      {
+        const size_t i = path[p].first;
+        const FeatureVector& frame = b[path[p].second];
+        for (size_t k=0; k<feature_number; ++k)
+          sums[i*feature_number+k] += frame[k];
+        ++counts[i];
+      }
+    }
+    return sum_distances/sequences_.size();
+  }
+
+  template <typename T, size_t feature_number>
+  void BarycenterAveraging<T, feature_number>::update()
+  {
+    for (size_t i=0; i<average_.size(); ++i)
+      for (size_t k=0; k<feature_number; ++k)
+        average_[i][k] = sums[i*feature_number+k]/counts[i];
+  }
+
+  // DTW::minimal_path() leaves out the last cell and stops as soon as it
+  // reaches the first row or column. Adds the last cell and the cells from
+  // the origin along that row or column, so that every frame of both
+  // sequences is part of the path.
+  template <typename T, size_t feature_number>
+  void BarycenterAveraging<T, feature_number>::complete_path(Path& path, size_t I, size_t J)
+  {
+    path.push_back(std::make_pair(I-1, J-1));
+    const size_t i0 = path.front().first;
+    const size_t j0 = path.front().second;
+    Path border;
+    for (size_t i=0; i<i0; ++i)
+      border.push_back(std::make_pair(i, 0));
+    for (size_t j=0; j<j0; ++j)
+      border.push_back(std::make_pair(0, j));
+    path.insert(path.begin(), border.begin(), border.end());
+  }
+}
+
+#endif // WORD_MATCH_BARYCENTER_AVERAGING_HPP
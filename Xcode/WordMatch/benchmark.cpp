@@ -20,10 +20,12 @@
 //THE SOFTWARE.
 
 #include "benchmark.h"
+#include "MFCCProcessor.hpp"
 
 #include <iostream>
 #include <cassert>
 #include <cmath>
+#include <ctime>
 #include <stdexcept>
 #include <boost/lexical_cast.hpp>
 
@@ -34,79 +36,67 @@ namespace {
             boost::lexical_cast<std::string>(sample_number) + "-" +
             boost::lexical_cast<std::string>(speaker_number) + ".wav";
     }
-}
-
-
-FeatureTypeDTW::Features get_mfcc_features(const std::string& filename)
-{
-    CFStringRef filename_cfstring = CFStringCreateWithCString(kCFAllocatorDefault,
-                                                              filename.c_str(),
-                                                              kCFStringEncodingUTF8);
-    CFURLRef url = NULL;
+    
+    AudioFileReaderRef open_audio_file(const std::string& filename)
+    {
+        CFStringRef filename_cfstring = CFStringCreateWithCString(kCFAllocatorDefault,
+                                                                  filename.c_str(),
+                                                                  kCFStringEncodingUTF8);
+        CFURLRef url = NULL;
     
 #ifdef TEST_USE_MAIN_BUNDLE_FOR_FILES
     
-    CFBundleRef main_bundle;
+        CFBundleRef main_bundle;
     
-    // Get the main bundle for the app
-    main_bundle = CFBundleGetMainBundle();  
+        // Get the main bundle for the app
+        main_bundle = CFBundleGetMainBundle();  
     
-    if (main_bundle == NULL)
-        throw std::runtime_error("Cannot load main bundle");
+        if (main_bundle == NULL)
+            throw std::runtime_error("Cannot load main bundle");
     
-    url = CFBundleCopyResourceURL(main_bundle, filename_cfstring, NULL, NULL);
-    if (url == NULL)
-        throw std::runtime_error("Cannot load file from bundle.");
+        url = CFBundleCopyResourceURL(main_bundle, filename_cfstring, NULL, NULL);
+        if (url == NULL)
+            throw std::runtime_error("Cannot load file from bundle.");
     
 #else
     
-    url = CFURLCreateWithFileSystemPath(kCFAllocatorDefault,
-                                        filename_cfstring,
-                                        kCFURLPOSIXPathStyle,
-                                        false);
+        url = CFURLCreateWithFileSystemPath(kCFAllocatorDefault,
+                                            filename_cfstring,
+                                            kCFURLPOSIXPathStyle,
+                                            false);
     
-#endif    
+#endif
     
-    CFRelease(filename_cfstring);
+        CFRelease(filename_cfstring);
     
-    AudioFileReaderRef audio_file_reader = AudioFileReaderRef(new WM::AudioFileReader(url));
-    CFRelease(url);
+        AudioFileReaderRef audio_file_reader = AudioFileReaderRef(new WM::AudioFileReader(url));
+        CFRelease(url);
+        return audio_file_reader;
+    }
+}
+
+FeatureTypeDTW::Features get_mfcc_features(const std::string& filename)
+{
+    AudioFileReaderRef audio_file_reader = open_audio_file(filename);
     return get_mfcc_features(audio_file_reader);
 }
 
-WMFeatureType mfcc_dtw_distance(const std::string& filename_a,
-                                const std::string& filename_b)
+const FeatureTypeDTW::Features& cached_mfcc_features(const std::string& filename)
 {
     typedef std::map<std::string, FeatureTypeDTW::Features> FeatureCache;
     static FeatureCache cache_map;
     
     //Try to look up in static cache first
-    FeatureCache::const_iterator it_cache_a = cache_map.find(filename_a);
-    FeatureCache::const_iterator it_cache_b = cache_map.find(filename_b);    
-    
-    FeatureTypeDTW::Features features_a;
-    FeatureTypeDTW::Features features_b;
-    
-    if (it_cache_a != cache_map.end()) {
-        features_a = it_cache_a->second;
-    } else {
-        features_a = get_mfcc_features(filename_a);
-        FeatureCache::value_type v(filename_a, features_a);
-        if (!cache_map.insert(v).second)
-            throw std::runtime_error("Cannot insert into cache.");
-    }
+    FeatureCache::const_iterator it_cache = cache_map.find(filename);
+    if (it_cache != cache_map.end())
+        return it_cache->second;
+    
+    FeatureCache::value_type v(filename, get_mfcc_features(filename));
+    std::pair<FeatureCache::iterator, bool> inserted = cache_map.insert(v);
+    if (!inserted.second)
+        throw std::runtime_error("Cannot insert into cache.");
     
-    if (it_cache_b != cache_map.end()) {
-        features_b = it_cache_b->second;
-    } else {
-        features_b = get_mfcc_features(filename_b);
-        FeatureCache::value_type v(filename_b, features_b);
-        if (!cache_map.insert(v).second)
-            throw std::runtime_error("Cannot insert into cache.");
-    }    
-    
-    FeatureTypeDTW dtw_data(features_a, features_b, 20);
-    return dtw_data.minimum_distance();
+    return inserted.first->second;
 }
 
 SpeakerDistances calculate_benchmark_table(unsigned number_of_samples,
@@ -114,6 +104,28 @@ SpeakerDistances calculate_benchmark_table(unsigned number_of_samples,
 {
     const WMFeatureType NaN = std::numeric_limits<WMFeatureType>::quiet_NaN();
 
+    //The feature cache is not thread-safe, so all features are extracted
+    //before the comparisons are distributed over all cores. Sample x of 
+    //speaker i has the index i*number_of_samples + x.
+    std::vector<FeatureTypeDTW::Features> features;
+    for (size_t i=0; i<number_of_speakers; ++i)
+        for (size_t x=0; x<number_of_samples; ++x)
+            features.push_back(cached_mfcc_features(sample_name(i+1, x+1)));
+
+    //Only the cells the table keeps are compared: speaker i<=j and sample
+    //x<=y, the diagonal of same speaker and utterance is zero.
+    std::vector<FeatureTypeAllPairsDistances::Pair> pairs;
+    for (size_t i=0; i<number_of_speakers; ++i)
+        for (size_t j=i; j<number_of_speakers; ++j)
+            for (size_t x=0; x<number_of_samples; ++x)
+                for (size_t y=(i == j) ? x+1 : x; y<number_of_samples; ++y)
+                    pairs.push_back(std::make_pair(i*number_of_samples + x,
+                                                   j*number_of_samples + y));
+
+    simod1::WorkStealingPool pool;
+    const FeatureTypeAllPairsDistances all_pairs(features, pairs, 20, pool);
+    const FeatureTypeAllPairsDistances::Matrix& all_distances = all_pairs.distances();
+
     SpeakerDistances benchmark_table;
 
     for (size_t i=0; i<number_of_speakers; ++i)
@@ -126,16 +138,10 @@ SpeakerDistances calculate_benchmark_table(unsigned number_of_samples,
                 for (size_t y=0; y<number_of_samples; ++y)
                 {
                     WMFeatureType distance;
-                    if (i==j && x==y)
-                        // same speaker, same utterance
-                        distance = 0;
-                    else if (i<=j && x<=y)
-                    {
-                        const std::string sample1 = sample_name(i+1, x+1);
-                        const std::string sample2 = sample_name(j+1, y+1);
-                        distance = mfcc_dtw_distance(sample1,
-                                                     sample2);
-                    }
+                    if (i<=j && x<=y)
+                        // same speaker and utterance lie on the diagonal (0)
+                        distance = all_distances(i*number_of_samples + x,
+                                                 j*number_of_samples + y);
                     else
                         // samples have already been compared
                         distance = NaN;
@@ -147,6 +153,39 @@ SpeakerDistances calculate_benchmark_table(unsigned number_of_samples,
     return benchmark_table;
 }
 
+// The table of speaker pair (i, i) holds the distance of sample x of speaker
+// i to the averaged template of utterance y.
+SpeakerDistances calculate_averaged_benchmark_table(unsigned number_of_samples,
+                                                    unsigned number_of_speakers)
+{
+    SpeakerDistances benchmark_table;
+    
+    for (size_t i=0; i<number_of_speakers; ++i)
+    {
+        // one template per utterance, averaged over all other speakers
+        std::vector<FeatureTypeDTW::Features> templates;
+        for (size_t y=0; y<number_of_samples; ++y)
+        {
+            std::vector<FeatureTypeDTW::Features> recordings;
+            for (size_t j=0; j<number_of_speakers; ++j)
+                if (j != i)
+                    recordings.push_back(cached_mfcc_features(sample_name(j+1, y+1)));
+            templates.push_back(FeatureTypeBarycenterAveraging(recordings, 20).average());
+        }
+        
+        DistanceTable distances(boost::extents[number_of_samples][number_of_samples]);
+        for (size_t x=0; x<number_of_samples; ++x)
+            for (size_t y=0; y<number_of_samples; ++y)
+                distances[x][y] = 
+                    FeatureTypeDTWDistance(cached_mfcc_features(sample_name(i+1, x+1)),
+                                           templates[y],
+                                           20).minimum_distance();
+        
+        benchmark_table.insert(std::make_pair(std::make_pair(i, i), distances));
+    }
+    return benchmark_table;
+}
+
 void analyze_benchmark_table(const SpeakerDistances& benchmark_table)
 {
     // TODO: move threshold to a useful location, it's pretty much useless here
@@ -207,3 +246,266 @@ void show_benchmark_data(unsigned number_of_samples,
     analyze_benchmark_table(calculate_benchmark_table(number_of_samples,
                                                       number_of_speakers));
 }
+
+void show_averaged_benchmark_data(unsigned number_of_samples,
+                                  unsigned number_of_speakers)
+{
+    analyze_benchmark_table(calculate_averaged_benchmark_table(number_of_samples,
+                                                               number_of_speakers));
+}
+
+void show_template_search_data(unsigned number_of_samples,
+                               unsigned number_of_speakers)
+{
+    unsigned correct = 0;
+    unsigned queries = 0;
+    FeatureTypeTemplateSearch::Statistics total;
+    
+    for (size_t i=0; i<number_of_speakers; ++i)
+    {
+        // templates: all samples of all other speakers
+        FeatureTypeTemplateSearch search(20);
+        std::vector<size_t> template_sample;
+        for (size_t j=0; j<number_of_speakers; ++j)
+        {
+            if (i == j)
+                continue;
+            for (size_t y=0; y<number_of_samples; ++y)
+            {
+                search.add_template(cached_mfcc_features(sample_name(j+1, y+1)));
+                template_sample.push_back(y);
+            }
+        }
+        
+        for (size_t x=0; x<number_of_samples; ++x)
+        {
+            FeatureTypeTemplateSearch::Statistics stats;
+            FeatureTypeTemplateSearch::Match match = 
+                search.nearest(cached_mfcc_features(sample_name(i+1, x+1)), &stats);
+            
+            ++queries;
+            if (template_sample[match.index] == x)
+                ++correct;
+            
+            total.candidates += stats.candidates;
+            total.pruned_by_kim += stats.pruned_by_kim;
+            total.pruned_by_keogh += stats.pruned_by_keogh;
+            total.full_comparisons += stats.full_comparisons;
+        }
+    }
+    
+    std::cout << "\nrecognition rate: " << static_cast<double>(correct)/queries
+              << "\ncandidates: " << total.candidates
+              << "\npruned by LB_Kim: " << total.pruned_by_kim
+              << "\npruned by LB_Keogh: " << total.pruned_by_keogh
+              << "\nfull DTW comparisons: " << total.full_comparisons << std::endl;
+}
+
+void show_fast_dtw_error(const std::vector<std::string>& filenames,
+                         unsigned radius)
+{
+    double sum_error = 0;
+    double max_error = 0;
+    double sum_cells = 0;
+    unsigned comparisons = 0;
+    
+    for (size_t p=0; p<filenames.size(); ++p)
+        for (size_t q=p+1; q<filenames.size(); ++q)
+        {
+            const FeatureTypeDTW::Features& a = cached_mfcc_features(filenames[p]);
+            const FeatureTypeDTW::Features& b = cached_mfcc_features(filenames[q]);
+            
+            // an adjustment window this wide does not constrain the path
+            const unsigned unconstrained = std::max(a.size(), b.size());
+            const WMFeatureType exact = 
+                FeatureTypeDTWDistance(a, b, unconstrained).minimum_distance();
+            const FeatureTypeFastDTW fast(a, b, radius);
+            
+            const double error = (exact > 0) ? 
+                (fast.minimum_distance() - exact) / exact : 0;
+            sum_error += error;
+            max_error = std::max(max_error, error);
+            sum_cells += static_cast<double>(fast.evaluated_cells()) / (a.size()*b.size());
+            ++comparisons;
+        }
+    
+    std::cout << "\nFastDTW radius: " << radius
+              << "\ncomparisons: " << comparisons
+              << "\nmean relative error: " << sum_error/comparisons
+              << "\nmax relative error: " << max_error
+              << "\nmean share of cells evaluated: " << sum_cells/comparisons << std::endl;
+}
+
+void show_quantization_error(unsigned number_of_samples,
+                             unsigned number_of_speakers)
+{
+    std::vector<FeatureTypeDTW::Features> features;
+    std::vector<FeatureTypeInt8Features> int8_features;
+    std::vector<FeatureTypeFloat16Features> float16_features;
+    size_t frames = 0;
+    for (size_t i=0; i<number_of_speakers; ++i)
+        for (size_t x=0; x<number_of_samples; ++x)
+        {
+            features.push_back(cached_mfcc_features(sample_name(i+1, x+1)));
+            int8_features.push_back(FeatureTypeInt8Features(features.back()));
+            float16_features.push_back(FeatureTypeFloat16Features(features.back()));
+            frames += features.back().size();
+        }
+    
+    double sum_int8_error = 0;
+    double max_int8_error = 0;
+    double sum_float16_error = 0;
+    double max_float16_error = 0;
+    unsigned comparisons = 0;
+    unsigned same_int8_nearest = 0;
+    unsigned same_float16_nearest = 0;
+    size_t int8_bytes = 0;
+    size_t float16_bytes = 0;
+    
+    for (size_t p=0; p<features.size(); ++p)
+    {
+        size_t nearest = 0;
+        size_t nearest_int8 = 0;
+        size_t nearest_float16 = 0;
+        WMFeatureType min_distance = std::numeric_limits<WMFeatureType>::max();
+        WMFeatureType min_int8 = min_distance;
+        WMFeatureType min_float16 = min_distance;
+        
+        for (size_t q=0; q<features.size(); ++q)
+        {
+            if (p == q)
+                continue;
+            
+            const WMFeatureType exact = 
+                FeatureTypeDTWDistance(features[p], features[q], 20).minimum_distance();
+            const WMFeatureType int8 = 
+                FeatureTypeDTWDistance(features[p], int8_features[q], 20).minimum_distance();
+            const WMFeatureType float16 = 
+                FeatureTypeDTWDistance(features[p], float16_features[q], 20).minimum_distance();
+            
+            const double int8_error = (exact > 0) ? std::fabs(int8 - exact) / exact : 0;
+            const double float16_error = (exact > 0) ? std::fabs(float16 - exact) / exact : 0;
+            sum_int8_error += int8_error;
+            max_int8_error = std::max(max_int8_error, int8_error);
+            sum_float16_error += float16_error;
+            max_float16_error = std::max(max_float16_error, float16_error);
+            ++comparisons;
+            
+            if (exact < min_distance)
+            {
+                min_distance = exact;
+                nearest = q;
+            }
+            if (int8 < min_int8)
+            {
+                min_int8 = int8;
+                nearest_int8 = q;
+            }
+            if (float16 < min_float16)
+            {
+                min_float16 = float16;
+                nearest_float16 = q;
+            }
+        }
+        
+        if (nearest_int8 == nearest)
+            ++same_int8_nearest;
+        if (nearest_float16 == nearest)
+            ++same_float16_nearest;
+        int8_bytes += int8_features[p].bytes();
+        float16_bytes += float16_features[p].bytes();
+    }
+    
+    std::cout << "\ncomparisons: " << comparisons
+              << "\nfloat bytes per frame: " << sizeof(FeatureTypeDTW::FeatureVector)
+              << "\nint8 bytes per frame: " << static_cast<double>(int8_bytes)/frames
+              << "\nint8 mean relative error: " << sum_int8_error/comparisons
+              << "\nint8 max relative error: " << max_int8_error
+              << "\nint8 same nearest template: " 
+              << static_cast<double>(same_int8_nearest)/features.size()
+              << "\nfloat16 bytes per frame: " << static_cast<double>(float16_bytes)/frames
+              << "\nfloat16 mean relative error: " << sum_float16_error/comparisons
+              << "\nfloat16 max relative error: " << max_float16_error
+              << "\nfloat16 same nearest template: " 
+              << static_cast<double>(same_float16_nearest)/features.size() << std::endl;
+}
+
+void show_fft_padding_data(const std::vector<std::string>& filenames)
+{
+    static const size_t window_frame_size = 400;
+    static const size_t hop_size = 160;
+    static const size_t num_cepstra = 13;
+    
+    //read all files once, so that only the MFCC extraction is timed
+    std::vector<std::vector<float> > signals;
+    for (size_t f=0; f<filenames.size(); ++f) {
+        AudioFileReaderRef reader = open_audio_file(filenames[f]);
+        WMAudioFilePreProcessInfo info = reader->preprocess(-27, -40, 0.9f);
+        size_t num_samples = static_cast<size_t>((info.threshold_end_time - 
+                                                  info.threshold_start_time) * 16000);
+        std::vector<float> signal(num_samples, 0);
+        if (num_samples < window_frame_size ||
+            !reader->read_floats(num_samples, &signal[0], info.threshold_start_time))
+            throw std::runtime_error("Cannot read " + filenames[f]);
+        signal.resize(num_samples);
+        WM::DSP::scale(&signal[0], 1, info.normalization_factor, &signal[0], 1, num_samples);
+        signals.push_back(signal);
+    }
+    
+    const WM::MFCCProcessor::FFTPadding paddings[] = {
+        WM::MFCCProcessor::kFFTPaddingDoublePowerOfTwo,
+        WM::MFCCProcessor::kFFTPaddingPowerOfTwo,
+        WM::MFCCProcessor::kFFTPaddingMixedRadix
+    };
+    const char* padding_names[] = { "double power of two", "power of two", "mixed radix" };
+    
+    std::vector<std::vector<float> > reference_cepstra(signals.size());
+    
+    for (size_t p=0; p<3; ++p) {
+        
+        WM::MFCCProcessor mp(window_frame_size, 0.97f, 16000, 133.33f, 6855.6f, paddings[p]);
+        
+        size_t num_frames = 0;
+        double sum_deviation = 0;
+        double max_deviation = 0;
+        size_t num_deviations = 0;
+        clock_t ticks = 0;
+        
+        for (size_t f=0; f<signals.size(); ++f) {
+            
+            const size_t file_frames = mp.num_frames(signals[f].size(), hop_size);
+            std::vector<float> cepstra(file_frames*num_cepstra);
+            
+            const clock_t start = clock();
+            mp.process_frames(&signals[f][0], signals[f].size(), hop_size, 0, &cepstra[0]);
+            ticks += clock() - start;
+            num_frames += file_frames;
+            
+            if (p == 0) {
+                reference_cepstra[f] = cepstra;
+                continue;
+            }
+            
+            //c0 mostly reflects the total energy, compare the others only
+            for (size_t i=0; i<file_frames; ++i)
+                for (size_t c=1; c<num_cepstra; ++c) {
+                    const double deviation = fabs(cepstra[i*num_cepstra + c] - 
+                                                  reference_cepstra[f][i*num_cepstra + c]);
+                    sum_deviation += deviation;
+                    max_deviation = std::max(max_deviation, deviation);
+                    ++num_deviations;
+                }
+        }
+        
+        const double seconds = static_cast<double>(ticks) / CLOCKS_PER_SEC;
+        
+        std::cout << "\nFFT padding: " << padding_names[p]
+                  << "\nFFT size: " << mp.fft_size()
+                  << "\nframes: " << num_frames
+                  << "\nframes per second: " << ((seconds > 0) ? num_frames/seconds : 0);
+        if (num_deviations > 0)
+            std::cout << "\nmean cepstra deviation: " << sum_deviation/num_deviations
+                      << "\nmax cepstra deviation: " << max_deviation;
+        std::cout << std::endl;
+    }
+}
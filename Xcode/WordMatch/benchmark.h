@@ -23,6 +23,8 @@
 #define WORD_MATCH_BENCHMARK_HPP
 
 #include <map>
+#include <string>
+#include <vector>
 #include "MFCCUtils.h"
 #include "dtw.hpp"
 
@@ -33,5 +35,44 @@ typedef std::map<SpeakerPair, DistanceTable> SpeakerDistances;
 void show_benchmark_data(unsigned number_of_samples,
                          unsigned number_of_speakers);
 
+/**
+ * Like show_benchmark_data, but each sample is only compared to one 
+ * template per utterance, averaged with DTW barycenter averaging from the
+ * samples of all other speakers.
+ */
+void show_averaged_benchmark_data(unsigned number_of_samples,
+                                  unsigned number_of_speakers);
+
+/**
+ * Looks up each sample of each speaker in a template set built from the
+ * samples of all other speakers, and prints the recognition rate and how
+ * many candidates each stage of the lower bound cascade discarded.
+ */
+void show_template_search_data(unsigned number_of_samples,
+                               unsigned number_of_speakers);
+
+/**
+ * Compares every pair of the given files with FastDTW and with exact DTW 
+ * without adjustment window, and prints the mean and maximum relative error
+ * of FastDTW and the share of cells it evaluated.
+ */
+void show_fast_dtw_error(const std::vector<std::string>& filenames,
+                         unsigned radius);
+
+/**
+ * Compares all samples of all speakers with DTW, once on float features and
+ * once each on int8 and float16 encoded templates. Prints the mean and 
+ * maximum relative error of the encoded distances, how often the nearest 
+ * template still is the same one, and the bytes stored per frame.
+ */
+void show_quantization_error(unsigned number_of_samples,
+                             unsigned number_of_speakers);
+
+/**
+ * Extracts the MFCCs of the given files with each FFT padding policy of
+ * MFCCProcessor, and prints the FFT size, the frames processed per second and
+ * the mean and maximum deviation of the cepstra from the default padding.
+ */
+void show_fft_padding_data(const std::vector<std::string>& filenames);
 
 #endif //WORD_MATCH_BENCHMARK_HPP
\ No newline at end of file
@@ -0,0 +1,158 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_DISTANCE_MATRIX_HPP
+#define WORD_MATCH_DISTANCE_MATRIX_HPP
+
+#include "dtw.hpp"
+#include "dtw_distance.hpp"
+#include "dtw_engine.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace simod1
+{
+  // Symmetric matrix that stores only the upper triangle including the
+  // diagonal, row by row, i.e. size*(size+1)/2 elements.
+  template <typename T>
+  class SymmetricMatrix
+  {
+  public:
+    explicit SymmetricMatrix(size_t size, T value = T())
+      : size_(size),
+        elements_(size*(size+1)/2, value) {}
+    size_t size() const { return size_; }
+    T& operator()(size_t i, size_t j) { return elements_[index(i, j)]; }
+    const T& operator()(size_t i, size_t j) const { return elements_[index(i, j)]; }
+    const std::vector<T>& packed() const { return elements_; }
+  private:
+    size_t size_;
+    std::vector<T> elements_;
+    size_t index(size_t i, size_t j) const
+    {
+      if (i > j)
+        std::swap(i, j);
+      return i*size_ - i*(i-1)/2 + (j-i);
+    }
+  };
+
+  // Calculates the DTW distance of every pair of sequences on all threads of
+  // pool. Only the pairs i<j are compared, as DTWDistance(sequences[i],
+  // sequences[j]); the diagonal is zero. Note that with an adjustment window
+  // scaled to the length ratio DTW is not exactly symmetric for sequences of
+  // different lengths, the matrix holds the distance in this argument order.
+  // Alternatively only an explicit list of pairs is compared, all other
+  // elements then keep the given value.
+  template <typename T, size_t feature_number>
+  class AllPairsDistances
+  {
+  public:
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef SymmetricMatrix<T> Matrix;
+    typedef std::pair<size_t, size_t> Pair;
+
+    AllPairsDistances(const std::vector<Features>& sequences,
+                      unsigned adjustment_window_size,
+                      WorkStealingPool& pool);
+    // Compares only the given pairs (i, j), as DTWDistance(sequences[i],
+    // sequences[j]). Each element of the matrix must occur at most once.
+    AllPairsDistances(const std::vector<Features>& sequences,
+                      const std::vector<Pair>& pairs,
+                      unsigned adjustment_window_size,
+                      WorkStealingPool& pool,
+                      T value = T(0));
+    const Matrix& distances() const { return distances_; }
+
+    // Called by the pool for the pairs [begin, end) of the pair list.
+    void operator()(size_t begin, size_t end);
+
+  private:
+    const std::vector<Features>& sequences_;
+    const unsigned r;
+    Matrix distances_;
+    std::vector<Pair> pairs_;
+    void compare_all(WorkStealingPool& pool);
+  };
+
+  template <typename T, size_t feature_number>
+  AllPairsDistances<T, feature_number>::AllPairsDistances(const std::vector<Features>& sequences,
+                                                          unsigned adjustment_window_size,
+                                                          WorkStealingPool& pool)
+    : sequences_(sequences),
+      r(adjustment_window_size),
+      distances_(sequences.size(), T(0))
+  {
+    // the upper triangle in row-major order
+    const size_t n = sequences.size();
+    pairs_.reserve(n > 1 ? n*(n-1)/2 : 0);
+    for (size_t i=0; i<n; ++i)
+      for (size_t j=i+1; j<n; ++j)
+        pairs_.push_back(Pair(i, j));
+    compare_all(pool);
+  }
+
+  template <typename T, size_t feature_number>
+  AllPairsDistances<T, feature_number>::AllPairsDistances(const std::vector<Features>& sequences,
+                                                          const std::vector<Pair>& pairs,
+                                                          unsigned adjustment_window_size,
+                                                          WorkStealingPool& pool,
+                                                          T value)
+    : sequences_(sequences),
+      r(adjustment_window_size),
+      distances_(sequences.size(), value),
+      pairs_(pairs)
+  {
+    for (size_t k=0; k<pairs.size(); ++k)
+      if (pairs[k].first >= sequences.size() || pairs[k].second >= sequences.size())
+        throw std::out_of_range("pair index exceeds the number of sequences");
+    compare_all(pool);
+  }
+
+  template <typename T, size_t feature_number>
+  void AllPairsDistances<T, feature_number>::compare_all(WorkStealingPool& pool)
+  {
+    if (r == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    // several chunks per thread, so that stealing can even out the
+    // different sequence lengths
+    const size_t grain = std::max<size_t>(1, pairs_.size()/(8*pool.size()));
+    pool.parallel_for(pairs_.size(), grain, *this);
+  }
+
+  template <typename T, size_t feature_number>
+  void AllPairsDistances<T, feature_number>::operator()(size_t begin, size_t end)
+  {
+    DTWEngine<T, feature_number> engine;
+    for (size_t k=begin; k<end; ++k)
+    {
+      const size_t i = pairs_[k].first;
+      const size_t j = pairs_[k].second;
+      distances_(i, j) = engine.minimum_distance(sequences_[i], sequences_[j], r);
+    }
+  }
+}
+
+#endif // WORD_MATCH_DISTANCE_MATRIX_HPP
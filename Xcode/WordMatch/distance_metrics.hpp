@@ -0,0 +1,174 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_DISTANCE_METRICS_HPP
+#define WORD_MATCH_DISTANCE_METRICS_HPP
+
+#include "feature_distance.hpp"
+
+#include <boost/array.hpp>
+#include <boost/static_assert.hpp>
+#include <cmath>
+#include <cstddef>
+
+namespace simod1
+{
+  // Local distance metrics, given as template argument to DTW. Each metric
+  // provides
+  //
+  //   distance<n>(a, b):        the distance of two feature vectors of n
+  //                             values
+  //   distances<n>(v, frames, stride, count, out):
+  //                             the distances of v to count feature vectors,
+  //                             the first one at frames, each following one
+  //                             stride values after the previous one
+  //
+  // where distances() gives the same values as calling distance() for each
+  // of the vectors. distance(a, b) is a shorthand for two boost::arrays.
+
+  // The Euclidean distance, the metric DTW has always used.
+  struct Euclidean
+  {
+    template <size_t feature_number, typename T>
+    T distance(const T* a, const T* b) const
+    {
+      return static_cast<T>(std::sqrt(squared_distance(a, b, feature_number)));
+    }
+
+    template <size_t feature_number, typename T>
+    void distances(const T* v, const T* frames, size_t stride, size_t count, T* distances_out) const
+    {
+      squared_distances(v, frames, stride, count, feature_number, distances_out);
+      for (size_t k=0; k<count; ++k)
+        distances_out[k] = static_cast<T>(std::sqrt(distances_out[k]));
+    }
+
+    template <typename T, size_t feature_number>
+    T distance(const boost::array<T, feature_number>& a,
+               const boost::array<T, feature_number>& b) const
+    {
+      return distance<feature_number>(a.data(), b.data());
+    }
+  };
+
+  // The squared Euclidean distance. Saves the square root of each cell, but
+  // weights large differences more than Euclidean does, so the alignment
+  // (and not only the scale of the distance) may differ.
+  struct SquaredEuclidean
+  {
+    template <size_t feature_number, typename T>
+    T distance(const T* a, const T* b) const
+    {
+      return squared_distance(a, b, feature_number);
+    }
+
+    template <size_t feature_number, typename T>
+    void distances(const T* v, const T* frames, size_t stride, size_t count, T* distances_out) const
+    {
+      squared_distances(v, frames, stride, count, feature_number, distances_out);
+    }
+
+    template <typename T, size_t feature_number>
+    T distance(const boost::array<T, feature_number>& a,
+               const boost::array<T, feature_number>& b) const
+    {
+      return distance<feature_number>(a.data(), b.data());
+    }
+  };
+
+  // The Euclidean distance with a weight for each dimension, e.g. to weight
+  // the cepstra of the MFCC features differently. All weights 1 give the
+  // Euclidean distance.
+  template <typename T, size_t feature_number>
+  class WeightedEuclidean
+  {
+  public:
+    typedef boost::array<T, feature_number> Weights;
+
+    WeightedEuclidean() { weights_.assign(1); }
+    explicit WeightedEuclidean(const Weights& weights) : weights_(weights) {}
+
+    const Weights& weights() const { return weights_; }
+
+    template <size_t n>
+    T distance(const T* a, const T* b) const
+    {
+      BOOST_STATIC_ASSERT(n == feature_number);
+      return static_cast<T>(std::sqrt(weighted_squared_distance(a, b, weights_.data(), n)));
+    }
+
+    template <size_t n>
+    void distances(const T* v, const T* frames, size_t stride, size_t count, T* distances_out) const
+    {
+      for (size_t k=0; k<count; ++k)
+        distances_out[k] = distance<n>(v, frames + k*stride);
+    }
+
+    T distance(const boost::array<T, feature_number>& a,
+               const boost::array<T, feature_number>& b) const
+    {
+      return distance<feature_number>(a.data(), b.data());
+    }
+
+  private:
+    Weights weights_;
+  };
+
+  // The cosine distance 1-cos(a, b), which ignores the length of the
+  // vectors. A zero vector has distance 0 to another zero vector and 1 to
+  // any other vector.
+  struct Cosine
+  {
+    template <size_t feature_number, typename T>
+    T distance(const T* a, const T* b) const
+    {
+      return cosine_distance<feature_number>(a, dot_product(a, a, feature_number), b);
+    }
+
+    template <size_t feature_number, typename T>
+    void distances(const T* v, const T* frames, size_t stride, size_t count, T* distances_out) const
+    {
+      const T v_squared_norm = dot_product(v, v, feature_number);
+      for (size_t k=0; k<count; ++k)
+        distances_out[k] = cosine_distance<feature_number>(v, v_squared_norm, frames + k*stride);
+    }
+
+    template <typename T, size_t feature_number>
+    T distance(const boost::array<T, feature_number>& a,
+               const boost::array<T, feature_number>& b) const
+    {
+      return distance<feature_number>(a.data(), b.data());
+    }
+
+  private:
+    template <size_t feature_number, typename T>
+    static T cosine_distance(const T* a, T a_squared_norm, const T* b)
+    {
+      const T b_squared_norm = dot_product(b, b, feature_number);
+      const T norms = a_squared_norm*b_squared_norm;
+      if (norms == 0)
+        return (a_squared_norm == b_squared_norm) ? T(0) : T(1);
+      return 1-dot_product(a, b, feature_number)/static_cast<T>(std::sqrt(norms));
+    }
+  };
+}
+
+#endif // WORD_MATCH_DISTANCE_METRICS_HPP
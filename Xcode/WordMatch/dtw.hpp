@@ -23,78 +23,156 @@
 #define WORD_MATCH_DTW_HPP
 
 #include <boost/multi_array.hpp>
-#include <boost/bind.hpp>
+#include <boost/array.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include "dtw_window.hpp"
+#include "feature_distance.hpp"
+#include "step_patterns.hpp"
+#include "distance_metrics.hpp"
+#include "gemm_distances.hpp"
+#include "packed_steps.hpp"
+#include "feature_sequence.hpp"
 #include <vector>
 #include <cmath>
 #include <algorithm>
 
-namespace
-{
-  template <typename iterator, typename element>
-  size_t index_of(iterator first, iterator last, element e);
-}
-
 namespace simod1
 {
   template <typename T, size_t feature_number>
   T vector_distance(const boost::array<T, feature_number>& v1,
                     const boost::array<T, feature_number>& v2);
 
-  template <typename T = double, size_t feature_number=3>
+  template <typename T, size_t feature_number>
+  void vector_distances(const boost::array<T, feature_number>& v,
+                        const boost::array<T, feature_number>* vectors,
+                        size_t count,
+                        T* distances_out);
+
+  template <typename T, size_t feature_number>
+  T vector_distance(const T* v1, const T* v2);
+
+  template <typename T, size_t feature_number>
+  void vector_distances(const T* v,
+                        const T* frames,
+                        size_t stride,
+                        size_t count,
+                        T* distances_out);
+
+  // Fills the local distance matrix d (a.size() x b.size()) of a and b, row
+  // by row with the one-to-many kernel of metric.
+  template <typename Metric, typename T, size_t feature_number, typename DistanceMatrix>
+  void local_distance_matrix(const Metric& metric,
+                             const FeatureSequenceView<T, feature_number>& a,
+                             const FeatureSequenceView<T, feature_number>& b,
+                             DistanceMatrix& d);
+
+  // GemmEuclidean computes the whole matrix as one matrix multiply, with a
+  // GemmDistances for b built by every call. The DTW constructor that takes
+  // a GemmDistances reuses one per template instead.
+  template <typename T, size_t feature_number, typename DistanceMatrix>
+  void local_distance_matrix(const GemmEuclidean& metric,
+                             const FeatureSequenceView<T, feature_number>& a,
+                             const FeatureSequenceView<T, feature_number>& b,
+                             DistanceMatrix& d);
+
+  // The step pattern of the recurrence and the local distance metric are
+  // policies, see step_patterns.hpp and distance_metrics.hpp. The defaults
+  // SymmetricP0 and Euclidean are what DTW has always used.
+  template <typename T = double,
+            size_t feature_number=3,
+            typename StepPattern = SymmetricP0,
+            typename Metric = Euclidean>
   class DTW
   {
   public:
     typedef boost::array<T, feature_number> FeatureVector;
     typedef std::vector<FeatureVector> Features;
+    typedef FeatureSequenceView<T, feature_number> FeatureSequence;
     typedef boost::multi_array<T, 2> DistanceMatrix;
     typedef std::pair<unsigned, unsigned> Coordinate;
     typedef std::vector<Coordinate> Path;
     static const size_t feature_number_size = feature_number;
-    DTW(const Features& a, const Features& b, unsigned adjustment_window_size);
+    // The features are only read by the constructor, they are not copied.
+    DTW(const FeatureSequence& a,
+        const FeatureSequence& b,
+        unsigned adjustment_window_size,
+        const Metric& metric = Metric());
+    // The local distances of a to the template of b, the way GemmEuclidean
+    // computes them, but with the squared norms b keeps for its frames. For
+    // matching many queries against the same templates. Only for Metric
+    // GemmEuclidean.
+    DTW(const FeatureSequence& a,
+        const GemmDistances<T, feature_number>& b,
+        unsigned adjustment_window_size);
     ~DTW() {}
     T minimum_distance() const { return minimum_distance_; }
+    // the path in forward order, without the last cell
     Path minimal_path();
-    DistanceMatrix local_distances() const { return d; }
-    DistanceMatrix global_distances() const { return g; }
+    const DistanceMatrix& local_distances() const { return d; }
+    const DistanceMatrix& global_distances() const { return g; }
   private:
-    const Features features_a;
-    const Features features_b;
     const unsigned r;
     DistanceMatrix d;
     DistanceMatrix g;
     T minimum_distance_;
-    typedef boost::multi_array<unsigned short, 2> step_matrix;
-    step_matrix steps;
-    void init_local_distance_matrix();
+    PackedSteps<StepPattern::step_bits> steps;
+    static void check_arguments(size_t a_size, size_t b_size, unsigned r);
+    void init_local_distance_matrix(const FeatureSequence& a,
+                                    const FeatureSequence& b,
+                                    const Metric& metric);
     void init_global_distance_matrix();
     void calculate_global_distance_matrix();
     void calculate_minimum_distance();
   };
 
-  template <typename T, size_t feature_number>
-  DTW<T, feature_number>::DTW(const Features& a,
-                              const Features& b,
-                              unsigned adjustment_window_size)
-    : features_a(a),
-      features_b(b),
-      r(adjustment_window_size),
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  DTW<T, feature_number, StepPattern, Metric>::DTW(const FeatureSequence& a,
+                                                   const FeatureSequence& b,
+                                                   unsigned adjustment_window_size,
+                                                   const Metric& metric)
+    : r(adjustment_window_size),
       d(boost::extents[a.size()][b.size()]),
       g(boost::extents[a.size()+1][b.size()+1]),
-      steps(boost::extents[a.size()][b.size()])
+      steps(a.size(), b.size())
   {
-    if ((a.size() == 0) || (b.size() == 0))
-      throw std::logic_error("feature argument empty");
-    if (adjustment_window_size == 0)
-      throw std::logic_error("adjustment window size cannot be zero");
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    init_local_distance_matrix(a, b, metric);
+    init_global_distance_matrix();
+    calculate_global_distance_matrix();
+    calculate_minimum_distance();
+  }
 
-    init_local_distance_matrix();
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  DTW<T, feature_number, StepPattern, Metric>::DTW(const FeatureSequence& a,
+                                                   const GemmDistances<T, feature_number>& b,
+                                                   unsigned adjustment_window_size)
+    : r(adjustment_window_size),
+      d(boost::extents[a.size()][b.size()]),
+      g(boost::extents[a.size()+1][b.size()+1]),
+      steps(a.size(), b.size())
+  {
+    BOOST_STATIC_ASSERT((boost::is_same<Metric, GemmEuclidean>::value));
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    b.block(a, 0, b.size(), d.origin(), b.size());
     init_global_distance_matrix();
     calculate_global_distance_matrix();
     calculate_minimum_distance();
   }
 
-  template <typename T, size_t feature_number>
-  void DTW<T, feature_number>::init_global_distance_matrix()
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  void DTW<T, feature_number, StepPattern, Metric>::check_arguments(size_t a_size,
+                                                                    size_t b_size,
+                                                                    unsigned r)
+  {
+    if ((a_size == 0) || (b_size == 0))
+      throw std::logic_error("feature argument empty");
+    if (r == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+  }
+
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  void DTW<T, feature_number, StepPattern, Metric>::init_global_distance_matrix()
   {
     T max_value = std::numeric_limits<T>::max();
     if (std::numeric_limits<T>::has_infinity)
@@ -102,78 +180,79 @@ namespace simod1
     std::fill(g.origin(), g.origin()+g.num_elements(), max_value);
   }
 
-  template <typename T, size_t feature_number>
-  void DTW<T, feature_number>::init_local_distance_matrix()
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  void DTW<T, feature_number, StepPattern, Metric>::init_local_distance_matrix(const FeatureSequence& a,
+                                                                             const FeatureSequence& b,
+                                                                             const Metric& metric)
   {
-    for (typename DistanceMatrix::size_type i=0; i<features_a.size(); ++i)
-      for (typename DistanceMatrix::size_type j=0; j<features_b.size(); ++j)
-        d[i][j] = vector_distance<T, feature_number>(features_a[i], features_b[j]);
+    local_distance_matrix(metric, a, b, d);
   }
 
-  template <typename T, size_t feature_number>
-  void DTW<T, feature_number>::calculate_global_distance_matrix()
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  void DTW<T, feature_number, StepPattern, Metric>::calculate_global_distance_matrix()
   {
-    g[0][0] = 2*d[0][0];
-    const T slope = static_cast<T>(features_b.size())/static_cast<T>(features_a.size());
+    g[0][0] = StepPattern::origin(d[0][0]);
+    const T slope = static_cast<T>(d.shape()[1])/static_cast<T>(d.shape()[0]);
     for (typename DistanceMatrix::size_type i=1; i!=g.size(); ++i)
       for (typename DistanceMatrix::size_type j=1; j!=g[i].size(); ++j)
       {
-        if (std::fabs(i-(j/slope)) > r)
+        if (outside_adjustment_window(i, j, slope, r))
           continue;
-        const T distances[] = {
-            g[i  ][j-1] +   d[i-1][j-1],
-            g[i-1][j-1] + 2*d[i-1][j-1],
-            g[i-1][j  ] +   d[i-1][j-1]
-          };
-        const T min_distance = *std::min_element(distances, distances+3);
-        steps[i-1][j-1] = index_of(distances, distances+3, min_distance);
-        g[i][j] = min_distance;
+        unsigned short step;
+        g[i][j] = StepPattern::template cell<T>(g, d, i, j, step);
+        steps.set(i-1, j-1, step);
       }
   }
 
-  template <typename T, size_t feature_number>
-  void DTW<T, feature_number>::calculate_minimum_distance()
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  void DTW<T, feature_number, StepPattern, Metric>::calculate_minimum_distance()
   {
     typename DistanceMatrix::size_type I = g.size()-1;
     typename DistanceMatrix::size_type J = g[I].size()-1;
-    minimum_distance_ = g[I][J]/(I+J);
+    minimum_distance_ = g[I][J]/StepPattern::normalization(I, J);
   }
 
-  template <typename T, size_t feature_number>
-  typename DTW<T, feature_number>::Path DTW<T, feature_number>::minimal_path()
+  template <typename T, size_t feature_number, typename StepPattern, typename Metric>
+  typename DTW<T, feature_number, StepPattern, Metric>::Path DTW<T, feature_number, StepPattern, Metric>::minimal_path()
   {
-    typename DTW::step_matrix::size_type i = steps.shape()[0]-1;
-    typename DTW::step_matrix::size_type j = steps.shape()[1]-1;
+    size_t i = steps.rows()-1;
+    size_t j = steps.columns()-1;
     typename DTW::Path min_path;
 
     while ((i>0) && (j>0))
     {
-      switch (steps[i][j])
-      {
-        case 0:
-          //we got here from g(i, j-1)
-          --j;
-          break;
-        case 1:
-          // we got here from g(i-1, j-1)
-          --i;
-          --j;
-          break;
-        case 2:
-          // we got here from g(i-1, j)
-          --i;
-          break;
-        default:
-          throw std::logic_error("Oh noes!!1 This cannot have happened.");
-      }
-      min_path.push_back(std::make_pair(i, j));
+      // moves (i, j) back to the cell we got here from
+      if (!StepPattern::trace(steps(i, j), i, j, min_path))
+        throw std::logic_error("Oh noes!!1 This cannot have happened.");
     }
-    typename DTW::Path retval;
-    std::copy(min_path.rbegin(), min_path.rend(), std::back_inserter(retval));
-    return retval;
+    std::reverse(min_path.begin(), min_path.end());
+    return min_path;
+  }
+
+
+  template <typename Metric, typename T, size_t feature_number, typename DistanceMatrix>
+  void local_distance_matrix(const Metric& metric,
+                             const FeatureSequenceView<T, feature_number>& a,
+                             const FeatureSequenceView<T, feature_number>& b,
+                             DistanceMatrix& d)
+  {
+    for (typename DistanceMatrix::size_type i=0; i<a.size(); ++i)
+      metric.template distances<feature_number>(a[i],
+                                                b.data(),
+                                                b.stride(),
+                                                b.size(),
+                                                &d[i][0]);
+  }
+
+  template <typename T, size_t feature_number, typename DistanceMatrix>
+  void local_distance_matrix(const GemmEuclidean&,
+                             const FeatureSequenceView<T, feature_number>& a,
+                             const FeatureSequenceView<T, feature_number>& b,
+                             DistanceMatrix& d)
+  {
+    GemmDistances<T, feature_number>(b).block(a, 0, b.size(), d.origin(), b.size());
   }
 
-    
   //Note: since we are now using this for boost::array types, the size is
   //part of the template arguments and therefore we can be sure that v1 and v2
   //are equally sized.
@@ -181,27 +260,37 @@ namespace simod1
   T vector_distance(const boost::array<T, feature_number>& v1,
                     const boost::array<T, feature_number>& v2)
   {
+    return Euclidean().distance(v1, v2);
+  }
 
-    typename boost::array<T, feature_number> d;
-    for (typename boost::array<T, feature_number>::size_type i=0; i<v1.size(); ++i)
-      d[i] = (v1[i]-v2[i]);
-    std::transform(d.begin(),
-                   d.end(),
-                   d.begin(),
-                   boost::bind<T, T(&)(T, T)>(std::pow,
-                                              _1,
-                                              2));
-    return (T)std::sqrt(std::accumulate(d.begin(), d.end(), 0));
+  // Euclidean distances of v to count consecutive vectors. Gives exactly the
+  // same values as calling vector_distance for each of them, but uses the
+  // vectorized one-to-many kernel.
+  template <typename T, size_t feature_number>
+  void vector_distances(const boost::array<T, feature_number>& v,
+                        const boost::array<T, feature_number>* vectors,
+                        size_t count,
+                        T* distances_out)
+  {
+    Euclidean().distances<feature_number>(v.data(), vectors->data(), feature_number, count, distances_out);
   }
-}
 
-namespace
-{
-  template <typename iterator, typename element>
-  size_t index_of(iterator first, iterator last, element e)
+  template <typename T, size_t feature_number>
+  T vector_distance(const T* v1, const T* v2)
+  {
+    return Euclidean().distance<feature_number>(v1, v2);
+  }
+
+  // Euclidean distances of v to count vectors, the first one at frames, each
+  // following one stride values after the previous one.
+  template <typename T, size_t feature_number>
+  void vector_distances(const T* v,
+                        const T* frames,
+                        size_t stride,
+                        size_t count,
+                        T* distances_out)
   {
-    iterator i = std::find(first, last, e);
-    return std::distance(first, i);
+    Euclidean().distances<feature_number>(v, frames, stride, count, distances_out);
   }
 }
 
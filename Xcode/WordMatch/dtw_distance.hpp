@@ -0,0 +1,289 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_DTW_DISTANCE_HPP
+#define WORD_MATCH_DTW_DISTANCE_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+#include "quantized_features.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace simod1
+{
+  // The rows DTWDistance works on. They are only ever grown, so a workspace
+  // that is reused for many comparisons (see DTWEngine) stops allocating
+  // once it has seen the longest sequence b.
+  template <typename T>
+  struct DTWDistanceWorkspace
+  {
+    typedef std::vector<T> Row;
+    Row previous;
+    Row current;
+    Row local;
+  };
+
+  // Euclidean local distances to the frames of a FeatureSequence, with the
+  // same interface as QuantizedFeatures
+  template <typename T, size_t feature_number>
+  struct SequenceDistances
+  {
+    explicit SequenceDistances(const FeatureSequenceView<T, feature_number>& b) : b(b) {}
+    size_t size() const { return b.size(); }
+    void distances(const T* query, size_t first, size_t count, T* distances_out) const
+    {
+      vector_distances<T, feature_number>(query, b[first], b.stride(), count, distances_out);
+    }
+    const FeatureSequenceView<T, feature_number>& b;
+  };
+
+  // The calculation of DTWDistance on the rows of workspace. Returns the
+  // minimum distance, or the maximum value if the calculation was abandoned
+  // at row abandoned_row (0 if it was not). b is a FeatureSequence wrapped
+  // by SequenceDistances or QuantizedFeatures.
+  template <size_t feature_number, typename T, typename Reference>
+  T banded_minimum_distance(const FeatureSequenceView<T, feature_number>& a,
+                            const Reference& b,
+                            unsigned r,
+                            T threshold,
+                            DTWDistanceWorkspace<T>& workspace,
+                            size_t& abandoned_row);
+
+  // Distance-only variant of DTW. It evaluates the same recurrence as
+  // DTW::calculate_global_distance_matrix, but keeps only two rows of the
+  // global distance matrix and computes local distances on the fly. Neither
+  // the local distance matrix nor the traceback is ever allocated, so memory
+  // is O(J) instead of O(I*J), and only the cells within the adjustment window
+  // are visited. minimum_distance() returns exactly the value of
+  // DTW::minimum_distance() for the same arguments.
+  //
+  // If a threshold is given, the calculation is abandoned as soon as every
+  // cell of a row exceeds threshold*(I+J). Since local distances are never
+  // negative, g cannot decrease along a warping path, and every path crosses
+  // every row, so the minimum distance is known to be above the threshold at
+  // that point. abandoned() then returns true, abandoned_row() the row of g
+  // (1..I) at which the calculation stopped, and minimum_distance() returns
+  // infinity (or the maximum of T). If the calculation is not abandoned the
+  // result is exactly the one without a threshold, even if it turns out to be
+  // above the threshold.
+  //
+  // b may also be given as QuantizedFeatures, whose local distances are
+  // calculated on the encoded frames.
+  template <typename T = double, size_t feature_number=3>
+  class DTWDistance
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::FeatureSequence FeatureSequence;
+    DTWDistance(const FeatureSequence& a, const FeatureSequence& b, unsigned adjustment_window_size);
+    DTWDistance(const FeatureSequence& a, const FeatureSequence& b, unsigned adjustment_window_size,
+                T threshold);
+    template <typename Encoding>
+    DTWDistance(const FeatureSequence& a,
+                const QuantizedFeatures<T, feature_number, Encoding>& b,
+                unsigned adjustment_window_size);
+    template <typename Encoding>
+    DTWDistance(const FeatureSequence& a,
+                const QuantizedFeatures<T, feature_number, Encoding>& b,
+                unsigned adjustment_window_size,
+                T threshold);
+    ~DTWDistance() {}
+    T minimum_distance() const { return minimum_distance_; }
+    bool abandoned() const { return abandoned_row_ != 0; }
+    size_t abandoned_row() const { return abandoned_row_; }
+  private:
+    T minimum_distance_;
+    size_t abandoned_row_;
+    static T no_threshold();
+    void check_arguments(size_t I, size_t J, unsigned r) const;
+    void check_threshold(T threshold) const;
+    template <typename Reference>
+    void calculate_minimum_distance(const FeatureSequence& a, const Reference& b, unsigned r,
+                                    T threshold);
+  };
+
+  template <typename T, size_t feature_number>
+  DTWDistance<T, feature_number>::DTWDistance(const FeatureSequence& a,
+                                              const FeatureSequence& b,
+                                              unsigned adjustment_window_size)
+    : abandoned_row_(0)
+  {
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    calculate_minimum_distance(a, SequenceDistances<T, feature_number>(b), adjustment_window_size, no_threshold());
+  }
+
+  template <typename T, size_t feature_number>
+  DTWDistance<T, feature_number>::DTWDistance(const FeatureSequence& a,
+                                              const FeatureSequence& b,
+                                              unsigned adjustment_window_size,
+                                              T threshold)
+    : abandoned_row_(0)
+  {
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    check_threshold(threshold);
+    calculate_minimum_distance(a, SequenceDistances<T, feature_number>(b), adjustment_window_size, threshold);
+  }
+
+  template <typename T, size_t feature_number>
+  template <typename Encoding>
+  DTWDistance<T, feature_number>::DTWDistance(const FeatureSequence& a,
+                                              const QuantizedFeatures<T, feature_number, Encoding>& b,
+                                              unsigned adjustment_window_size)
+    : abandoned_row_(0)
+  {
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    calculate_minimum_distance(a, b, adjustment_window_size, no_threshold());
+  }
+
+  template <typename T, size_t feature_number>
+  template <typename Encoding>
+  DTWDistance<T, feature_number>::DTWDistance(const FeatureSequence& a,
+                                              const QuantizedFeatures<T, feature_number, Encoding>& b,
+                                              unsigned adjustment_window_size,
+                                              T threshold)
+    : abandoned_row_(0)
+  {
+    check_arguments(a.size(), b.size(), adjustment_window_size);
+    check_threshold(threshold);
+    calculate_minimum_distance(a, b, adjustment_window_size, threshold);
+  }
+
+  template <typename T, size_t feature_number>
+  T DTWDistance<T, feature_number>::no_threshold()
+  {
+    if (std::numeric_limits<T>::has_infinity)
+      return std::numeric_limits<T>::infinity();
+    return std::numeric_limits<T>::max();
+  }
+
+  template <typename T, size_t feature_number>
+  void DTWDistance<T, feature_number>::check_arguments(size_t I,
+                                                       size_t J,
+                                                       unsigned r) const
+  {
+    if ((I == 0) || (J == 0))
+      throw std::logic_error("feature argument empty");
+    if (r == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+  }
+
+  template <typename T, size_t feature_number>
+  void DTWDistance<T, feature_number>::check_threshold(T threshold) const
+  {
+    if (!(threshold >= 0))
+      throw std::logic_error("threshold must not be negative");
+  }
+
+  template <typename T, size_t feature_number>
+  template <typename Reference>
+  void DTWDistance<T, feature_number>::calculate_minimum_distance(const FeatureSequence& a,
+                                                                  const Reference& b,
+                                                                  unsigned r,
+                                                                  T threshold)
+  {
+    DTWDistanceWorkspace<T> workspace;
+    minimum_distance_ = banded_minimum_distance<feature_number>(a, b, r, threshold,
+                                                                workspace, abandoned_row_);
+  }
+
+  template <size_t feature_number, typename T, typename Reference>
+  T banded_minimum_distance(const FeatureSequenceView<T, feature_number>& a,
+                            const Reference& b,
+                            unsigned r,
+                            T threshold,
+                            DTWDistanceWorkspace<T>& workspace,
+                            size_t& abandoned_row)
+  {
+    typedef typename DTWDistanceWorkspace<T>::Row Row;
+
+    T max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    const typename Row::size_type I = a.size();
+    const typename Row::size_type J = b.size();
+    const SakoeChibaBand<T> band(I, J, r);
+
+    // g values above this bound can only lead to a distance above threshold
+    const T bound = (threshold < max_value) ? threshold*(I+J) : max_value;
+
+    // previous and current row of g, both including the border column 0.
+    // Only the cells within the adjustment window are ever written, all other
+    // cells have to stay at max_value.
+    Row& previous = workspace.previous;
+    Row& current = workspace.current;
+    previous.assign(J+1, max_value);
+    current.assign(J+1, max_value);
+    b.distances(a[0], 0, 1, &previous[0]);
+    previous[0] *= 2;
+
+    // local distances of the current row, indexed like g
+    Row& local = workspace.local;
+    local.resize(J+1);
+
+    // columns written to previous, and columns current still holds from the
+    // row before that
+    size_t previous_begin = 0, previous_end = 1;
+    size_t stale_begin = 0, stale_end = 0;
+
+    abandoned_row = 0;
+    for (typename Row::size_type i=1; i<=I; ++i)
+    {
+      std::fill(current.begin()+stale_begin, current.begin()+stale_end, max_value);
+
+      size_t begin, end;
+      band.row(i, begin, end);
+      if (begin < end)
+        b.distances(a[i-1], begin-1, end-begin, &local[begin]);
+      T row_minimum = max_value;
+      for (typename Row::size_type j=begin; j<end; ++j)
+      {
+        const T d = local[j];
+        const T distances[] = {
+            current [j-1] +   d,
+            previous[j-1] + 2*d,
+            previous[j  ] +   d
+          };
+        current[j] = *std::min_element(distances, distances+3);
+        row_minimum = std::min(row_minimum, current[j]);
+      }
+      if (row_minimum > bound)
+      {
+        abandoned_row = i;
+        return max_value;
+      }
+      stale_begin = previous_begin;
+      stale_end = previous_end;
+      previous_begin = begin;
+      previous_end = end;
+      previous.swap(current);
+    }
+    return previous[J]/(I+J);
+  }
+}
+
+#endif // WORD_MATCH_DTW_DISTANCE_HPP
@@ -0,0 +1,184 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#ifndef WORD_MATCH_DTW_ENGINE_HPP
+#define WORD_MATCH_DTW_ENGINE_HPP
+
+#include "dtw.hpp"
+#include "dtw_distance.hpp"
+#include "dtw_window.hpp"
+#include "packed_steps.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Repeated comparisons without allocations. DTW and DTWDistance allocate
+  // their matrices and rows for every comparison; an engine keeps them
+  // between comparisons and only grows them when a longer sequence comes
+  // along. Once it has seen the longest sequences, comparisons make no heap
+  // allocations at all.
+  //
+  // minimum_distance() returns exactly DTWDistance(a, b, r[, threshold])
+  // .minimum_distance(), align() exactly DTW(a, b, r).minimum_distance() and
+  // minimal_path() then DTW::minimal_path(). An engine is not thread-safe,
+  // every thread needs its own.
+  template <typename T = double, size_t feature_number=3>
+  class DTWEngine
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureSequence FeatureSequence;
+    typedef typename DTW<T, feature_number>::Path Path;
+    DTWEngine()
+      : abandoned_row_(0),
+        steps(0, 0) {}
+    ~DTWEngine() {}
+    T minimum_distance(const FeatureSequence& a, const FeatureSequence& b, unsigned adjustment_window_size);
+    T minimum_distance(const FeatureSequence& a, const FeatureSequence& b, unsigned adjustment_window_size,
+                       T threshold);
+    // the row at which the last minimum_distance() was abandoned, 0 if not
+    size_t abandoned_row() const { return abandoned_row_; }
+    T align(const FeatureSequence& a, const FeatureSequence& b, unsigned adjustment_window_size);
+    // the path of the last align(), in the format of DTW::minimal_path()
+    const Path& minimal_path() const { return path; }
+  private:
+    // g or d stored row by row, indexable as matrix[i][j]
+    struct Rows
+    {
+      Rows(const T* data, size_t stride) : data(data), stride(stride) {}
+      const T* operator[](size_t i) const { return data + i*stride; }
+      const T* data;
+      const size_t stride;
+    };
+
+    DTWDistanceWorkspace<T> rows;
+    size_t abandoned_row_;
+    std::vector<T> d;
+    std::vector<T> g;
+    PackedSteps<SymmetricP0::step_bits> steps;
+    Path path;
+
+    static void check_arguments(const FeatureSequence& a, const FeatureSequence& b, unsigned r);
+    void trace_path();
+  };
+
+  template <typename T, size_t feature_number>
+  T DTWEngine<T, feature_number>::minimum_distance(const FeatureSequence& a,
+                                                   const FeatureSequence& b,
+                                                   unsigned adjustment_window_size)
+  {
+    T no_threshold = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      no_threshold = std::numeric_limits<T>::infinity();
+    return minimum_distance(a, b, adjustment_window_size, no_threshold);
+  }
+
+  template <typename T, size_t feature_number>
+  T DTWEngine<T, feature_number>::minimum_distance(const FeatureSequence& a,
+                                                   const FeatureSequence& b,
+                                                   unsigned adjustment_window_size,
+                                                   T threshold)
+  {
+    check_arguments(a, b, adjustment_window_size);
+    if (!(threshold >= 0))
+      throw std::logic_error("threshold must not be negative");
+    return banded_minimum_distance<feature_number>(a,
+                                                   SequenceDistances<T, feature_number>(b),
+                                                   adjustment_window_size,
+                                                   threshold,
+                                                   rows,
+                                                   abandoned_row_);
+  }
+
+  template <typename T, size_t feature_number>
+  T DTWEngine<T, feature_number>::align(const FeatureSequence& a,
+                                        const FeatureSequence& b,
+                                        unsigned adjustment_window_size)
+  {
+    check_arguments(a, b, adjustment_window_size);
+
+    T max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    const size_t I = a.size();
+    const size_t J = b.size();
+    d.resize(I*J);
+    g.assign((I+1)*(J+1), max_value);
+    steps.reset(I, J);
+
+    for (size_t i=0; i<I; ++i)
+      vector_distances<T, feature_number>(a[i], b.data(), b.stride(), J, &d[i*J]);
+
+    // the same cells as DTW::calculate_global_distance_matrix, but only
+    // those within the window are visited
+    const Rows local(&d[0], J);
+    const Rows global(&g[0], J+1);
+    const SakoeChibaBand<T> band(I, J, adjustment_window_size);
+    g[0] = SymmetricP0::origin(d[0]);
+    for (size_t i=1; i<=I; ++i)
+    {
+      size_t begin, end;
+      band.row(i, begin, end);
+      for (size_t j=begin; j<end; ++j)
+      {
+        unsigned short step;
+        g[i*(J+1)+j] = SymmetricP0::cell<T>(global, local, i, j, step);
+        steps.set(i-1, j-1, step);
+      }
+    }
+
+    trace_path();
+    return g[I*(J+1)+J]/SymmetricP0::normalization(I, J);
+  }
+
+  template <typename T, size_t feature_number>
+  void DTWEngine<T, feature_number>::trace_path()
+  {
+    size_t i = steps.rows()-1;
+    size_t j = steps.columns()-1;
+    path.clear();
+
+    while ((i>0) && (j>0))
+    {
+      if (!SymmetricP0::trace(steps(i, j), i, j, path))
+        throw std::logic_error("invalid step in traceback");
+    }
+    std::reverse(path.begin(), path.end());
+  }
+
+  template <typename T, size_t feature_number>
+  void DTWEngine<T, feature_number>::check_arguments(const FeatureSequence& a,
+                                                     const FeatureSequence& b,
+                                                     unsigned r)
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+    if (r == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+  }
+}
+
+#endif // WORD_MATCH_DTW_ENGINE_HPP
@@ -0,0 +1,182 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_DTW_WINDOW_HPP
+#define WORD_MATCH_DTW_WINDOW_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Returns true if cell (i, j) of the global distance matrix g lies outside
+  // of the Sakoe-Chiba adjustment window. Every DTW variant has to use this
+  // exact expression, otherwise rounding could select a different set of
+  // cells than DTW and the distances would no longer be identical.
+  template <typename T>
+  inline bool outside_adjustment_window(size_t i, size_t j, T slope, unsigned r)
+  {
+    return std::fabs(i-(j/slope)) > r;
+  }
+
+  // Computes the columns of each row of g (1..I, 1..J) that lie within the
+  // Sakoe-Chiba adjustment window, without visiting the cells outside of it.
+  // Since j/slope grows monotonically with j, the cells of a row within the
+  // window are always contiguous.
+  template <typename T>
+  class SakoeChibaBand
+  {
+  public:
+    SakoeChibaBand(size_t I, size_t J, unsigned r)
+      : I_(I),
+        J_(J),
+        r_(r),
+        slope_(static_cast<T>(J)/static_cast<T>(I)) {}
+
+    // Sets [begin, end) to the columns of row i (1..I) within the window. If
+    // no column of this row is within the window, begin == end.
+    void row(size_t i, size_t& begin, size_t& end) const
+    {
+      // start just below the estimated left edge and move to the exact edge
+      size_t first = clamp(std::floor((static_cast<T>(i)-r_)*slope_)-1);
+      while ((first <= J_) &&
+             outside_adjustment_window(i, first, slope_, r_) &&
+             ((i-(first/slope_)) > 0))
+        ++first;
+      if ((first > J_) || outside_adjustment_window(i, first, slope_, r_))
+      {
+        begin = end = 1;
+        return;
+      }
+      while ((first > 1) && !outside_adjustment_window(i, first-1, slope_, r_))
+        --first;
+
+      size_t last = clamp(std::ceil((static_cast<T>(i)+r_)*slope_)+1);
+      while (outside_adjustment_window(i, last, slope_, r_))
+        --last;
+      while ((last < J_) && !outside_adjustment_window(i, last+1, slope_, r_))
+        ++last;
+
+      begin = first;
+      end = last+1;
+    }
+
+    size_t rows() const { return I_; }
+    size_t columns() const { return J_; }
+
+  private:
+    size_t clamp(T column) const
+    {
+      if (column < 1)
+        return 1;
+      if (column > static_cast<T>(J_))
+        return J_;
+      return static_cast<size_t>(column);
+    }
+
+    const size_t I_;
+    const size_t J_;
+    const unsigned r_;
+    const T slope_;
+  };
+
+  // The cells of g that are actually evaluated by a windowed DTW, stored row by
+  // row in a compact layout: row i occupies the columns [begin(i), end(i))
+  // and its cells are stored consecutively starting at offset(i). Row 0 only
+  // holds the start cell (0, 0).
+  class SearchWindow
+  {
+  public:
+    typedef size_t size_type;
+
+    SearchWindow() {}
+
+    template <typename T>
+    explicit SearchWindow(const SakoeChibaBand<T>& band)
+    {
+      const size_type I = band.rows();
+      begin_.resize(I+1);
+      end_.resize(I+1);
+      offset_.resize(I+2);
+      begin_[0] = 0;
+      end_[0] = 1;
+      offset_[0] = 0;
+      offset_[1] = 1;
+      for (size_type i=1; i<=I; ++i)
+      {
+        band.row(i, begin_[i], end_[i]);
+        offset_[i+1] = offset_[i] + (end_[i]-begin_[i]);
+      }
+    }
+
+    // An arbitrary window of rows 1..I, where row i holds the columns
+    // [begin[i-1], end[i-1]) with 1 <= begin <= end <= J+1. Rows may be
+    // empty (begin == end).
+    SearchWindow(const std::vector<size_type>& begin, const std::vector<size_type>& end)
+    {
+      if (begin.size() != end.size())
+        throw std::logic_error("window rows must have a begin and an end");
+
+      const size_type I = begin.size();
+      begin_.resize(I+1);
+      end_.resize(I+1);
+      offset_.resize(I+2);
+      begin_[0] = 0;
+      end_[0] = 1;
+      offset_[0] = 0;
+      offset_[1] = 1;
+      for (size_type i=1; i<=I; ++i)
+      {
+        if ((begin[i-1] == 0) || (begin[i-1] > end[i-1]))
+          throw std::logic_error("invalid window row");
+        begin_[i] = begin[i-1];
+        end_[i] = end[i-1];
+        offset_[i+1] = offset_[i] + (end_[i]-begin_[i]);
+      }
+    }
+
+    size_type rows() const { return begin_.size(); }
+    size_type begin(size_type i) const { return begin_[i]; }
+    size_type end(size_type i) const { return end_[i]; }
+    size_type offset(size_type i) const { return offset_[i]; }
+    size_type num_cells() const { return offset_.back(); }
+
+    bool contains(size_type i, size_type j) const
+    {
+      return (i < rows()) && (j >= begin_[i]) && (j < end_[i]);
+    }
+
+    // index of cell (i, j) in the compact layout, (i, j) must be contained
+    size_type index(size_type i, size_type j) const
+    {
+      return offset_[i] + (j-begin_[i]);
+    }
+
+  private:
+    std::vector<size_type> begin_;
+    std::vector<size_type> end_;
+    std::vector<size_type> offset_;
+  };
+}
+
+#endif // WORD_MATCH_DTW_WINDOW_HPP
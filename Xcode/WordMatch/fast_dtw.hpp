@@ -0,0 +1,197 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_FAST_DTW_HPP
+#define WORD_MATCH_FAST_DTW_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+#include "banded_dtw.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Approximation of DTW in linear time and memory, following FastDTW by
+  // Salvador and Chan. Both sequences are coarsened by averaging pairs of
+  // frames until they are short enough to be aligned exactly. The path found
+  // at each resolution is projected onto the next finer one, widened by
+  // radius frames in every direction, and only the cells within this window
+  // are evaluated there.
+  //
+  // There is no adjustment window, the result approximates DTW with an
+  // adjustment window size of at least max(I, J) from above: the distance
+  // is the one of a valid warping path, with the same step weights and
+  // normalization as DTW, but not necessarily of the best one. A larger
+  // radius gives a better approximation at a higher cost.
+  template <typename T = double, size_t feature_number=3>
+  class FastDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::Coordinate Coordinate;
+    typedef typename DTW<T, feature_number>::Path Path;
+    FastDTW(const Features& a, const Features& b, unsigned radius);
+    ~FastDTW() {}
+    T minimum_distance() const { return minimum_distance_; }
+    // path in the same format as DTW::minimal_path()
+    const Path& minimal_path() const { return minimal_path_; }
+    // number of cells evaluated at all resolutions together
+    size_t evaluated_cells() const { return evaluated_cells_; }
+  private:
+    const unsigned radius_;
+    T minimum_distance_;
+    Path minimal_path_;
+    size_t evaluated_cells_;
+
+    // Aligns a and b and returns the complete path from (0, 0) to the last
+    // cell.
+    Path align(const Features& a, const Features& b, bool finest);
+    static Features coarsen(const Features& features);
+    SearchWindow project(const Path& coarse_path, size_t I, size_t J) const;
+    static Path complete_path(const Path& path, size_t I, size_t J);
+  };
+
+  template <typename T, size_t feature_number>
+  FastDTW<T, feature_number>::FastDTW(const Features& a,
+                                      const Features& b,
+                                      unsigned radius)
+    : radius_(radius),
+      evaluated_cells_(0)
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+
+    align(a, b, true);
+  }
+
+  template <typename T, size_t feature_number>
+  typename FastDTW<T, feature_number>::Path
+  FastDTW<T, feature_number>::align(const Features& a, const Features& b, bool finest)
+  {
+    const size_t I = a.size();
+    const size_t J = b.size();
+    const size_t min_size = radius_+2;
+
+    SearchWindow window;
+    if ((I <= min_size) || (J <= min_size))
+    {
+      // short enough to evaluate every cell
+      window = SearchWindow(std::vector<size_t>(I, 1), std::vector<size_t>(I, J+1));
+    }
+    else
+      window = project(align(coarsen(a), coarsen(b), false), I, J);
+
+    const BandedDTW<T, feature_number> dtw(a, b, window);
+    evaluated_cells_ += window.num_cells();
+    if (finest)
+    {
+      minimum_distance_ = dtw.minimum_distance();
+      minimal_path_ = dtw.minimal_path();
+    }
+    return complete_path(dtw.minimal_path(), I, J);
+  }
+
+  // halves the number of frames, a single frame left over is kept as it is
+  template <typename T, size_t feature_number>
+  typename FastDTW<T, feature_number>::Features
+  FastDTW<T, feature_number>::coarsen(const Features& features)
+  {
+    Features coarse((features.size()+1)/2);
+    for (size_t i=0; i<coarse.size(); ++i)
+    {
+      if (2*i+1 == features.size())
+      {
+        coarse[i] = features[2*i];
+        continue;
+      }
+      for (size_t n=0; n<feature_number; ++n)
+        coarse[i][n] = (features[2*i][n]+features[2*i+1][n])/2;
+    }
+    return coarse;
+  }
+
+  // Each cell of the coarse path covers up to 2x2 cells of the finer
+  // resolution. The window holds these cells, widened by radius rows and
+  // columns. Paths are monotonic, so the window of each row is contiguous.
+  template <typename T, size_t feature_number>
+  SearchWindow FastDTW<T, feature_number>::project(const Path& coarse_path,
+                                                   size_t I,
+                                                   size_t J) const
+  {
+    // columns covered by the projected path in each row (0-based, inclusive)
+    std::vector<size_t> low(I, J), high(I, 0);
+    for (size_t k=0; k<coarse_path.size(); ++k)
+    {
+      const size_t row_first = 2*static_cast<size_t>(coarse_path[k].first);
+      const size_t row_last = std::min(row_first+1, I-1);
+      const size_t column_first = 2*static_cast<size_t>(coarse_path[k].second);
+      const size_t column_last = std::min(column_first+1, J-1);
+      for (size_t i=row_first; i<=row_last; ++i)
+      {
+        low[i] = std::min(low[i], column_first);
+        high[i] = std::max(high[i], column_last);
+      }
+    }
+
+    std::vector<size_t> begin(I), end(I);
+    for (size_t i=0; i<I; ++i)
+    {
+      const size_t first_row = (i > radius_) ? i-radius_ : 0;
+      const size_t last_row = std::min(i+radius_, I-1);
+      size_t row_low = J, row_high = 0;
+      for (size_t k=first_row; k<=last_row; ++k)
+      {
+        row_low = std::min(row_low, low[k]);
+        row_high = std::max(row_high, high[k]);
+      }
+      // convert to columns of g
+      begin[i] = ((row_low > radius_) ? row_low-radius_ : 0) + 1;
+      end[i] = std::min(row_high+radius_, J-1) + 2;
+    }
+    return SearchWindow(begin, end);
+  }
+
+  // Adds the cells DTW::minimal_path() leaves out: the cells from (0, 0) to
+  // the first cell of the path along the border, and the last cell.
+  template <typename T, size_t feature_number>
+  typename FastDTW<T, feature_number>::Path
+  FastDTW<T, feature_number>::complete_path(const Path& path, size_t I, size_t J)
+  {
+    Path complete;
+    complete.reserve(path.size()+I+J);
+    const Coordinate first = path.empty() ? Coordinate(I-1, J-1) : path.front();
+    if (first.first == 0)
+      for (unsigned j=0; j<first.second; ++j)
+        complete.push_back(Coordinate(0, j));
+    else
+      for (unsigned i=0; i<first.first; ++i)
+        complete.push_back(Coordinate(i, 0));
+    complete.insert(complete.end(), path.begin(), path.end());
+    complete.push_back(Coordinate(I-1, J-1));
+    return complete;
+  }
+}
+
+#endif // WORD_MATCH_FAST_DTW_HPP
@@ -0,0 +1,299 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_FEATURE_DISTANCE_HPP
+#define WORD_MATCH_FEATURE_DISTANCE_HPP
+
+// Distance kernels for feature vectors. These are the innermost loop of every
+// DTW comparison, so single precision has vectorized versions for SSE and
+// NEON, the squared Euclidean distance for AVX as well. All other types, and
+// builds that define SIMOD1_NO_SIMD, use the portable scalar versions.
+//
+// The vectorized one-to-one and one-to-many kernels accumulate in exactly the
+// same order, i.e. squared_distances() gives bit-identical results to calling
+// squared_distance() for each frame. The DTW variants rely on this, as they
+// must not depend on which of the two kernels computed a local distance.
+
+#include <cstddef>
+
+#if !defined(SIMOD1_NO_SIMD)
+#  if defined(__AVX__)
+#    define SIMOD1_SIMD_AVX
+#    define SIMOD1_SIMD_SSE
+#    include <immintrin.h>
+#  elif defined(__SSE__) || defined(__x86_64__)
+#    define SIMOD1_SIMD_SSE
+#    include <xmmintrin.h>
+#  elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#    define SIMOD1_SIMD_NEON
+#    include <arm_neon.h>
+#  endif
+#endif
+
+namespace simod1
+{
+  // Returns the squared Euclidean distance of the vectors a and b, both of
+  // length n.
+  template <typename T>
+  inline T squared_distance(const T* a, const T* b, size_t n)
+  {
+    T sum = 0;
+    for (size_t k=0; k<n; ++k)
+    {
+      const T d = a[k]-b[k];
+      sum += d*d;
+    }
+    return sum;
+  }
+
+  // Calculates the squared Euclidean distances of the vector query against
+  // num_frames vectors, all of length n. The first vector starts at frames,
+  // each following one stride elements after the previous one. out has to
+  // accommodate num_frames elements.
+  template <typename T>
+  inline void squared_distances(const T* query,
+                                const T* frames,
+                                size_t stride,
+                                size_t num_frames,
+                                size_t n,
+                                T* out)
+  {
+    for (size_t f=0; f<num_frames; ++f)
+      out[f] = squared_distance(query, frames + f*stride, n);
+  }
+
+  // Returns the squared Euclidean distance of the vectors a and b, both of
+  // length n, with the squared difference of dimension k weighted by w[k].
+  template <typename T>
+  inline T weighted_squared_distance(const T* a, const T* b, const T* w, size_t n)
+  {
+    T sum = 0;
+    for (size_t k=0; k<n; ++k)
+    {
+      const T d = a[k]-b[k];
+      sum += w[k]*d*d;
+    }
+    return sum;
+  }
+
+  // Returns the dot product of the vectors a and b, both of length n.
+  template <typename T>
+  inline T dot_product(const T* a, const T* b, size_t n)
+  {
+    T sum = 0;
+    for (size_t k=0; k<n; ++k)
+      sum += a[k]*b[k];
+    return sum;
+  }
+
+#if defined(SIMOD1_SIMD_SSE)
+
+  namespace detail
+  {
+    // Sum of squared differences of all full 4-lane (or 8-lane) chunks of a
+    // and b, as 4 partial sums. k is set to the number of elements consumed.
+    inline __m128 squared_difference_chunks(const float* a,
+                                            const float* b,
+                                            size_t n,
+                                            size_t& k)
+    {
+      __m128 acc = _mm_setzero_ps();
+      k = 0;
+#if defined(SIMOD1_SIMD_AVX)
+      if (n >= 8)
+      {
+        __m256 acc8 = _mm256_setzero_ps();
+        for (; k<n-n%8; k+=8)
+        {
+          const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a+k), _mm256_loadu_ps(b+k));
+          acc8 = _mm256_add_ps(acc8, _mm256_mul_ps(d, d));
+        }
+        acc = _mm_add_ps(_mm256_castps256_ps128(acc8),
+                         _mm256_extractf128_ps(acc8, 1));
+      }
+#endif
+      for (; k<n-n%4; k+=4)
+      {
+        const __m128 d = _mm_sub_ps(_mm_loadu_ps(a+k), _mm_loadu_ps(b+k));
+        acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+      }
+      return acc;
+    }
+
+    // (l0+l1)+(l2+l3), the same order as the transposed sum in
+    // squared_distances
+    inline float horizontal_sum(__m128 v)
+    {
+      const __m128 pairs = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+      return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_movehl_ps(pairs, pairs)));
+    }
+
+    inline float squared_difference_tail(const float* a,
+                                         const float* b,
+                                         size_t k,
+                                         size_t n,
+                                         float sum)
+    {
+      for (; k<n; ++k)
+      {
+        const float d = a[k]-b[k];
+        sum += d*d;
+      }
+      return sum;
+    }
+  }
+
+  template <>
+  inline float squared_distance<float>(const float* a, const float* b, size_t n)
+  {
+    size_t k;
+    const __m128 acc = detail::squared_difference_chunks(a, b, n, k);
+    return detail::squared_difference_tail(a, b, k, n, detail::horizontal_sum(acc));
+  }
+
+  template <>
+  inline void squared_distances<float>(const float* query,
+                                       const float* frames,
+                                       size_t stride,
+                                       size_t num_frames,
+                                       size_t n,
+                                       float* out)
+  {
+    // Four frames at a time: transposing the four partial sums gives all four
+    // horizontal sums with three additions.
+    size_t f = 0;
+    size_t k = 0;
+    for (; f+4<=num_frames; f+=4)
+    {
+      const float* frame = frames + f*stride;
+      __m128 s0 = detail::squared_difference_chunks(query, frame,          n, k);
+      __m128 s1 = detail::squared_difference_chunks(query, frame+stride,   n, k);
+      __m128 s2 = detail::squared_difference_chunks(query, frame+2*stride, n, k);
+      __m128 s3 = detail::squared_difference_chunks(query, frame+3*stride, n, k);
+      _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+      _mm_storeu_ps(out+f, _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+      if (k < n)
+        for (size_t i=0; i<4; ++i)
+          out[f+i] = detail::squared_difference_tail(query, frame+i*stride, k, n, out[f+i]);
+    }
+    for (; f<num_frames; ++f)
+      out[f] = squared_distance(query, frames + f*stride, n);
+  }
+
+  template <>
+  inline float weighted_squared_distance<float>(const float* a,
+                                                const float* b,
+                                                const float* w,
+                                                size_t n)
+  {
+    __m128 acc = _mm_setzero_ps();
+    size_t k = 0;
+    for (; k<n-n%4; k+=4)
+    {
+      const __m128 d = _mm_sub_ps(_mm_loadu_ps(a+k), _mm_loadu_ps(b+k));
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(w+k), _mm_mul_ps(d, d)));
+    }
+    float sum = detail::horizontal_sum(acc);
+    for (; k<n; ++k)
+    {
+      const float d = a[k]-b[k];
+      sum += w[k]*d*d;
+    }
+    return sum;
+  }
+
+  template <>
+  inline float dot_product<float>(const float* a, const float* b, size_t n)
+  {
+    __m128 acc = _mm_setzero_ps();
+    size_t k = 0;
+    for (; k<n-n%4; k+=4)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a+k), _mm_loadu_ps(b+k)));
+    float sum = detail::horizontal_sum(acc);
+    for (; k<n; ++k)
+      sum += a[k]*b[k];
+    return sum;
+  }
+
+#elif defined(SIMOD1_SIMD_NEON)
+
+  template <>
+  inline float squared_distance<float>(const float* a, const float* b, size_t n)
+  {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t k = 0;
+    for (; k<n-n%4; k+=4)
+    {
+      const float32x4_t d = vsubq_f32(vld1q_f32(a+k), vld1q_f32(b+k));
+      acc = vmlaq_f32(acc, d, d);
+    }
+    // (l0+l1)+(l2+l3)
+    const float32x2_t pairs = vpadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    for (; k<n; ++k)
+    {
+      const float d = a[k]-b[k];
+      sum += d*d;
+    }
+    return sum;
+  }
+
+  template <>
+  inline float weighted_squared_distance<float>(const float* a,
+                                                const float* b,
+                                                const float* w,
+                                                size_t n)
+  {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t k = 0;
+    for (; k<n-n%4; k+=4)
+    {
+      const float32x4_t d = vsubq_f32(vld1q_f32(a+k), vld1q_f32(b+k));
+      acc = vmlaq_f32(acc, vld1q_f32(w+k), vmulq_f32(d, d));
+    }
+    const float32x2_t pairs = vpadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    for (; k<n; ++k)
+    {
+      const float d = a[k]-b[k];
+      sum += w[k]*d*d;
+    }
+    return sum;
+  }
+
+  template <>
+  inline float dot_product<float>(const float* a, const float* b, size_t n)
+  {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t k = 0;
+    for (; k<n-n%4; k+=4)
+      acc = vmlaq_f32(acc, vld1q_f32(a+k), vld1q_f32(b+k));
+    const float32x2_t pairs = vpadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    float sum = vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+    for (; k<n; ++k)
+      sum += a[k]*b[k];
+    return sum;
+  }
+
+#endif
+}
+
+#endif // WORD_MATCH_FEATURE_DISTANCE_HPP
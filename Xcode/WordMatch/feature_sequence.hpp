@@ -0,0 +1,89 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_FEATURE_SEQUENCE_HPP
+#define WORD_MATCH_FEATURE_SEQUENCE_HPP
+
+#include <boost/array.hpp>
+#include <vector>
+#include <cstddef>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Non-owning view of a sequence of feature vectors: size() frames of
+  // feature_number values each, the first one at data(), each following one
+  // stride() values after the previous one. A stride larger than
+  // feature_number selects some of the values of wider frames, e.g. cepstra
+  // 1..7 of 13 MFCC coefficients per frame.
+  //
+  // Features convert implicitly, so everything that accepts a view also
+  // accepts Features. The viewed data has to outlive the view.
+  template <typename T, size_t feature_number>
+  class FeatureSequenceView
+  {
+  public:
+    typedef boost::array<T, feature_number> FeatureVector;
+    typedef std::vector<FeatureVector> Features;
+
+    FeatureSequenceView()
+      : data_(NULL),
+        size_(0),
+        stride_(feature_number) {}
+
+    FeatureSequenceView(const T* data, size_t size, size_t stride = feature_number)
+      : data_(data),
+        size_(size),
+        stride_(stride)
+    {
+      if (stride < feature_number)
+        throw std::logic_error("stride smaller than the feature number");
+    }
+
+    // boost::array is a plain aggregate, consecutive vectors are therefore
+    // feature_number values apart
+    FeatureSequenceView(const Features& features)
+      : data_(features.empty() ? NULL : features[0].data()),
+        size_(features.size()),
+        stride_(feature_number) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t stride() const { return stride_; }
+    bool empty() const { return size_ == 0; }
+
+    // the values of frame i
+    const T* operator[](size_t i) const { return data_ + i*stride_; }
+
+    // view of count frames, starting with frame first
+    FeatureSequenceView subsequence(size_t first, size_t count) const
+    {
+      return FeatureSequenceView(data_ + first*stride_, count, stride_);
+    }
+
+  private:
+    const T* data_;
+    size_t size_;
+    size_t stride_;
+  };
+}
+
+#endif // WORD_MATCH_FEATURE_SEQUENCE_HPP
@@ -0,0 +1,303 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+
+#ifndef WORD_MATCH_GEMM_DISTANCES_HPP
+#define WORD_MATCH_GEMM_DISTANCES_HPP
+
+// Euclidean local distances of whole blocks of frames as a matrix multiply:
+// ||a-b||^2 = ||a||^2 + ||b||^2 - 2*a.b, where the dot products of all pairs
+// are A*B^T. On Apple platforms (and with SIMOD1_USE_CBLAS elsewhere) the
+// product is computed by cblas_sgemm/cblas_dgemm, otherwise by a portable
+// blocked kernel. Define SIMOD1_NO_BLAS to always use the portable kernel.
+//
+// The expansion cancels for close vectors, so the distances are not exactly
+// the ones of Euclidean, and a vector's distance to itself is only about
+// zero. Euclidean stays the exact metric for when this matters.
+
+#include "feature_distance.hpp"
+#include "feature_sequence.hpp"
+#include "dtw_window.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+#if !defined(SIMOD1_NO_BLAS)
+#  if defined(__APPLE__)
+#    define SIMOD1_BLAS
+#    include <Accelerate/Accelerate.h>
+#  elif defined(SIMOD1_USE_CBLAS)
+#    define SIMOD1_BLAS
+#    include <cblas.h>
+#  endif
+#endif
+
+namespace simod1
+{
+  namespace detail
+  {
+    // The 4x4 block of C = A*B^T of the rows a, a+lda, .. of A and b, b+ldb,
+    // .. of B. The 16 sums stay in registers, and every value loaded from A
+    // or B takes part in four of them.
+    template <typename T>
+    inline void multiply_transposed_tile(const T* a, size_t lda,
+                                         const T* b, size_t ldb,
+                                         size_t depth,
+                                         T* c, size_t ldc)
+    {
+      const T* a0 = a;
+      const T* a1 = a0+lda;
+      const T* a2 = a1+lda;
+      const T* a3 = a2+lda;
+      const T* b0 = b;
+      const T* b1 = b0+ldb;
+      const T* b2 = b1+ldb;
+      const T* b3 = b2+ldb;
+      T c00 = 0, c01 = 0, c02 = 0, c03 = 0;
+      T c10 = 0, c11 = 0, c12 = 0, c13 = 0;
+      T c20 = 0, c21 = 0, c22 = 0, c23 = 0;
+      T c30 = 0, c31 = 0, c32 = 0, c33 = 0;
+      for (size_t k=0; k<depth; ++k)
+      {
+        const T x0 = a0[k], x1 = a1[k], x2 = a2[k], x3 = a3[k];
+        const T y0 = b0[k], y1 = b1[k], y2 = b2[k], y3 = b3[k];
+        c00 += x0*y0; c01 += x0*y1; c02 += x0*y2; c03 += x0*y3;
+        c10 += x1*y0; c11 += x1*y1; c12 += x1*y2; c13 += x1*y3;
+        c20 += x2*y0; c21 += x2*y1; c22 += x2*y2; c23 += x2*y3;
+        c30 += x3*y0; c31 += x3*y1; c32 += x3*y2; c33 += x3*y3;
+      }
+      T* row = c;
+      row[0] = c00; row[1] = c01; row[2] = c02; row[3] = c03;
+      row += ldc;
+      row[0] = c10; row[1] = c11; row[2] = c12; row[3] = c13;
+      row += ldc;
+      row[0] = c20; row[1] = c21; row[2] = c22; row[3] = c23;
+      row += ldc;
+      row[0] = c30; row[1] = c31; row[2] = c32; row[3] = c33;
+    }
+  }
+
+  // C = A*B^T for the row-major matrices A (rows x depth, rows lda values
+  // apart), B (columns x depth, rows ldb values apart) and C (rows x columns,
+  // rows ldc values apart).
+  template <typename T>
+  inline void multiply_transposed(const T* a, size_t lda, size_t rows,
+                                  const T* b, size_t ldb, size_t columns,
+                                  size_t depth,
+                                  T* c, size_t ldc)
+  {
+    // a block of rows of B stays in the cache while all rows of A pass it,
+    // four rows of A against four of B at a time
+    const size_t block_size = 64;
+    for (size_t j0=0; j0<columns; j0+=block_size)
+    {
+      const size_t j1 = std::min(columns, j0+block_size);
+      size_t i = 0;
+      for (; i+4<=rows; i+=4)
+      {
+        size_t j = j0;
+        for (; j+4<=j1; j+=4)
+          detail::multiply_transposed_tile(a + i*lda, lda, b + j*ldb, ldb, depth, c + i*ldc+j, ldc);
+        for (; j<j1; ++j)
+          for (size_t r=i; r<i+4; ++r)
+            c[r*ldc+j] = dot_product(a + r*lda, b + j*ldb, depth);
+      }
+      for (; i<rows; ++i)
+        for (size_t j=j0; j<j1; ++j)
+          c[i*ldc+j] = dot_product(a + i*lda, b + j*ldb, depth);
+    }
+  }
+
+#if defined(SIMOD1_BLAS)
+
+  template <>
+  inline void multiply_transposed<float>(const float* a, size_t lda, size_t rows,
+                                         const float* b, size_t ldb, size_t columns,
+                                         size_t depth,
+                                         float* c, size_t ldc)
+  {
+    if ((rows == 0) || (columns == 0))
+      return;
+    cblas_sgemm(CblasRowMajor,
+                CblasNoTrans,
+                CblasTrans,
+                rows,
+                columns,
+                depth,
+                1.0f,
+                a,
+                lda,
+                b,
+                ldb,
+                0.0f,
+                c,
+                ldc);
+  }
+
+  template <>
+  inline void multiply_transposed<double>(const double* a, size_t lda, size_t rows,
+                                          const double* b, size_t ldb, size_t columns,
+                                          size_t depth,
+                                          double* c, size_t ldc)
+  {
+    if ((rows == 0) || (columns == 0))
+      return;
+    cblas_dgemm(CblasRowMajor,
+                CblasNoTrans,
+                CblasTrans,
+                rows,
+                columns,
+                depth,
+                1.0,
+                a,
+                lda,
+                b,
+                ldb,
+                0.0,
+                c,
+                ldc);
+  }
+
+#endif
+
+  // Builds local distance blocks against one template sequence b. The
+  // squared norms of its frames are computed once by the constructor, so
+  // one instance can serve any number of queries. b is not copied and has
+  // to outlive the builder.
+  template <typename T, size_t feature_number>
+  class GemmDistances
+  {
+  public:
+    typedef FeatureSequenceView<T, feature_number> FeatureSequence;
+
+    explicit GemmDistances(const FeatureSequence& b)
+      : b_(b),
+        squared_norms_(b.size())
+    {
+      for (size_t j=0; j<b.size(); ++j)
+        squared_norms_[j] = dot_product(b[j], b[j], feature_number);
+    }
+
+    size_t size() const { return b_.size(); }
+
+    // Distances of every frame a[i] to the frames b[first_column] ..
+    // b[first_column+columns-1]; row i starts at out + i*out_stride.
+    void block(const FeatureSequence& a,
+               size_t first_column,
+               size_t columns,
+               T* out,
+               size_t out_stride) const
+    {
+      multiply_transposed(a.data(), a.stride(), a.size(),
+                          b_[first_column], b_.stride(), columns,
+                          feature_number,
+                          out, out_stride);
+      for (size_t i=0; i<a.size(); ++i)
+      {
+        const T a_squared_norm = dot_product(a[i], a[i], feature_number);
+        T* row = out + i*out_stride;
+        for (size_t j=0; j<columns; ++j)
+          row[j] = expanded_distance(a_squared_norm, squared_norms_[first_column+j], row[j]);
+      }
+    }
+
+    // Distances of the cells of window, in its compact layout: the cell
+    // (i, j) holds the distance of a[i-1] and b[j-1], the start cell (0, 0)
+    // the one of a[0] and b[0] (as BandedDTW stores them). Rows are
+    // multiplied in blocks, each over the columns any of its rows uses.
+    void banded(const FeatureSequence& a, const SearchWindow& window, T* out) const
+    {
+      const size_t rows_per_block = 32;
+      const size_t I = window.rows()-1;
+      std::vector<T> scratch;
+
+      block(a.subsequence(0, 1), 0, 1, out, 1);
+      for (size_t i0=1; i0<=I; i0+=rows_per_block)
+      {
+        const size_t i1 = std::min(I+1, i0+rows_per_block);
+        size_t begin = window.end(i0);
+        size_t end = window.begin(i0);
+        for (size_t i=i0; i<i1; ++i)
+          if (window.begin(i) < window.end(i))
+          {
+            begin = std::min(begin, window.begin(i));
+            end = std::max(end, window.end(i));
+          }
+        if (begin >= end)
+          continue;
+
+        const size_t columns = end-begin;
+        scratch.resize((i1-i0)*columns);
+        block(a.subsequence(i0-1, i1-i0), begin-1, columns, &scratch[0], columns);
+        for (size_t i=i0; i<i1; ++i)
+          std::copy(&scratch[0] + (i-i0)*columns + (window.begin(i)-begin),
+                    &scratch[0] + (i-i0)*columns + (window.end(i)-begin),
+                    out + window.offset(i));
+      }
+    }
+
+    // the distance of a and b from their squared norms and dot product
+    static T expanded_distance(T a_squared_norm, T b_squared_norm, T dot)
+    {
+      const T squared = a_squared_norm + b_squared_norm - 2*dot;
+      return (squared > 0) ? static_cast<T>(std::sqrt(squared)) : T(0);
+    }
+
+  private:
+    FeatureSequence b_;
+    std::vector<T> squared_norms_;
+  };
+
+  // The Euclidean distance through the norm expansion, as a DTW metric.
+  // DTW computes its whole local distance matrix with GemmDistances for
+  // this metric (see local_distance_matrix in dtw.hpp), or takes a prebuilt
+  // GemmDistances per template to skip the norms; distance() and
+  // distances() expand each pair the same way, but without the matrix
+  // multiply their rounding can differ slightly from the matrix's.
+  struct GemmEuclidean
+  {
+    template <size_t feature_number, typename T>
+    T distance(const T* a, const T* b) const
+    {
+      return GemmDistances<T, feature_number>::expanded_distance(dot_product(a, a, feature_number),
+                                                                 dot_product(b, b, feature_number),
+                                                                 dot_product(a, b, feature_number));
+    }
+
+    template <size_t feature_number, typename T>
+    void distances(const T* v, const T* frames, size_t stride, size_t count, T* distances_out) const
+    {
+      for (size_t k=0; k<count; ++k)
+        distances_out[k] = distance<feature_number>(v, frames + k*stride);
+    }
+
+    template <typename T, size_t feature_number>
+    T distance(const boost::array<T, feature_number>& a,
+               const boost::array<T, feature_number>& b) const
+    {
+      return distance<feature_number>(a.data(), b.data());
+    }
+  };
+}
+
+#endif // WORD_MATCH_GEMM_DISTANCES_HPP
@@ -0,0 +1,333 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_HIRSCHBERG_DTW_HPP
+#define WORD_MATCH_HIRSCHBERG_DTW_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // DTW with path recovery in O(I+J) memory (Hirschberg's divide and
+  // conquer). Neither the distance matrices nor the steps are stored: the
+  // middle row of the alignment is split where the sum of the cost to reach
+  // a cell (forward) and the cost from there to the end (backward) is
+  // minimal, and both halves are aligned recursively. This calculates each
+  // cell about twice per level, i.e. O(I*J*log(I)) time in total.
+  //
+  // minimum_distance() is identical to the one of DTW for the same
+  // arguments, and minimal_path() has the same format. The path is an
+  // optimal one, but where several paths have the same cost it may choose
+  // a different one than DTW. If no path exists (the distance is
+  // infinite), the path is empty.
+  template <typename T = double, size_t feature_number=3>
+  class HirschbergDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::Coordinate Coordinate;
+    typedef typename DTW<T, feature_number>::Path Path;
+    HirschbergDTW(const Features& a, const Features& b, unsigned adjustment_window_size);
+    ~HirschbergDTW() {}
+    T minimum_distance() const { return minimum_distance_; }
+    // the path in forward order, without the last cell
+    const Path& minimal_path() const { return path; }
+  private:
+    typedef std::vector<T> Row;
+    // everything is calculated by the constructor, the features are not
+    // needed afterwards
+    const Features& a;
+    const Features& b;
+    const size_t I;
+    const size_t J;
+    const SakoeChibaBand<T> band;
+    T max_value;
+    T minimum_distance_;
+    Path path;
+    // scratch rows, indexed by the column j of g
+    Row previous, current, previous_local, current_local;
+    Row forward_row;
+
+    void columns(size_t i, size_t j0, size_t j1, size_t& begin, size_t& end) const;
+    void local_distances(size_t i, size_t begin, size_t end, Row& local) const;
+    T forward(size_t i0, size_t j0, T start, size_t i_last, size_t j1, Row& out);
+    void backward(size_t i_first, size_t i1, size_t j0, size_t j1, Row& out);
+    void align(size_t i0, size_t j0, T start, size_t i1, size_t j1);
+    void align_rows(size_t i0, size_t j0, T start, size_t i1, size_t j1);
+  };
+
+  template <typename T, size_t feature_number>
+  HirschbergDTW<T, feature_number>::HirschbergDTW(const Features& a,
+                                                  const Features& b,
+                                                  unsigned adjustment_window_size)
+    : a(a),
+      b(b),
+      I(a.size()),
+      J(b.size()),
+      band(a.size(), b.size(), adjustment_window_size)
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    previous.resize(J+1);
+    current.resize(J+1);
+    previous_local.assign(J+1, 0);
+    current_local.assign(J+1, 0);
+
+    const T start = 2*vector_distance<T, feature_number>(a[0], b[0]);
+    minimum_distance_ = forward(0, 0, start, I, J, forward_row)/(I+J);
+    if (minimum_distance_ >= max_value)
+      return;
+
+    // the cells of g from (0, 0) to (I, J)
+    path.push_back(std::make_pair(0, 0));
+    align(0, 0, start, I, J);
+
+    // DTW's traceback ends with the first cell in row or column 0 of d and
+    // leaves out the last cell
+    size_t first = path.size()-1;
+    while ((path[first].first != 1) && (path[first].second != 1))
+      --first;
+    for (size_t k=first; k+1<path.size(); ++k)
+      path[k-first] = std::make_pair(path[k].first-1, path[k].second-1);
+    path.resize(path.size()-1-first);
+  }
+
+  // The columns of row i within the window and within [j0, j1]. Row 0 only
+  // holds the origin.
+  template <typename T, size_t feature_number>
+  void HirschbergDTW<T, feature_number>::columns(size_t i,
+                                                 size_t j0,
+                                                 size_t j1,
+                                                 size_t& begin,
+                                                 size_t& end) const
+  {
+    if (i == 0)
+    {
+      begin = 0;
+      end = (j0 == 0) ? 1 : 0;
+      return;
+    }
+    band.row(i, begin, end);
+    begin = std::max(begin, j0);
+    end = std::min(end, j1+1);
+    if (begin > end)
+      end = begin;
+  }
+
+  template <typename T, size_t feature_number>
+  void HirschbergDTW<T, feature_number>::local_distances(size_t i,
+                                                         size_t begin,
+                                                         size_t end,
+                                                         Row& local) const
+  {
+    if ((i > 0) && (begin < end))
+      vector_distances<T, feature_number>(a[i-1], &b[begin-1], end-begin, &local[begin]);
+  }
+
+  // Costs of reaching the cells of row i_last from (i0, j0), which costs
+  // start. Only cells within [j0, j1] are considered, the others of out are
+  // max_value. Returns the cost of reaching (i_last, j1).
+  template <typename T, size_t feature_number>
+  T HirschbergDTW<T, feature_number>::forward(size_t i0,
+                                              size_t j0,
+                                              T start,
+                                              size_t i_last,
+                                              size_t j1,
+                                              Row& out)
+  {
+    size_t begin, end;
+    std::fill(previous.begin()+j0, previous.begin()+j1+1, max_value);
+    previous[j0] = start;
+    columns(i0, j0, j1, begin, end);
+    local_distances(i0, begin, end, previous_local);
+    for (size_t j=j0+1; j<end; ++j)
+      previous[j] = previous[j-1] + previous_local[j];
+
+    for (size_t i=i0+1; i<=i_last; ++i)
+    {
+      std::fill(current.begin()+j0, current.begin()+j1+1, max_value);
+      columns(i, j0, j1, begin, end);
+      local_distances(i, begin, end, current_local);
+      for (size_t j=begin; j<end; ++j)
+      {
+        const T d = current_local[j];
+        const T distances[] = {
+            ((j > j0) ? current [j-1] : max_value) +   d,
+            ((j > j0) ? previous[j-1] : max_value) + 2*d,
+            previous[j] + d
+          };
+        current[j] = *std::min_element(distances, distances+3);
+      }
+      previous.swap(current);
+    }
+    out.assign(J+1, max_value);
+    std::copy(previous.begin()+j0, previous.begin()+j1+1, out.begin()+j0);
+    return out[j1];
+  }
+
+  // Costs of reaching (i1, j1) from the cells of row i_first, not counting
+  // the cells themselves. Only cells within [j0, j1] are considered, the
+  // others of out are max_value.
+  template <typename T, size_t feature_number>
+  void HirschbergDTW<T, feature_number>::backward(size_t i_first,
+                                                  size_t i1,
+                                                  size_t j0,
+                                                  size_t j1,
+                                                  Row& out)
+  {
+    size_t begin, end;
+    std::fill(previous.begin()+j0, previous.begin()+j1+1, max_value);
+    previous[j1] = 0;
+    columns(i1, j0, j1, begin, end);
+    local_distances(i1, begin, end, previous_local);
+    for (size_t j=j1; j>begin; --j)
+      previous[j-1] = previous_local[j] + previous[j];
+
+    for (size_t i=i1; i>i_first; --i)
+    {
+      // previous holds row i, current becomes row i-1
+      std::fill(current.begin()+j0, current.begin()+j1+1, max_value);
+      size_t row_end;
+      columns(i-1, j0, j1, begin, row_end);
+      local_distances(i-1, begin, row_end, current_local);
+      for (size_t j=row_end; j>begin; --j)
+      {
+        const size_t k = j-1;
+        const T distances[] = {
+            (k+1 < row_end) ? current_local[k+1] + current[k+1] : max_value,
+            (k < j1) ? 2*previous_local[k+1] + previous[k+1] : max_value,
+            previous_local[k] + previous[k]
+          };
+        current[k] = *std::min_element(distances, distances+3);
+      }
+      previous.swap(current);
+      previous_local.swap(current_local);
+    }
+    out.assign(J+1, max_value);
+    std::copy(previous.begin()+j0, previous.begin()+j1+1, out.begin()+j0);
+  }
+
+  // Appends the cells of an optimal path from (i0, j0) to (i1, j1) to path,
+  // without (i0, j0) itself.
+  template <typename T, size_t feature_number>
+  void HirschbergDTW<T, feature_number>::align(size_t i0,
+                                               size_t j0,
+                                               T start,
+                                               size_t i1,
+                                               size_t j1)
+  {
+    if (i1-i0 < 2)
+    {
+      align_rows(i0, j0, start, i1, j1);
+      return;
+    }
+
+    const size_t middle = i0+(i1-i0)/2;
+    Row backward_row;
+    forward(i0, j0, start, middle, j1, forward_row);
+    backward(middle, i1, j0, j1, backward_row);
+    size_t split = j0;
+    T split_cost = max_value;
+    for (size_t j=j0; j<=j1; ++j)
+    {
+      const T cost = forward_row[j] + backward_row[j];
+      if (cost < split_cost)
+      {
+        split = j;
+        split_cost = cost;
+      }
+    }
+    const T split_start = forward_row[split];
+    Row().swap(backward_row);
+
+    align(i0, j0, start, middle, split);
+    align(middle, split, split_start, i1, j1);
+  }
+
+  // align() for at most two rows, with the steps of the lower row.
+  template <typename T, size_t feature_number>
+  void HirschbergDTW<T, feature_number>::align_rows(size_t i0,
+                                                    size_t j0,
+                                                    T start,
+                                                    size_t i1,
+                                                    size_t j1)
+  {
+    if (i0 == i1)
+    {
+      for (size_t j=j0+1; j<=j1; ++j)
+        path.push_back(std::make_pair(i0, j));
+      return;
+    }
+
+    size_t begin, end;
+    std::fill(previous.begin()+j0, previous.begin()+j1+1, max_value);
+    previous[j0] = start;
+    columns(i0, j0, j1, begin, end);
+    local_distances(i0, begin, end, previous_local);
+    for (size_t j=j0+1; j<end; ++j)
+      previous[j] = previous[j-1] + previous_local[j];
+
+    std::vector<unsigned char> steps(J+1, 0);
+    std::fill(current.begin()+j0, current.begin()+j1+1, max_value);
+    columns(i1, j0, j1, begin, end);
+    local_distances(i1, begin, end, current_local);
+    for (size_t j=begin; j<end; ++j)
+    {
+      const T d = current_local[j];
+      const T distances[] = {
+          ((j > j0) ? current [j-1] : max_value) +   d,
+          ((j > j0) ? previous[j-1] : max_value) + 2*d,
+          previous[j] + d
+        };
+      const T* min_distance = std::min_element(distances, distances+3);
+      steps[j] = static_cast<unsigned char>(min_distance-distances);
+      current[j] = *min_distance;
+    }
+
+    // trace back to row i0, then left to (i0, j0)
+    const size_t first = path.size();
+    size_t j = j1;
+    path.push_back(std::make_pair(i1, j));
+    while (steps[j] == 0)
+      path.push_back(std::make_pair(i1, --j));
+    if (steps[j] == 1)
+      --j;
+    for (; j>j0; --j)
+      path.push_back(std::make_pair(i0, j));
+    std::reverse(path.begin()+first, path.end());
+  }
+}
+
+#endif // WORD_MATCH_HIRSCHBERG_DTW_HPP
@@ -0,0 +1,182 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_ONLINE_DTW_HPP
+#define WORD_MATCH_ONLINE_DTW_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // DTW of a query that arrives frame by frame (e.g. from a WMSession)
+  // against a fixed reference. Each call of add_frame calculates one more
+  // row of the global distance matrix, within the adjustment window only,
+  // and keeps nothing but this row.
+  //
+  // The adjustment window depends on the length of the query, which is not
+  // known in advance. It is therefore laid out for expected_length query
+  // frames. If the query ends up exactly that long, distance() is exactly
+  // DTW::minimum_distance() for the same arguments. A query may run over:
+  // every frame beyond expected_length gets the columns of the last row of
+  // the window, which always ends at the last reference frame, so the extra
+  // frames are aligned to the end of the reference. add_frame returns false
+  // for these frames.
+  //
+  // After each frame, the following estimates are available:
+  //   distance():          the distance if the query ended now.
+  //   open_end_distance(): the best normalized distance of the query so far
+  //                        to any beginning of the reference, and
+  //   open_end_frame():    the last reference frame of that alignment, i.e.
+  //                        how far into the reference the speaker got (0
+  //                        if there is none).
+  //   minimum_cost():      the smallest unnormalized cost in the current
+  //                        row. Costs never decrease along a path, so the
+  //                        final distance cannot be smaller than
+  //                        minimum_cost()/(I+J) for a query of I frames.
+  template <typename T = double, size_t feature_number=3>
+  class OnlineDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+
+    OnlineDTW(const Features& reference,
+              unsigned adjustment_window_size,
+              size_t expected_length);
+    ~OnlineDTW() {}
+
+    // Returns false if the query is now longer than expected_length.
+    bool add_frame(const FeatureVector& frame);
+
+    size_t frames() const { return frames_; }
+    T distance() const;
+    T open_end_distance() const { return open_end_distance_; }
+    size_t open_end_frame() const { return open_end_frame_; }
+    T minimum_cost() const { return minimum_cost_; }
+
+  private:
+    typedef std::vector<T> Row;
+    const Features reference_;
+    const SakoeChibaBand<T> band;
+    T max_value;
+    size_t frames_;
+    Row previous;
+    Row current;
+    Row local;
+    size_t previous_begin, previous_end;
+    size_t stale_begin, stale_end;
+    T open_end_distance_;
+    size_t open_end_frame_;
+    T minimum_cost_;
+  };
+
+  template <typename T, size_t feature_number>
+  OnlineDTW<T, feature_number>::OnlineDTW(const Features& reference,
+                                          unsigned adjustment_window_size,
+                                          size_t expected_length)
+    : reference_(reference),
+      band(expected_length, reference.size(), adjustment_window_size),
+      frames_(0),
+      previous_begin(0),
+      previous_end(1),
+      stale_begin(0),
+      stale_end(0),
+      open_end_frame_(0)
+  {
+    if (reference.size() == 0)
+      throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+    if (expected_length == 0)
+      throw std::logic_error("expected length cannot be zero");
+
+    max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    previous.assign(reference.size()+1, max_value);
+    current.assign(reference.size()+1, max_value);
+    local.resize(reference.size()+1);
+    open_end_distance_ = max_value;
+    minimum_cost_ = max_value;
+  }
+
+  template <typename T, size_t feature_number>
+  bool OnlineDTW<T, feature_number>::add_frame(const FeatureVector& frame)
+  {
+    if (frames_ == 0)
+      previous[0] = 2*vector_distance<T, feature_number>(frame, reference_[0]);
+    const size_t i = ++frames_;
+
+    std::fill(current.begin()+stale_begin, current.begin()+stale_end, max_value);
+
+    const bool within_expected_length = (i <= band.rows());
+    size_t begin, end;
+    band.row(std::min(i, band.rows()), begin, end);
+    if (begin < end)
+      vector_distances<T, feature_number>(frame, &reference_[begin-1], end-begin, &local[begin]);
+
+    open_end_distance_ = max_value;
+    open_end_frame_ = 0;
+    minimum_cost_ = max_value;
+    for (size_t j=begin; j<end; ++j)
+    {
+      const T d = local[j];
+      const T distances[] = {
+          current [j-1] +   d,
+          previous[j-1] + 2*d,
+          previous[j  ] +   d
+        };
+      current[j] = *std::min_element(distances, distances+3);
+
+      minimum_cost_ = std::min(minimum_cost_, current[j]);
+      const T normalized = current[j]/(i+j);
+      if (normalized < open_end_distance_)
+      {
+        open_end_distance_ = normalized;
+        open_end_frame_ = j-1;
+      }
+    }
+
+    stale_begin = previous_begin;
+    stale_end = previous_end;
+    previous_begin = begin;
+    previous_end = end;
+    previous.swap(current);
+    return within_expected_length;
+  }
+
+  template <typename T, size_t feature_number>
+  T OnlineDTW<T, feature_number>::distance() const
+  {
+    if (frames_ == 0)
+      return max_value;
+    return previous[reference_.size()]/(frames_+reference_.size());
+  }
+}
+
+#endif // WORD_MATCH_ONLINE_DTW_HPP
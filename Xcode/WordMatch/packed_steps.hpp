@@ -0,0 +1,78 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_PACKED_STEPS_HPP
+#define WORD_MATCH_PACKED_STEPS_HPP
+
+#include <vector>
+#include <cstddef>
+
+namespace simod1
+{
+  // Matrix of traceback steps, packed at bits_per_step bits per cell.
+  // bits_per_step has to divide 8, so that no cell straddles two bytes.
+  // All cells start out as step 0.
+  template <unsigned bits_per_step>
+  class PackedSteps
+  {
+  public:
+    PackedSteps(size_t rows, size_t columns)
+      : rows_(rows),
+        columns_(columns),
+        data((rows*columns+cells_per_byte-1)/cells_per_byte, 0) {}
+
+    // Resizes to rows x columns with all cells at step 0. Keeps the memory
+    // it already has, so it only allocates if the matrix grows.
+    void reset(size_t rows, size_t columns)
+    {
+      rows_ = rows;
+      columns_ = columns;
+      data.assign((rows*columns+cells_per_byte-1)/cells_per_byte, 0);
+    }
+
+    size_t rows() const { return rows_; }
+    size_t columns() const { return columns_; }
+
+    unsigned short operator()(size_t i, size_t j) const
+    {
+      const size_t k = i*columns_+j;
+      return (data[k/cells_per_byte] >> shift(k)) & mask;
+    }
+
+    void set(size_t i, size_t j, unsigned short step)
+    {
+      const size_t k = i*columns_+j;
+      unsigned char& byte = data[k/cells_per_byte];
+      byte = static_cast<unsigned char>((byte & ~(mask << shift(k))) | ((step & mask) << shift(k)));
+    }
+
+  private:
+    static const unsigned cells_per_byte = 8/bits_per_step;
+    static const unsigned mask = (1u << bits_per_step)-1;
+    static unsigned shift(size_t k) { return (k % cells_per_byte)*bits_per_step; }
+
+    size_t rows_;
+    size_t columns_;
+    std::vector<unsigned char> data;
+  };
+}
+
+#endif // WORD_MATCH_PACKED_STEPS_HPP
@@ -0,0 +1,466 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_QUANTIZED_FEATURES_HPP
+#define WORD_MATCH_QUANTIZED_FEATURES_HPP
+
+#include "feature_distance.hpp"
+#include "feature_sequence.hpp"
+
+#include <boost/array.hpp>
+#include <boost/cstdint.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+
+// Besides the SIMD macros of feature_distance.hpp, the kernels on encoded
+// frames widen bytes with SSE2 (SSE4.1 if available) and half precision
+// values with F16C. Without them, they fill the lanes one by one.
+#if defined(SIMOD1_SIMD_SSE) && (defined(__SSE2__) || defined(__x86_64__))
+#  define SIMOD1_SIMD_SSE2
+#  include <emmintrin.h>
+#  if defined(__SSE4_1__)
+#    define SIMOD1_SIMD_SSE41
+#    include <smmintrin.h>
+#  endif
+#endif
+#if defined(SIMOD1_SIMD_SSE) && defined(__F16C__)
+#  define SIMOD1_SIMD_F16C
+#  include <immintrin.h>
+#endif
+
+namespace simod1
+{
+  // Converts to IEEE 754 half precision, rounding to nearest even. Values
+  // beyond the half precision range become infinite.
+  inline boost::uint16_t float_to_half(float value)
+  {
+    boost::uint32_t x;
+    std::memcpy(&x, &value, sizeof(x));
+    const boost::uint32_t sign = (x >> 16) & 0x8000;
+    boost::uint32_t mantissa = x & 0x007fffff;
+    const int exponent = static_cast<int>((x >> 23) & 0xff);
+
+    // infinity and NaN
+    if (exponent == 0xff)
+      return static_cast<boost::uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    const int e = exponent-127+15;
+    if (e >= 0x1f)
+      return static_cast<boost::uint16_t>(sign | 0x7c00);
+
+    boost::uint32_t half;
+    boost::uint32_t remainder;
+    boost::uint32_t halfway;
+    if (e <= 0)
+    {
+      // subnormal or zero
+      if (e < -10)
+        return static_cast<boost::uint16_t>(sign);
+      mantissa |= 0x00800000;
+      const int shift = 14-e;
+      half = mantissa >> shift;
+      remainder = mantissa & ((1u << shift)-1);
+      halfway = 1u << (shift-1);
+    }
+    else
+    {
+      half = (static_cast<boost::uint32_t>(e) << 10) | (mantissa >> 13);
+      remainder = mantissa & 0x1fff;
+      halfway = 0x1000;
+    }
+    // a carry into the exponent gives the next power of two (or infinity)
+    if ((remainder > halfway) || ((remainder == halfway) && (half & 1)))
+      ++half;
+    return static_cast<boost::uint16_t>(sign | half);
+  }
+
+  inline float half_to_float(boost::uint16_t half)
+  {
+    const boost::uint32_t sign = static_cast<boost::uint32_t>(half & 0x8000) << 16;
+    const boost::uint32_t exponent = (half >> 10) & 0x1f;
+    const boost::uint32_t mantissa = half & 0x3ff;
+    boost::uint32_t x;
+    if (exponent == 0)
+    {
+      // zero or subnormal: mantissa * 2^-24, exact in single precision
+      const float value = std::ldexp(static_cast<float>(mantissa), -24);
+      return sign ? -value : value;
+    }
+    if (exponent == 0x1f)
+      x = sign | 0x7f800000 | (mantissa << 13);
+    else
+      x = sign | ((exponent+112) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &x, sizeof(value));
+    return value;
+  }
+
+  // The value a code stands for, before the scale and offset of the
+  // encoding.
+  inline float code_value(boost::int8_t code) { return code; }
+  inline float code_value(boost::uint16_t code) { return half_to_float(code); }
+
+  // Calculates the squared Euclidean distances of query against count
+  // consecutive frames of n encoded values each. If weights is not null, the
+  // squared difference of dimension k is weighted by weights[k]. The results
+  // are bit-identical to squared_distance() and weighted_squared_distance() on
+  // the decoded frames.
+  //
+  // This version widens one frame at a time into a buffer and calls those
+  // kernels. Single precision on SSE has a kernel that widens the codes where
+  // it reads them instead, four frames at a time.
+  template <size_t n, typename T, typename Value>
+  inline void encoded_squared_distances(const T* query,
+                                        const Value* frames,
+                                        const T* weights,
+                                        size_t count,
+                                        T* out)
+  {
+    boost::array<T, n> frame;
+    for (size_t f=0; f<count; ++f)
+    {
+      for (size_t k=0; k<n; ++k)
+        frame[k] = static_cast<T>(code_value(frames[f*n+k]));
+      out[f] = weights ? weighted_squared_distance(query, frame.data(), weights, n)
+                       : squared_distance(query, frame.data(), n);
+    }
+  }
+
+#if defined(SIMOD1_SIMD_SSE)
+
+  namespace detail
+  {
+    // four signed bytes as single precision
+    inline __m128 load_codes(const boost::int8_t* codes)
+    {
+#if defined(SIMOD1_SIMD_SSE2)
+      boost::int32_t word;
+      std::memcpy(&word, codes, sizeof(word));
+      const __m128i bytes = _mm_cvtsi32_si128(word);
+#  if defined(SIMOD1_SIMD_SSE41)
+      return _mm_cvtepi32_ps(_mm_cvtepi8_epi32(bytes));
+#  else
+      // each byte repeated over its lane, then sign extended by the shift
+      const __m128i pairs = _mm_unpacklo_epi8(bytes, bytes);
+      return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(pairs, pairs), 24));
+#  endif
+#else
+      return _mm_setr_ps(codes[0], codes[1], codes[2], codes[3]);
+#endif
+    }
+
+    // four half precision values as single precision
+    inline __m128 load_codes(const boost::uint16_t* codes)
+    {
+#if defined(SIMOD1_SIMD_F16C)
+      return _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(codes)));
+#else
+      return _mm_setr_ps(half_to_float(codes[0]),
+                         half_to_float(codes[1]),
+                         half_to_float(codes[2]),
+                         half_to_float(codes[3]));
+#endif
+    }
+
+    // squared_difference_chunks() on encoded values, weighted if weights is
+    // not null. The unweighted sums keep the two accumulators of the AVX
+    // kernel, so both give the same partial sums.
+    template <typename Value>
+    inline __m128 encoded_difference_chunks(const float* query,
+                                            const Value* codes,
+                                            const float* weights,
+                                            size_t n,
+                                            size_t& k)
+    {
+      __m128 acc = _mm_setzero_ps();
+      k = 0;
+#if defined(SIMOD1_SIMD_AVX)
+      if (!weights && n >= 8)
+      {
+        __m128 low = _mm_setzero_ps();
+        __m128 high = _mm_setzero_ps();
+        for (; k<n-n%8; k+=8)
+        {
+          const __m128 d0 = _mm_sub_ps(_mm_loadu_ps(query+k), load_codes(codes+k));
+          const __m128 d1 = _mm_sub_ps(_mm_loadu_ps(query+k+4), load_codes(codes+k+4));
+          low = _mm_add_ps(low, _mm_mul_ps(d0, d0));
+          high = _mm_add_ps(high, _mm_mul_ps(d1, d1));
+        }
+        acc = _mm_add_ps(low, high);
+      }
+#endif
+      if (weights)
+        for (; k<n-n%4; k+=4)
+        {
+          const __m128 d = _mm_sub_ps(_mm_loadu_ps(query+k), load_codes(codes+k));
+          acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(weights+k), _mm_mul_ps(d, d)));
+        }
+      else
+        for (; k<n-n%4; k+=4)
+        {
+          const __m128 d = _mm_sub_ps(_mm_loadu_ps(query+k), load_codes(codes+k));
+          acc = _mm_add_ps(acc, _mm_mul_ps(d, d));
+        }
+      return acc;
+    }
+
+    template <typename Value>
+    inline float encoded_difference_tail(const float* query,
+                                         const Value* codes,
+                                         const float* weights,
+                                         size_t k,
+                                         size_t n,
+                                         float sum)
+    {
+      // the same expressions as the scalar tails, which the compiler may
+      // contract to fused multiply-adds
+      if (weights)
+        for (; k<n; ++k)
+        {
+          const float d = query[k]-code_value(codes[k]);
+          sum += weights[k]*d*d;
+        }
+      else
+        for (; k<n; ++k)
+        {
+          const float d = query[k]-code_value(codes[k]);
+          sum += d*d;
+        }
+      return sum;
+    }
+
+    // Four frames at a time, as squared_distances<float>
+    template <typename Value>
+    inline void encoded_squared_distances(const float* query,
+                                          const Value* frames,
+                                          const float* weights,
+                                          size_t n,
+                                          size_t count,
+                                          float* out)
+    {
+      size_t f = 0;
+      size_t k = 0;
+      for (; f+4<=count; f+=4)
+      {
+        const Value* frame = frames + f*n;
+        __m128 s0 = encoded_difference_chunks(query, frame,     weights, n, k);
+        __m128 s1 = encoded_difference_chunks(query, frame+n,   weights, n, k);
+        __m128 s2 = encoded_difference_chunks(query, frame+2*n, weights, n, k);
+        __m128 s3 = encoded_difference_chunks(query, frame+3*n, weights, n, k);
+        _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+        _mm_storeu_ps(out+f, _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3)));
+        if (k < n)
+          for (size_t i=0; i<4; ++i)
+            out[f+i] = encoded_difference_tail(query, frame+i*n, weights, k, n, out[f+i]);
+      }
+      for (; f<count; ++f)
+      {
+        const Value* frame = frames + f*n;
+        const __m128 acc = encoded_difference_chunks(query, frame, weights, n, k);
+        out[f] = encoded_difference_tail(query, frame, weights, k, n, horizontal_sum(acc));
+      }
+    }
+  }
+
+  template <size_t n>
+  inline void encoded_squared_distances(const float* query,
+                                        const boost::int8_t* frames,
+                                        const float* weights,
+                                        size_t count,
+                                        float* out)
+  {
+    detail::encoded_squared_distances(query, frames, weights, n, count, out);
+  }
+
+  template <size_t n>
+  inline void encoded_squared_distances(const float* query,
+                                        const boost::uint16_t* frames,
+                                        const float* weights,
+                                        size_t count,
+                                        float* out)
+  {
+    detail::encoded_squared_distances(query, frames, weights, n, count, out);
+  }
+
+#endif
+
+  // Feature encodings for QuantizedFeatures. Each encoding provides
+  //
+  //   Value:                the type of one encoded value
+  //   Encoding(features):   an encoding suitable for features
+  //   encode(x, k):         x, the k-th value of a frame, encoded
+  //   decode(c, k):         the approximation of x that c stands for
+  //   squared_distances(query, frames, count, out):
+  //                         the squared Euclidean distances of the (not
+  //                         encoded) query frame to count consecutive encoded
+  //                         frames, by encoded_squared_distances()
+
+  // One signed byte per value, with a scale and an offset per dimension that
+  // spread the range of the features over [-127, 127]. Takes a quarter of
+  // the memory of single precision features. Widens the bytes with SSE2 (or
+  // SSE4.1) where available.
+  template <typename T, size_t feature_number>
+  class Int8Encoding
+  {
+  public:
+    typedef boost::int8_t Value;
+
+    explicit Int8Encoding(const FeatureSequenceView<T, feature_number>& features)
+    {
+      offset_.assign(0);
+      scale_.assign(1);
+      squared_scale_.assign(1);
+      if (features.empty())
+        return;
+      boost::array<T, feature_number> minimum, maximum;
+      std::copy(features[0], features[0]+feature_number, minimum.begin());
+      maximum = minimum;
+      for (size_t i=1; i<features.size(); ++i)
+        for (size_t k=0; k<feature_number; ++k)
+        {
+          minimum[k] = std::min(minimum[k], features[i][k]);
+          maximum[k] = std::max(maximum[k], features[i][k]);
+        }
+      for (size_t k=0; k<feature_number; ++k)
+      {
+        offset_[k] = (minimum[k]+maximum[k])/2;
+        // constant dimensions are represented exactly by the offset
+        if (maximum[k] > minimum[k])
+          scale_[k] = (maximum[k]-minimum[k])/254;
+        squared_scale_[k] = scale_[k]*scale_[k];
+      }
+    }
+
+    Value encode(T x, size_t k) const
+    {
+      const T c = static_cast<T>(std::floor((x-offset_[k])/scale_[k] + T(0.5)));
+      return static_cast<Value>(std::max(T(-127), std::min(T(127), c)));
+    }
+
+    T decode(Value c, size_t k) const { return offset_[k] + scale_[k]*c; }
+
+    // With the query in the coordinates of the code, u = (x-offset)/scale,
+    // the squared distance is the sum of scale^2*(u-c)^2, i.e. a weighted
+    // squared distance on the codes.
+    void squared_distances(const T* query,
+                           const Value* frames,
+                           size_t count,
+                           T* distances_out) const
+    {
+      boost::array<T, feature_number> u;
+      for (size_t k=0; k<feature_number; ++k)
+        u[k] = (query[k]-offset_[k])/scale_[k];
+      encoded_squared_distances<feature_number>(u.data(),
+                                                frames,
+                                                squared_scale_.data(),
+                                                count,
+                                                distances_out);
+    }
+
+  private:
+    boost::array<T, feature_number> offset_;
+    boost::array<T, feature_number> scale_;
+    boost::array<T, feature_number> squared_scale_;
+  };
+
+  // IEEE 754 half precision, i.e. 11 significant bits. Takes half the memory
+  // of single precision features. Uses the F16C conversion instructions
+  // where available.
+  template <typename T, size_t feature_number>
+  class Float16Encoding
+  {
+  public:
+    typedef boost::uint16_t Value;
+
+    explicit Float16Encoding(const FeatureSequenceView<T, feature_number>&) {}
+
+    Value encode(T x, size_t) const { return float_to_half(static_cast<float>(x)); }
+
+    T decode(Value c, size_t) const { return static_cast<T>(half_to_float(c)); }
+
+    void squared_distances(const T* query,
+                           const Value* frames,
+                           size_t count,
+                           T* distances_out) const
+    {
+      encoded_squared_distances<feature_number>(query,
+                                                frames,
+                                                static_cast<const T*>(0),
+                                                count,
+                                                distances_out);
+    }
+  };
+
+  // Features stored in a compact encoding (Int8Encoding or Float16Encoding).
+  // distances() calculates Euclidean distances on the encoded frames, so
+  // DTWDistance can match a query against them without decoding them.
+  template <typename T, size_t feature_number, typename Encoding>
+  class QuantizedFeatures
+  {
+  public:
+    typedef typename Encoding::Value Value;
+    typedef boost::array<T, feature_number> FeatureVector;
+    typedef std::vector<FeatureVector> Features;
+
+    explicit QuantizedFeatures(const FeatureSequenceView<T, feature_number>& features)
+      : encoding_(features),
+        size_(features.size()),
+        values_(features.size()*feature_number)
+    {
+      for (size_t i=0; i<size_; ++i)
+        for (size_t k=0; k<feature_number; ++k)
+          values_[i*feature_number+k] = encoding_.encode(features[i][k], k);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // memory taken by the encoded values
+    size_t bytes() const { return values_.size()*sizeof(Value); }
+
+    // the approximation of frame i
+    FeatureVector frame(size_t i) const
+    {
+      FeatureVector v;
+      for (size_t k=0; k<feature_number; ++k)
+        v[k] = encoding_.decode(values_[i*feature_number+k], k);
+      return v;
+    }
+
+    // Euclidean distances of query to count frames, starting with frame
+    // first
+    void distances(const T* query, size_t first, size_t count, T* distances_out) const
+    {
+      encoding_.squared_distances(query, &values_[first*feature_number], count, distances_out);
+      for (size_t k=0; k<count; ++k)
+        distances_out[k] = static_cast<T>(std::sqrt(distances_out[k]));
+    }
+
+  private:
+    Encoding encoding_;
+    size_t size_;
+    std::vector<Value> values_;
+  };
+}
+
+#endif // WORD_MATCH_QUANTIZED_FEATURES_HPP
@@ -0,0 +1,326 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_STEP_PATTERNS_HPP
+#define WORD_MATCH_STEP_PATTERNS_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace simod1
+{
+  // Step patterns for the DTW recurrence, given as template argument to DTW.
+  // Each pattern provides:
+  //
+  //   step_bits:            the bits needed to store a step (see PackedSteps).
+  //   origin(d):            g[0][0] for the local distance d of the first
+  //                         frames.
+  //   normalization(I, J):  the divisor of g[I][J] for the minimum distance.
+  //   cell(g, d, i, j, step): g[i][j] from its predecessors, i.e. the minimum
+  //                         over the pattern's steps. step is set to the
+  //                         step taking this minimum (on ties, the one that
+  //                         is tried first).
+  //   trace(step, i, j, path): moves the local distance cell (i, j) back over
+  //                         step and appends every cell passed to path.
+  //                         Returns false for an unknown step.
+  //
+  // g and d are indexed as in DTW, i.e. g[i][j] belongs to d[i-1][j-1] and
+  // g has an infinite border row and column. The patterns only read cells of
+  // g with i >= 0 and j >= 0.
+
+  // Symmetric pattern without slope constraint (Sakoe and Chiba, P=0):
+  //
+  //   g[i][j] = min(g[i  ][j-1] +   d[i][j],
+  //                 g[i-1][j-1] + 2*d[i][j],
+  //                 g[i-1][j  ] +   d[i][j])
+  //
+  // This is the pattern DTW always used.
+  struct SymmetricP0
+  {
+    static const unsigned step_bits = 2;
+
+    template <typename T>
+    static T origin(T d) { return 2*d; }
+
+    static size_t normalization(size_t I, size_t J) { return I+J; }
+
+    template <typename T, typename GlobalDistances, typename LocalDistances>
+    static T cell(const GlobalDistances& g,
+                  const LocalDistances& d,
+                  size_t i,
+                  size_t j,
+                  unsigned short& step)
+    {
+      const T local = d[i-1][j-1];
+      T min_distance = g[i][j-1] + local;
+      step = 0;
+      const T diagonal = g[i-1][j-1] + 2*local;
+      if (diagonal < min_distance)
+      {
+        min_distance = diagonal;
+        step = 1;
+      }
+      const T up = g[i-1][j] + local;
+      if (up < min_distance)
+      {
+        min_distance = up;
+        step = 2;
+      }
+      return min_distance;
+    }
+
+    template <typename Path>
+    static bool trace(unsigned short step, size_t& i, size_t& j, Path& path)
+    {
+      switch (step)
+      {
+        case 0:
+          --j;
+          break;
+        case 1:
+          --i;
+          --j;
+          break;
+        case 2:
+          --i;
+          break;
+        default:
+          return false;
+      }
+      path.push_back(std::make_pair(i, j));
+      return true;
+    }
+  };
+
+  // Symmetric pattern with slope constraint P=1/2 (Sakoe and Chiba): at most
+  // two consecutive horizontal or vertical moves, each followed by a diagonal
+  // one. The weights are those of SymmetricP0 along the same cells, so the
+  // distance is never below the one of SymmetricP0.
+  //
+  //   g[i][j] = min(g[i-1][j-3] + 2*d[i][j-2] + d[i][j-1] + d[i][j],
+  //                 g[i-1][j-2] + 2*d[i][j-1] + d[i][j],
+  //                 g[i-1][j-1] + 2*d[i][j],
+  //                 g[i-2][j-1] + 2*d[i-1][j] + d[i][j],
+  //                 g[i-3][j-1] + 2*d[i-2][j] + d[i-1][j] + d[i][j])
+  struct SymmetricP1_2
+  {
+    // five steps, rounded up to half a byte
+    static const unsigned step_bits = 4;
+
+    template <typename T>
+    static T origin(T d) { return 2*d; }
+
+    static size_t normalization(size_t I, size_t J) { return I+J; }
+
+    template <typename T, typename GlobalDistances, typename LocalDistances>
+    static T cell(const GlobalDistances& g,
+                  const LocalDistances& d,
+                  size_t i,
+                  size_t j,
+                  unsigned short& step)
+    {
+      const T local = d[i-1][j-1];
+      T min_distance = g[i-1][j-1] + 2*local;
+      step = 2;
+      if (j >= 2)
+      {
+        const T left = g[i-1][j-2] + 2*d[i-1][j-2] + local;
+        if (left < min_distance)
+        {
+          min_distance = left;
+          step = 1;
+        }
+        if (j >= 3)
+        {
+          const T far_left = g[i-1][j-3] + 2*d[i-1][j-3] + d[i-1][j-2] + local;
+          if (far_left < min_distance)
+          {
+            min_distance = far_left;
+            step = 0;
+          }
+        }
+      }
+      if (i >= 2)
+      {
+        const T up = g[i-2][j-1] + 2*d[i-2][j-1] + local;
+        if (up < min_distance)
+        {
+          min_distance = up;
+          step = 3;
+        }
+        if (i >= 3)
+        {
+          const T far_up = g[i-3][j-1] + 2*d[i-3][j-1] + d[i-2][j-1] + local;
+          if (far_up < min_distance)
+          {
+            min_distance = far_up;
+            step = 4;
+          }
+        }
+      }
+      return min_distance;
+    }
+
+    template <typename Path>
+    static bool trace(unsigned short step, size_t& i, size_t& j, Path& path)
+    {
+      if (step > 4)
+        return false;
+      // horizontal (step 0, 1) or vertical (step 3, 4) moves before the
+      // diagonal one
+      const unsigned short horizontal = (step < 2) ? 2-step : 0;
+      const unsigned short vertical = (step > 2) ? step-2 : 0;
+      for (unsigned short k=0; k<horizontal; ++k)
+        path.push_back(std::make_pair(i, --j));
+      for (unsigned short k=0; k<vertical; ++k)
+        path.push_back(std::make_pair(--i, j));
+      --i;
+      --j;
+      path.push_back(std::make_pair(i, j));
+      return true;
+    }
+  };
+
+  // Asymmetric pattern without slope constraint (Sakoe and Chiba, P=0): every
+  // frame of the first sequence is weighted once, frames of the second one
+  // may be skipped at no cost. The distance is therefore normalized by I only.
+  //
+  //   g[i][j] = min(g[i  ][j-1],
+  //                 g[i-1][j-1] + d[i][j],
+  //                 g[i-1][j  ] + d[i][j])
+  struct AsymmetricP0
+  {
+    static const unsigned step_bits = 2;
+
+    template <typename T>
+    static T origin(T d) { return d; }
+
+    static size_t normalization(size_t I, size_t) { return I; }
+
+    template <typename T, typename GlobalDistances, typename LocalDistances>
+    static T cell(const GlobalDistances& g,
+                  const LocalDistances& d,
+                  size_t i,
+                  size_t j,
+                  unsigned short& step)
+    {
+      const T local = d[i-1][j-1];
+      T min_distance = g[i][j-1];
+      step = 0;
+      const T diagonal = g[i-1][j-1] + local;
+      if (diagonal < min_distance)
+      {
+        min_distance = diagonal;
+        step = 1;
+      }
+      const T up = g[i-1][j] + local;
+      if (up < min_distance)
+      {
+        min_distance = up;
+        step = 2;
+      }
+      return min_distance;
+    }
+
+    template <typename Path>
+    static bool trace(unsigned short step, size_t& i, size_t& j, Path& path)
+    {
+      return SymmetricP0::trace(step, i, j, path);
+    }
+  };
+
+  // Itakura's pattern: every frame of the first sequence is matched with
+  // exactly one frame of the second one, which advances by 0, 1 or 2 frames,
+  // but never by 0 twice in a row. The local slope therefore lies within
+  // [1/2, 2], and together the steps form the Itakura parallelogram: if J/I
+  // is outside of this range, no path exists and the distance is infinite.
+  //
+  //   g[i][j] = min(g[i-1][j-2],
+  //                 g[i-1][j-1],
+  //                 g[i-2][j-1] + d[i-1][j]) + d[i][j]
+  struct Itakura
+  {
+    static const unsigned step_bits = 2;
+
+    template <typename T>
+    static T origin(T d) { return d; }
+
+    static size_t normalization(size_t I, size_t) { return I; }
+
+    template <typename T, typename GlobalDistances, typename LocalDistances>
+    static T cell(const GlobalDistances& g,
+                  const LocalDistances& d,
+                  size_t i,
+                  size_t j,
+                  unsigned short& step)
+    {
+      const T local = d[i-1][j-1];
+      T min_distance = g[i-1][j-1];
+      step = 1;
+      if (j >= 2)
+      {
+        const T skip = g[i-1][j-2];
+        if (skip < min_distance)
+        {
+          min_distance = skip;
+          step = 0;
+        }
+      }
+      if (i >= 2)
+      {
+        const T up = g[i-2][j-1] + d[i-2][j-1];
+        if (up < min_distance)
+        {
+          min_distance = up;
+          step = 2;
+        }
+      }
+      return min_distance + local;
+    }
+
+    template <typename Path>
+    static bool trace(unsigned short step, size_t& i, size_t& j, Path& path)
+    {
+      switch (step)
+      {
+        case 0:
+          --i;
+          j -= 2;
+          break;
+        case 1:
+          --i;
+          --j;
+          break;
+        case 2:
+          path.push_back(std::make_pair(--i, j));
+          --i;
+          --j;
+          break;
+        default:
+          return false;
+      }
+      path.push_back(std::make_pair(i, j));
+      return true;
+    }
+  };
+}
+
+#endif // WORD_MATCH_STEP_PATTERNS_HPP
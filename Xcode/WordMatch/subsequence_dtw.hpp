@@ -0,0 +1,165 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_SUBSEQUENCE_DTW_HPP
+#define WORD_MATCH_SUBSEQUENCE_DTW_HPP
+
+#include "dtw.hpp"
+
+#include <vector>
+#include <map>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Finds the occurrences of a short query (e.g. a spoken word) within a
+  // long sequence in a single pass. The alignment may start and end at any
+  // frame of the sequence, but has to cover the whole query. The long
+  // sequence is processed frame by frame and only the current and the
+  // previous column of the global distances are kept, so time is
+  // O(I*L) and memory O(I) for a query of I and a sequence of L frames.
+  //
+  // Each cell uses the same steps and weights as DTW (without adjustment
+  // window), and every alignment starts like DTW at its first cell. The
+  // distance of a match covering the frames [first, last] is normalized by
+  // I+(last-first+1), so it is exactly the distance DTW reports for the
+  // query and these frames if no adjustment window constrains the path.
+  //
+  // Every end frame yields its best alignment; of all alignments with a
+  // distance below the threshold, matches() reports the best ones that do
+  // not overlap, ordered by their first frame.
+  template <typename T = double, size_t feature_number=3>
+  class SubsequenceDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+
+    struct Match
+    {
+      size_t first;
+      size_t last;
+      T distance;
+    };
+    typedef std::vector<Match> Matches;
+
+    SubsequenceDTW(const Features& query, const Features& sequence, T threshold);
+    ~SubsequenceDTW() {}
+    const Matches& matches() const { return matches_; }
+
+  private:
+    Matches matches_;
+
+    static bool closer(const Match& a, const Match& b) { return a.distance < b.distance; }
+  };
+
+  template <typename T, size_t feature_number>
+  SubsequenceDTW<T, feature_number>::SubsequenceDTW(const Features& query,
+                                                    const Features& sequence,
+                                                    T threshold)
+  {
+    if ((query.size() == 0) || (sequence.size() == 0))
+      throw std::logic_error("feature argument empty");
+
+    T max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+
+    const size_t I = query.size();
+    const size_t L = sequence.size();
+
+    // previous and current column of g over the query frames, and the first
+    // sequence frame of the alignment that reached each cell
+    std::vector<T> previous(I, max_value), current(I);
+    std::vector<size_t> previous_first(I, 0), current_first(I);
+    std::vector<T> local(I);
+
+    Matches candidates;
+    for (size_t j=0; j<L; ++j)
+    {
+      vector_distances<T, feature_number>(sequence[j], &query[0], I, &local[0]);
+
+      // first query frame: continue to the right, or start a new alignment
+      // here, with the weights DTW applies to its first cell
+      {
+        const T d = local[0];
+        const T start = 2*d;
+        const T distances[] = {
+            previous[0] + d,
+            start       + 2*d
+          };
+        const size_t step = (distances[1] < distances[0]) ? 1 : 0;
+        current[0] = distances[step];
+        current_first[0] = (step == 0) ? previous_first[0] : j;
+      }
+
+      for (size_t i=1; i<I; ++i)
+      {
+        const T d = local[i];
+        const T distances[] = {
+            previous[i  ] +   d,
+            previous[i-1] + 2*d,
+            current [i-1] +   d
+          };
+        const size_t firsts[] = {
+            previous_first[i],
+            previous_first[i-1],
+            current_first[i-1]
+          };
+        const size_t step = std::min_element(distances, distances+3)-distances;
+        current[i] = distances[step];
+        current_first[i] = firsts[step];
+      }
+
+      Match m;
+      m.first = current_first[I-1];
+      m.last = j;
+      m.distance = current[I-1]/(I+(m.last-m.first+1));
+      if (m.distance < threshold)
+        candidates.push_back(m);
+
+      previous.swap(current);
+      previous_first.swap(current_first);
+    }
+
+    // best matches first, drop every match that overlaps a better one. The
+    // accepted matches never overlap, so only the ones starting next to the
+    // candidate have to be checked.
+    std::stable_sort(candidates.begin(), candidates.end(), closer);
+    std::map<size_t, Match> accepted;
+    for (size_t c=0; c<candidates.size(); ++c)
+    {
+      const Match& m = candidates[c];
+      typename std::map<size_t, Match>::const_iterator next = accepted.upper_bound(m.first);
+      if ((next != accepted.end()) && (next->second.first <= m.last))
+        continue;
+      if ((next != accepted.begin()) && ((--next)->second.last >= m.first))
+        continue;
+      accepted.insert(std::make_pair(m.first, m));
+    }
+    for (typename std::map<size_t, Match>::const_iterator it=accepted.begin(); it!=accepted.end(); ++it)
+      matches_.push_back(it->second);
+  }
+}
+
+#endif // WORD_MATCH_SUBSEQUENCE_DTW_HPP
@@ -0,0 +1,379 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_TEMPLATE_SEARCH_HPP
+#define WORD_MATCH_TEMPLATE_SEARCH_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+#include "dtw_distance.hpp"
+#include "dtw_engine.hpp"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace simod1
+{
+  // Nearest neighbour search of one query against a set of templates. Each
+  // candidate passes a cascade of lower bounds of increasing cost before the
+  // exact DTW distance is calculated:
+  //
+  //   LB_Kim:   every path starts with cell (0, 0), which DTW weights with 4,
+  //             and ends with the last cell, weighted with at least 1.
+  //   LB_Keogh: every row of the path holds at least one cell weighted with
+  //             at least 1, and that cell lies within the adjustment window.
+  //             Its local distance is therefore not smaller than the distance
+  //             of the query frame to the template's envelope over the window.
+  //
+  // Candidates are visited in order of increasing LB_Kim, and LB_Keogh gives
+  // up as soon as it exceeds the k-th best distance so far. The result is the
+  // exact set of k nearest neighbours according to DTWDistance.
+  //
+  // The envelopes are precomputed once for the adjustment window size given
+  // to the constructor, but they bound any other window size as well (less
+  // tightly), so queries may choose their own adjustment window size.
+  // Removing a template frees its index, which is reused by the next
+  // add_template call.
+  template <typename T = double, size_t feature_number=3>
+  class TemplateSearch
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::FeatureSequence FeatureSequence;
+
+    struct Match
+    {
+      size_t index;
+      T distance;
+    };
+
+    struct Statistics
+    {
+      size_t candidates;
+      size_t pruned_by_kim;
+      size_t pruned_by_keogh;
+      size_t full_comparisons;
+      Statistics() : candidates(0),
+                     pruned_by_kim(0),
+                     pruned_by_keogh(0),
+                     full_comparisons(0) {}
+    };
+
+    explicit TemplateSearch(unsigned adjustment_window_size);
+    ~TemplateSearch() {}
+
+    // Adds a copy of the template and precomputes its envelope, returns its
+    // index.
+    size_t add_template(const FeatureSequence& features);
+    void remove_template(size_t index);
+    bool contains(size_t index) const;
+    // number of templates currently stored
+    size_t size() const { return templates_.size()-free_indices_.size(); }
+    // one past the largest index ever used; add_template() returns an index
+    // not above this
+    size_t index_bound() const { return templates_.size(); }
+    const Features& features(size_t index) const { return templates_[index].features; }
+
+    // Returns the template with the minimum DTW distance to query. If
+    // statistics is not NULL, it receives the number of candidates discarded
+    // at each stage of the cascade.
+    Match nearest(const FeatureSequence& query, Statistics* statistics = NULL) const;
+
+    // Returns the k templates with the smallest DTW distance to query for the
+    // given adjustment window size, ordered by distance (and by index for
+    // equal distances). Fewer than k matches are returned if fewer templates
+    // are stored.
+    std::vector<Match> nearest(const FeatureSequence& query,
+                               size_t k,
+                               unsigned adjustment_window_size,
+                               Statistics* statistics = NULL) const;
+
+  private:
+    // The template's upper and lower envelope for the adjustment window
+    // radius r: for each frame j, the per-dimension maximum and minimum of
+    // the frames [j-r, j+r].
+    // Removed templates are kept as empty slots.
+    struct Template
+    {
+      Features features;
+      Features lower;
+      Features upper;
+    };
+
+    static bool closer(const Match& a, const Match& b)
+    {
+      return (a.distance < b.distance) ||
+             ((a.distance == b.distance) && (a.index < b.index));
+    }
+
+    struct Candidate
+    {
+      size_t index;
+      T bound;
+      bool operator<(const Candidate& other) const { return bound < other.bound; }
+    };
+
+    const unsigned r;
+    std::vector<Template> templates_;
+    std::vector<size_t> free_indices_;
+    T max_value;
+
+    T lb_kim(const Template& t, const FeatureSequence& query) const;
+    T lb_keogh(const Template& t,
+               const FeatureSequence& query,
+               unsigned adjustment_window_size,
+               T abandon_above) const;
+    void envelope(const Template& t,
+                  size_t first,
+                  size_t last,
+                  FeatureVector& lower,
+                  FeatureVector& upper) const;
+  };
+
+  template <typename T, size_t feature_number>
+  TemplateSearch<T, feature_number>::TemplateSearch(unsigned adjustment_window_size)
+    : r(adjustment_window_size)
+  {
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+  }
+
+  template <typename T, size_t feature_number>
+  size_t TemplateSearch<T, feature_number>::add_template(const FeatureSequence& sequence)
+  {
+    if (sequence.size() == 0)
+      throw std::logic_error("feature argument empty");
+
+    size_t index = templates_.size();
+    if (free_indices_.empty())
+      templates_.push_back(Template());
+    else
+    {
+      index = free_indices_.back();
+      free_indices_.pop_back();
+    }
+    Template& t = templates_[index];
+    t.features.resize(sequence.size());
+    for (size_t j=0; j<sequence.size(); ++j)
+      std::copy(sequence[j], sequence[j]+feature_number, t.features[j].begin());
+    const Features& features = t.features;
+    t.lower.resize(features.size());
+    t.upper.resize(features.size());
+
+    const size_t J = features.size();
+    for (size_t j=0; j<J; ++j)
+    {
+      const size_t first = (j > r) ? j-r : 0;
+      const size_t last = std::min(j+r+1, J);
+      t.lower[j] = features[first];
+      t.upper[j] = features[first];
+      for (size_t k=first+1; k<last; ++k)
+        for (size_t n=0; n<feature_number; ++n)
+        {
+          t.lower[j][n] = std::min(t.lower[j][n], features[k][n]);
+          t.upper[j][n] = std::max(t.upper[j][n], features[k][n]);
+        }
+    }
+    return index;
+  }
+
+  template <typename T, size_t feature_number>
+  void TemplateSearch<T, feature_number>::remove_template(size_t index)
+  {
+    if (!contains(index))
+      throw std::logic_error("no template with this index");
+
+    // swap with empty vectors to release the memory
+    Features().swap(templates_[index].features);
+    Features().swap(templates_[index].lower);
+    Features().swap(templates_[index].upper);
+    free_indices_.push_back(index);
+  }
+
+  template <typename T, size_t feature_number>
+  bool TemplateSearch<T, feature_number>::contains(size_t index) const
+  {
+    return (index < templates_.size()) && !templates_[index].features.empty();
+  }
+
+  template <typename T, size_t feature_number>
+  T TemplateSearch<T, feature_number>::lb_kim(const Template& t,
+                                             const FeatureSequence& query) const
+  {
+    T bound = 4*vector_distance<T, feature_number>(query[0], t.features.front().data());
+    if ((query.size() > 1) || (t.features.size() > 1))
+      bound += vector_distance<T, feature_number>(query[query.size()-1], t.features.back().data());
+    return bound;
+  }
+
+  // Envelope over the template frames [first, last), combined from as few of
+  // the precomputed envelopes as possible. The combined envelope may cover a
+  // few more frames than requested, which only loosens the bound.
+  template <typename T, size_t feature_number>
+  void TemplateSearch<T, feature_number>::envelope(const Template& t,
+                                                  size_t first,
+                                                  size_t last,
+                                                  FeatureVector& lower,
+                                                  FeatureVector& upper) const
+  {
+    const size_t J = t.features.size();
+    size_t center = std::min(first+r, J-1);
+    lower = t.lower[center];
+    upper = t.upper[center];
+    while (center+r+1 < last)
+    {
+      center = std::min(center+2*r+1, J-1);
+      for (size_t n=0; n<feature_number; ++n)
+      {
+        lower[n] = std::min(lower[n], t.lower[center][n]);
+        upper[n] = std::max(upper[n], t.upper[center][n]);
+      }
+    }
+  }
+
+  template <typename T, size_t feature_number>
+  T TemplateSearch<T, feature_number>::lb_keogh(const Template& t,
+                                               const FeatureSequence& query,
+                                               unsigned adjustment_window_size,
+                                               T abandon_above) const
+  {
+    const size_t I = query.size();
+    const SakoeChibaBand<T> band(I, t.features.size(), adjustment_window_size);
+    FeatureVector lower, upper;
+    T bound = 0;
+    for (size_t i=1; i<=I; ++i)
+    {
+      size_t begin, end;
+      band.row(i, begin, end);
+      // no path can pass through an empty row
+      if (begin == end)
+        return max_value;
+
+      envelope(t, begin-1, end-1, lower, upper);
+      const T* q = query[i-1];
+      T sum = 0;
+      for (size_t n=0; n<feature_number; ++n)
+      {
+        const T e = std::max(q[n]-upper[n], T(0)) + std::max(lower[n]-q[n], T(0));
+        sum += e*e;
+      }
+      bound += static_cast<T>(std::sqrt(sum));
+      if (bound > abandon_above)
+        return bound;
+    }
+    return bound;
+  }
+
+  template <typename T, size_t feature_number>
+  typename TemplateSearch<T, feature_number>::Match
+  TemplateSearch<T, feature_number>::nearest(const FeatureSequence& query,
+                                             Statistics* statistics) const
+  {
+    if (size() == 0)
+      throw std::logic_error("no templates to search");
+
+    return nearest(query, 1, r, statistics).front();
+  }
+
+  template <typename T, size_t feature_number>
+  std::vector<typename TemplateSearch<T, feature_number>::Match>
+  TemplateSearch<T, feature_number>::nearest(const FeatureSequence& query,
+                                             size_t k,
+                                             unsigned adjustment_window_size,
+                                             Statistics* statistics) const
+  {
+    if (query.size() == 0)
+      throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+
+    Statistics stats;
+    stats.candidates = size();
+    if (k == 0)
+    {
+      if (statistics != NULL)
+        *statistics = Statistics();
+      return std::vector<Match>();
+    }
+
+    std::vector<Candidate> candidates;
+    candidates.reserve(size());
+    for (size_t index=0; index<templates_.size(); ++index)
+    {
+      if (!contains(index))
+        continue;
+      Candidate c;
+      c.index = index;
+      c.bound = lb_kim(templates_[index], query)/(query.size()+templates_[index].features.size());
+      candidates.push_back(c);
+    }
+    std::stable_sort(candidates.begin(), candidates.end());
+
+    // the best matches so far, ordered by closer()
+    std::vector<Match> best;
+    best.reserve(k+1);
+
+    // reuses its rows for all full comparisons of this query
+    DTWEngine<T, feature_number> engine;
+
+    for (size_t c=0; c<candidates.size(); ++c)
+    {
+      const T kth_distance = (best.size() < k) ? max_value : best.back().distance;
+
+      // candidates are sorted, none of the remaining ones can be closer
+      if (candidates[c].bound > kth_distance)
+      {
+        stats.pruned_by_kim += candidates.size()-c;
+        break;
+      }
+
+      const Template& t = templates_[candidates[c].index];
+      const T normalization = static_cast<T>(query.size()+t.features.size());
+      if (lb_keogh(t, query, adjustment_window_size, kth_distance*normalization)/normalization > kth_distance)
+      {
+        ++stats.pruned_by_keogh;
+        continue;
+      }
+
+      ++stats.full_comparisons;
+      Match m;
+      m.index = candidates[c].index;
+      m.distance = engine.minimum_distance(query, t.features, adjustment_window_size);
+      best.insert(std::upper_bound(best.begin(), best.end(), m, closer), m);
+      if (best.size() > k)
+        best.pop_back();
+    }
+
+    if (statistics != NULL)
+      *statistics = stats;
+    return best;
+  }
+}
+
+#endif // WORD_MATCH_TEMPLATE_SEARCH_HPP
@@ -0,0 +1,264 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_TILED_DTW_HPP
+#define WORD_MATCH_TILED_DTW_HPP
+
+#include "dtw.hpp"
+#include "dtw_window.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <boost/multi_array.hpp>
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace simod1
+{
+  // Variant of DTW for long sequences. The global distance matrix is cut into
+  // square tiles of tile_size x tile_size cells, which are small enough to
+  // keep their part of g and of the features in cache. A tile only depends
+  // on its left, upper and upper-left neighbours, so all tiles on the same
+  // anti-diagonal are independent and, given a pool, are calculated in
+  // parallel, one anti-diagonal (wavefront) after the other. Without a pool
+  // the tiles are calculated row by row on the calling thread.
+  //
+  // Every cell is evaluated with exactly the same expressions as in DTW, so
+  // distance and path are identical to the ones of DTW for the same
+  // arguments, regardless of tile size and number of threads. Tiles that lie
+  // completely outside of the adjustment window are skipped. Local distances
+  // are calculated per tile row and not stored.
+  template <typename T = double, size_t feature_number=3>
+  class TiledDTW
+  {
+  public:
+    typedef typename DTW<T, feature_number>::FeatureVector FeatureVector;
+    typedef typename DTW<T, feature_number>::Features Features;
+    typedef typename DTW<T, feature_number>::DistanceMatrix DistanceMatrix;
+    typedef typename DTW<T, feature_number>::Path Path;
+    TiledDTW(const Features& a,
+             const Features& b,
+             unsigned adjustment_window_size,
+             size_t tile_size = 64,
+             WorkStealingPool* pool = NULL);
+    ~TiledDTW() {}
+    T minimum_distance() const { return minimum_distance_; }
+    Path minimal_path() const;
+    const DistanceMatrix& global_distances() const { return g; }
+
+  private:
+    struct Tile
+    {
+      size_t row;
+      size_t column;
+    };
+
+    // Calculates the tiles [begin, end) of one anti-diagonal for the pool.
+    // Only exists while the constructor runs, as do the features it refers
+    // to.
+    class Wavefront
+    {
+    public:
+      Wavefront(TiledDTW& dtw,
+                const Features& a,
+                const Features& b,
+                const std::vector<Tile>& tiles)
+        : dtw_(dtw), a_(a), b_(b), tiles_(tiles) {}
+      void operator()(size_t begin, size_t end)
+      {
+        for (size_t t=begin; t<end; ++t)
+          dtw_.calculate_tile(a_, b_, tiles_[t].row, tiles_[t].column);
+      }
+    private:
+      TiledDTW& dtw_;
+      const Features& a_;
+      const Features& b_;
+      const std::vector<Tile>& tiles_;
+    };
+    friend class Wavefront;
+
+    const size_t tile_size_;
+    const SakoeChibaBand<T> band;
+    DistanceMatrix g;
+    boost::multi_array<unsigned char, 2> steps;
+    T minimum_distance_;
+
+    void calculate_tile(const Features& a,
+                        const Features& b,
+                        size_t tile_row,
+                        size_t tile_column);
+  };
+
+  template <typename T, size_t feature_number>
+  TiledDTW<T, feature_number>::TiledDTW(const Features& a,
+                                        const Features& b,
+                                        unsigned adjustment_window_size,
+                                        size_t tile_size,
+                                        WorkStealingPool* pool)
+    : tile_size_(tile_size),
+      band(a.size(), b.size(), adjustment_window_size)
+  {
+    if ((a.size() == 0) || (b.size() == 0))
+      throw std::logic_error("feature argument empty");
+    if (adjustment_window_size == 0)
+      throw std::logic_error("adjustment window size cannot be zero");
+    if (tile_size == 0)
+      throw std::logic_error("tile size cannot be zero");
+
+    const size_t I = a.size();
+    const size_t J = b.size();
+    g.resize(boost::extents[I+1][J+1]);
+    steps.resize(boost::extents[I][J]);
+
+    T max_value = std::numeric_limits<T>::max();
+    if (std::numeric_limits<T>::has_infinity)
+      max_value = std::numeric_limits<T>::infinity();
+    std::fill(g.origin(), g.origin()+g.num_elements(), max_value);
+    g[0][0] = 2*vector_distance<T, feature_number>(a[0], b[0]);
+
+    // The columns of g covered by the window within each row of tiles. Since
+    // the window moves monotonically to the right, these are the columns
+    // from the first cell of the first to the last cell of the last
+    // non-empty row.
+    const size_t tile_rows = (I+tile_size-1)/tile_size;
+    const size_t tile_columns = (J+tile_size-1)/tile_size;
+    std::vector<size_t> first_tile(tile_rows, 1), last_tile(tile_rows, 0);
+    for (size_t tr=0; tr<tile_rows; ++tr)
+    {
+      size_t first_column = J+1, last_column = 0;
+      for (size_t i=tr*tile_size+1; i<=std::min((tr+1)*tile_size, I); ++i)
+      {
+        size_t begin, end;
+        band.row(i, begin, end);
+        if (begin == end)
+          continue;
+        first_column = std::min(first_column, begin);
+        last_column = std::max(last_column, end-1);
+      }
+      if (first_column <= last_column)
+      {
+        first_tile[tr] = (first_column-1)/tile_size;
+        last_tile[tr] = (last_column-1)/tile_size;
+      }
+    }
+
+    if (pool == NULL)
+    {
+      for (size_t tr=0; tr<tile_rows; ++tr)
+        for (size_t tc=first_tile[tr]; tc<=last_tile[tr]; ++tc)
+          calculate_tile(a, b, tr, tc);
+    }
+    else
+    {
+      // the tiles of the anti-diagonal that is currently calculated
+      std::vector<Tile> tiles;
+      Wavefront wavefront(*this, a, b, tiles);
+      for (size_t wave=0; wave<tile_rows+tile_columns-1; ++wave)
+      {
+        tiles.clear();
+        for (size_t tr=0; (tr<tile_rows) && (tr<=wave); ++tr)
+        {
+          Tile tile;
+          tile.row = tr;
+          tile.column = wave-tr;
+          if ((tile.column >= first_tile[tr]) && (tile.column <= last_tile[tr]))
+            tiles.push_back(tile);
+        }
+        pool->parallel_for(tiles.size(), 1, wavefront);
+      }
+    }
+
+    minimum_distance_ = g[I][J]/(I+J);
+  }
+
+  template <typename T, size_t feature_number>
+  void TiledDTW<T, feature_number>::calculate_tile(const Features& a,
+                                                   const Features& b,
+                                                   size_t tile_row,
+                                                   size_t tile_column)
+  {
+    const size_t I = a.size();
+    const size_t J = b.size();
+    const size_t row_begin = tile_row*tile_size_+1;
+    const size_t row_end = std::min(row_begin+tile_size_, I+1);
+    const size_t column_begin = tile_column*tile_size_+1;
+    const size_t column_end = std::min(column_begin+tile_size_, J+1);
+
+    std::vector<T> local(tile_size_);
+    for (size_t i=row_begin; i<row_end; ++i)
+    {
+      size_t begin, end;
+      band.row(i, begin, end);
+      begin = std::max(begin, column_begin);
+      end = std::min(end, column_end);
+      if (begin >= end)
+        continue;
+
+      vector_distances<T, feature_number>(a[i-1], &b[begin-1], end-begin, &local[0]);
+      for (size_t j=begin; j<end; ++j)
+      {
+        const T d = local[j-begin];
+        const T distances[] = {
+            g[i  ][j-1] +   d,
+            g[i-1][j-1] + 2*d,
+            g[i-1][j  ] +   d
+          };
+        const T min_distance = *std::min_element(distances, distances+3);
+        steps[i-1][j-1] = static_cast<unsigned char>(std::find(distances, distances+3, min_distance)-distances);
+        g[i][j] = min_distance;
+      }
+    }
+  }
+
+  template <typename T, size_t feature_number>
+  typename TiledDTW<T, feature_number>::Path TiledDTW<T, feature_number>::minimal_path() const
+  {
+    size_t i = steps.shape()[0]-1;
+    size_t j = steps.shape()[1]-1;
+    Path min_path;
+
+    while ((i>0) && (j>0))
+    {
+      switch (steps[i][j])
+      {
+        case 0:
+          --j;
+          break;
+        case 1:
+          --i;
+          --j;
+          break;
+        case 2:
+          --i;
+          break;
+        default:
+          throw std::logic_error("invalid step");
+      }
+      min_path.push_back(std::make_pair(i, j));
+    }
+    std::reverse(min_path.begin(), min_path.end());
+    return min_path;
+  }
+}
+
+#endif // WORD_MATCH_TILED_DTW_HPP
@@ -0,0 +1,338 @@
+//Copyright (c) 2011 Sebastian Böhm sebastian@sometimesfood.org
+//                   Heinrich Fink hf@hfink.eu
+//
+//Permission is hereby granted, free of charge, to any person obtaining a copy
+//of this software and associated documentation files (the "Software"), to deal
+//in the Software without restriction, including without limitation the rights
+//to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//copies of the Software, and to permit persons to whom the Software is
+//furnished to do so, subject to the following conditions:
+//
+//The above copyright notice and this permission notice shall be included in
+//all copies or substantial portions of the Software.
+//
+//THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//THE SOFTWARE.
+
+#ifndef WORD_MATCH_WORK_STEALING_POOL_HPP
+#define WORD_MATCH_WORK_STEALING_POOL_HPP
+
+#include <boost/utility.hpp>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <string>
+#include <stdexcept>
+
+namespace simod1
+{
+  // A fixed set of threads that run the iterations of a loop in parallel.
+  // The iterations are cut into chunks, and each thread starts with a
+  // contiguous share of the chunks in a queue of its own. A thread that runs
+  // out of work steals single chunks from the back of the other queues, so
+  // chunks of very different cost (e.g. DTW of long and short sequences) are
+  // balanced without contention on a central queue.
+  //
+  // The thread calling parallel_for works on the first queue, so a pool of
+  // size n starts n-1 threads. parallel_for must neither be called from
+  // several threads at the same time, nor from within the loop body.
+  class WorkStealingPool : boost::noncopyable
+  {
+  public:
+    // number_of_threads == 0 uses one thread per online processor
+    explicit WorkStealingPool(size_t number_of_threads = 0);
+    ~WorkStealingPool();
+    size_t size() const { return queues_.size(); }
+
+    // Calls body(begin, end) for disjoint ranges of at most grain iterations
+    // that cover [0, count) and returns when all calls have finished. If body
+    // throws, the chunks not yet started are skipped and parallel_for throws
+    // a std::runtime_error with the same message.
+    template <typename Body>
+    void parallel_for(size_t count, size_t grain, Body& body);
+
+  private:
+    struct Range
+    {
+      size_t begin;
+      size_t end;
+    };
+
+    struct Queue
+    {
+      pthread_mutex_t mutex;
+      std::deque<Range> ranges;
+    };
+
+    struct Job
+    {
+      virtual ~Job() {}
+      virtual void run(size_t begin, size_t end) = 0;
+    };
+
+    template <typename Body>
+    struct BodyJob : Job
+    {
+      Body& body;
+      explicit BodyJob(Body& b) : body(b) {}
+      void run(size_t begin, size_t end) { body(begin, end); }
+    };
+
+    struct Worker
+    {
+      WorkStealingPool* pool;
+      size_t index;
+    };
+
+    std::vector<Queue*> queues_;
+    std::vector<Worker> workers_;
+    std::vector<pthread_t> threads_;
+
+    // guards all of the following members
+    pthread_mutex_t mutex_;
+    pthread_cond_t start_;
+    pthread_cond_t done_;
+    Job* job_;
+    unsigned long generation_;
+    size_t busy_threads_;
+    bool shutdown_;
+    bool failed_;
+    std::string error_;
+
+    static void* thread_main(void* argument);
+    void run_thread(size_t index);
+    void run_job(Job& job, size_t count, size_t grain);
+    void work(size_t index);
+    bool next_range(size_t index, Range& range);
+    void fail(const std::string& message);
+    void stop_threads();
+  };
+
+  inline WorkStealingPool::WorkStealingPool(size_t number_of_threads)
+    : job_(NULL),
+      generation_(0),
+      busy_threads_(0),
+      shutdown_(false),
+      failed_(false)
+  {
+    if (number_of_threads == 0)
+    {
+      const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+      number_of_threads = (processors > 0) ? static_cast<size_t>(processors) : 1;
+    }
+
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&start_, NULL);
+    pthread_cond_init(&done_, NULL);
+
+    for (size_t i=0; i<number_of_threads; ++i)
+    {
+      queues_.push_back(new Queue());
+      pthread_mutex_init(&queues_.back()->mutex, NULL);
+    }
+
+    // workers_ must not reallocate after the threads got their arguments
+    workers_.resize(number_of_threads);
+    threads_.reserve(number_of_threads);
+    for (size_t i=1; i<number_of_threads; ++i)
+    {
+      workers_[i].pool = this;
+      workers_[i].index = i;
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, &WorkStealingPool::thread_main, &workers_[i]) != 0)
+      {
+        stop_threads();
+        throw std::runtime_error("cannot create worker thread");
+      }
+      threads_.push_back(thread);
+    }
+  }
+
+  inline WorkStealingPool::~WorkStealingPool()
+  {
+    stop_threads();
+  }
+
+  inline void WorkStealingPool::stop_threads()
+  {
+    pthread_mutex_lock(&mutex_);
+    shutdown_ = true;
+    pthread_cond_broadcast(&start_);
+    pthread_mutex_unlock(&mutex_);
+
+    for (size_t i=0; i<threads_.size(); ++i)
+      pthread_join(threads_[i], NULL);
+
+    for (size_t i=0; i<queues_.size(); ++i)
+    {
+      pthread_mutex_destroy(&queues_[i]->mutex);
+      delete queues_[i];
+    }
+    pthread_cond_destroy(&done_);
+    pthread_cond_destroy(&start_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  inline void* WorkStealingPool::thread_main(void* argument)
+  {
+    Worker* worker = static_cast<Worker*>(argument);
+    worker->pool->run_thread(worker->index);
+    return NULL;
+  }
+
+  inline void WorkStealingPool::run_thread(size_t index)
+  {
+    unsigned long generation = 0;
+    for (;;)
+    {
+      pthread_mutex_lock(&mutex_);
+      while ((generation_ == generation) && !shutdown_)
+        pthread_cond_wait(&start_, &mutex_);
+      if (shutdown_)
+      {
+        pthread_mutex_unlock(&mutex_);
+        return;
+      }
+      generation = generation_;
+      pthread_mutex_unlock(&mutex_);
+
+      work(index);
+
+      pthread_mutex_lock(&mutex_);
+      if (--busy_threads_ == 0)
+        pthread_cond_signal(&done_);
+      pthread_mutex_unlock(&mutex_);
+    }
+  }
+
+  template <typename Body>
+  void WorkStealingPool::parallel_for(size_t count, size_t grain, Body& body)
+  {
+    BodyJob<Body> job(body);
+    run_job(job, count, grain);
+  }
+
+  inline void WorkStealingPool::run_job(Job& job, size_t count, size_t grain)
+  {
+    if (grain == 0)
+      throw std::logic_error("grain size cannot be zero");
+    if (count == 0)
+      return;
+
+    // deal out contiguous shares of the chunks
+    const size_t chunks = (count+grain-1)/grain;
+    const size_t n = queues_.size();
+    for (size_t q=0; q<n; ++q)
+    {
+      Queue& queue = *queues_[q];
+      pthread_mutex_lock(&queue.mutex);
+      for (size_t c=q*chunks/n; c<(q+1)*chunks/n; ++c)
+      {
+        Range range;
+        range.begin = c*grain;
+        range.end = std::min(range.begin+grain, count);
+        queue.ranges.push_back(range);
+      }
+      pthread_mutex_unlock(&queue.mutex);
+    }
+
+    pthread_mutex_lock(&mutex_);
+    job_ = &job;
+    failed_ = false;
+    error_.clear();
+    busy_threads_ = threads_.size();
+    ++generation_;
+    pthread_cond_broadcast(&start_);
+    pthread_mutex_unlock(&mutex_);
+
+    work(0);
+
+    pthread_mutex_lock(&mutex_);
+    while (busy_threads_ > 0)
+      pthread_cond_wait(&done_, &mutex_);
+    job_ = NULL;
+    const bool failed = failed_;
+    const std::string error = error_;
+    pthread_mutex_unlock(&mutex_);
+
+    if (failed)
+      throw std::runtime_error(error);
+  }
+
+  inline void WorkStealingPool::work(size_t index)
+  {
+    Range range;
+    while (next_range(index, range))
+    {
+      try
+      {
+        job_->run(range.begin, range.end);
+      }
+      catch (const std::exception& e)
+      {
+        fail(e.what());
+      }
+      catch (...)
+      {
+        fail("unknown exception in parallel_for");
+      }
+    }
+  }
+
+  inline bool WorkStealingPool::next_range(size_t index, Range& range)
+  {
+    const size_t n = queues_.size();
+    for (size_t k=0; k<n; ++k)
+    {
+      Queue& queue = *queues_[(index+k)%n];
+      pthread_mutex_lock(&queue.mutex);
+      if (!queue.ranges.empty())
+      {
+        // take the own work from the front, steal from the back
+        if (k == 0)
+        {
+          range = queue.ranges.front();
+          queue.ranges.pop_front();
+        }
+        else
+        {
+          range = queue.ranges.back();
+          queue.ranges.pop_back();
+        }
+        pthread_mutex_unlock(&queue.mutex);
+        return true;
+      }
+      pthread_mutex_unlock(&queue.mutex);
+    }
+    return false;
+  }
+
+  inline void WorkStealingPool::fail(const std::string& message)
+  {
+    pthread_mutex_lock(&mutex_);
+    if (!failed_)
+    {
+      failed_ = true;
+      error_ = message;
+    }
+    pthread_mutex_unlock(&mutex_);
+
+    for (size_t q=0; q<queues_.size(); ++q)
+    {
+      pthread_mutex_lock(&queues_[q]->mutex);
+      queues_[q]->ranges.clear();
+      pthread_mutex_unlock(&queues_[q]->mutex);
+    }
+  }
+}
+
+#endif // WORD_MATCH_WORK_STEALING_POOL_HPP